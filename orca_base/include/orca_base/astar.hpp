@@ -1,13 +1,15 @@
 #ifndef ORCA_BASE_ASTAR_HPP
 #define ORCA_BASE_ASTAR_HPP
 
+#include <algorithm>
+#include <chrono>
 #include <vector>
 #include <cassert>
+#include <cmath>
 #include <iostream>
-#include <queue>
-#include <map>
 #include <limits>
 #include <functional>
+#include <memory>
 
 namespace astar
 {
@@ -15,6 +17,11 @@ namespace astar
   // Nodes
   using node_type = int;
 
+  // Nodes are remapped to dense indices [0, num_nodes) when the graph is built
+  using index_type = int;
+
+  constexpr index_type INVALID_INDEX = -1;
+
   // Edges
   struct Edge
   {
@@ -31,30 +38,83 @@ namespace astar
   // Used for get_neighbors
   struct Neighbor
   {
-    node_type node;
+    // Dense index of this neighbor
+    index_type index;
 
     // Distance to this neighbor
     double distance;
 
-    Neighbor(node_type _node, double _distance) : node{_node}, distance{_distance}
+    Neighbor(index_type _index, double _distance) : index{_index}, distance{_distance}
     {}
   };
 
-  // Graph
-  struct Graph
+  // A contiguous run of neighbors, returned by get_neighbors, no allocation required
+  struct NeighborSpan
   {
-    std::vector<Edge> edges_;
+    const Neighbor *begin_;
+    const Neighbor *end_;
 
-    explicit Graph(std::vector<Edge> graph) : edges_{std::move(graph)}
-    {}
+    const Neighbor *begin() const
+    { return begin_; }
+
+    const Neighbor *end() const
+    { return end_; }
+
+    size_t size() const
+    { return end_ - begin_; }
+
+    bool empty() const
+    { return begin_ == end_; }
+  };
+
+  // Graph, stored as a compressed sparse row (CSR) adjacency list
+  class Graph
+  {
+    // Sorted list of node ids, the position in this list is the dense index
+    std::vector<node_type> nodes_;
+
+    // The neighbors of index i are neighbors_[offsets_[i]] through neighbors_[offsets_[i + 1] - 1]
+    std::vector<size_t> offsets_;
+
+    // Packed neighbors and distances for all nodes
+    std::vector<Neighbor> neighbors_;
 
-    std::vector<Neighbor> get_neighbors(node_type node);
+    // Build the CSR adjacency list from a list of edges
+    void build(const std::vector<Edge> &edges, const std::vector<node_type> &extra_nodes);
+
+  public:
+
+    // Edges are the input format, the CSR adjacency list is built once
+    // Extra nodes are added even if they have no edges, e.g., so that they can be connected by query edges
+    explicit Graph(const std::vector<Edge> &edges, const std::vector<node_type> &extra_nodes = {})
+    { build(edges, extra_nodes); }
+
+    // Copy an existing graph and add more edges and nodes
+    Graph(const Graph &base, const std::vector<Edge> &edges, const std::vector<node_type> &extra_nodes);
+
+    // Copy an existing graph and replace all edges of the changed nodes, e.g., because they moved
+    // Every new edge must touch a changed node, and the node set doesn't change
+    Graph(const Graph &base, const std::vector<node_type> &changed, const std::vector<Edge> &edges);
+
+    size_t num_nodes() const
+    { return nodes_.size(); }
+
+    // Map a node id to a dense index, returns INVALID_INDEX if the node is not in the graph
+    index_type index(node_type node) const;
+
+    // Map a dense index back to a node id
+    node_type node(index_type index) const
+    { return nodes_[index]; }
+
+    // Return the neighbors of this node
+    NeighborSpan get_neighbors(index_type index) const
+    { return NeighborSpan{neighbors_.data() + offsets_[index], neighbors_.data() + offsets_[index + 1]}; }
   };
 
   // Nodes in the open_set_ contain additional state
   struct CandidateNode
   {
-    node_type node;
+    index_type index;
 
     // Cost of cheapest path from start to this node
     double g_score;
@@ -67,11 +127,11 @@ namespace astar
     CandidateNode() = default;
 
     // Useful constructor
-    CandidateNode(node_type _node, double _g_score, double h) : node{_node}, g_score{_g_score}, f_score{_g_score + h}
+    CandidateNode(index_type _index, double _g_score, double h) : index{_index}, g_score{_g_score}, f_score{_g_score + h}
     {}
 
     // Priority queue uses value operator as comparator
-    bool operator()(const CandidateNode &a, const CandidateNode &b)
+    bool operator()(const CandidateNode &a, const CandidateNode &b) const
     {
       return a.f_score > b.f_score;
     }
@@ -79,38 +139,713 @@ namespace astar
 
   std::ostream &operator<<(std::ostream &os, CandidateNode const &c);
 
-  // Find the shortest path in a graph
-  class Solver
+  // xy coordinates of a node
+  struct XY
+  {
+    double x;
+    double y;
+  };
+
+  // Heuristic: straight-line distance in the xy plane
+  // Reads coordinates from a contiguous array indexed by dense index, the array must outlive the heuristic
+  class EuclideanXY
+  {
+    const XY *xy_;
+
+  public:
+
+    explicit EuclideanXY(const XY *xy) : xy_{xy}
+    {}
+
+    double operator()(index_type a, index_type b) const
+    {
+      double dx = xy_[a].x - xy_[b].x;
+      double dy = xy_[a].y - xy_[b].y;
+      return std::sqrt(dx * dx + dy * dy);
+    }
+  };
+
+  // Heuristic function provides a rough guess of distance between 2 nodes, must be < than actual distance
+  using HeuristicFn = std::function<double(node_type a, node_type b)>;
+
+  // Heuristic: call a std::function with node ids. Flexible, but slower than EuclideanXY
+  class NodeIdHeuristic
   {
-    Graph graph_;
+    std::shared_ptr<const Graph> graph_;
+    HeuristicFn fn_;
+
+  public:
+
+    NodeIdHeuristic(std::shared_ptr<const Graph> graph, HeuristicFn fn) : graph_{std::move(graph)}, fn_{std::move(fn)}
+    {}
+
+    double operator()(index_type a, index_type b) const
+    { return fn_(graph_->node(a), graph_->node(b)); }
+  };
+
+  // Solver state that doesn't depend on the heuristic
+  class SolverBase
+  {
+  protected:
+
+    // The graph is immutable and may be shared by several solvers
+    std::shared_ptr<const Graph> graph_;
 
-    // Heuristic function provides a rough guess of distance between 2 nodes, must be < than actual distance
-    using HeuristicFn = std::function<double(node_type a, node_type b)>;
+    // Per-node state, indexed by dense index. An entry is only valid if stamp_[i] == generation_,
+    // so bumping generation_ resets all of the entries in O(1)
+    std::vector<double> best_g_score_;        // Best g_score from start to a node
+    std::vector<index_type> best_parents_;    // Parent nodes, used to reconstruct the path at the end
+    std::vector<unsigned> stamp_;             // Generation that last wrote to this entry
+    unsigned generation_ = 0;
 
-    HeuristicFn h_;
+    // Set of candidate nodes, kept as a binary heap so that the capacity is re-used between queries
+    std::vector<CandidateNode> open_set_;
 
-    // Best g_score from start to a node
-    std::map<node_type, double> best_g_score_;
+    // Edges added for a single query, sorted by the index of the node they leave from
+    std::vector<std::pair<index_type, Neighbor>> query_neighbors_;
 
-    // Parent nodes, used to reconstruct the path at the end
-    std::map<node_type, node_type> best_parents_;
+    explicit SolverBase(std::shared_ptr<const Graph> graph) :
+      graph_{std::move(graph)},
+      best_g_score_(graph_->num_nodes()),
+      best_parents_(graph_->num_nodes()),
+      stamp_(graph_->num_nodes(), 0)
+    {}
+
+    void set_query_edges(const std::vector<Edge> &query_edges);
 
-    // Set of candidate nodes
-    std::priority_queue<CandidateNode, std::vector<CandidateNode>, CandidateNode> open_set_;
+    // Return the query neighbors of this node
+    std::pair<const std::pair<index_type, Neighbor> *, const std::pair<index_type, Neighbor> *>
+    get_query_neighbors(index_type index) const;
 
     void print_open_set();
 
-    void reconstruct_path(node_type node, std::vector<node_type> &path);
+    void reconstruct_path(index_type index, std::vector<node_type> &path);
 
     void reset();
 
+    double best_g_score(index_type index) const
+    { return stamp_[index] == generation_ ? best_g_score_[index] : std::numeric_limits<double>::max(); }
+
+    void set_best(index_type index, double g_score, index_type parent)
+    {
+      best_g_score_[index] = g_score;
+      best_parents_[index] = parent;
+      stamp_[index] = generation_;
+    }
+
+  public:
+
+    const Graph &graph() const
+    { return *graph_; }
+  };
+
+  // Find the shortest path in a graph
+  // Heuristic is a functor with the signature double(index_type a, index_type b), it is called with dense indices
+  // and inlined in the inner loop
+  template<typename Heuristic>
+  class Solver : public SolverBase
+  {
+    using Clock = std::chrono::steady_clock;
+
+    // Check the clock every so often
+    static constexpr int CHECK_CLOCK_EXPANSIONS = 64;
+
+    Heuristic h_;
+
+    // Try to improve the path to neighbor by going through current
+    void relax(const CandidateNode &current, const Neighbor &neighbor, index_type destination, double weight)
+    {
+      // tentative_g_score is the distance from start through current to the neighbor
+      double tentative_g_score = current.g_score + neighbor.distance;
+
+      // Does this beat the current best path?
+      if (tentative_g_score < best_g_score(neighbor.index)) {
+        // Yes! Remember this path
+        set_best(neighbor.index, tentative_g_score, current.index);
+
+        // Add the neighbor to the open set
+        open_set_.emplace_back(neighbor.index, tentative_g_score, weight * h_(neighbor.index, destination));
+        std::push_heap(open_set_.begin(), open_set_.end(), CandidateNode());
+      }
+    }
+
+    // Weighted A*, the heuristic is multiplied by weight >= 1, so the path is at most weight * optimal
+    // Return true if the destination was reached. If deadline isn't null, give up when it passes.
+    bool search(index_type start_index, index_type destination_index, double weight,
+                const Clock::time_point *deadline, bool &timed_out)
+    {
+      reset();
+      timed_out = false;
+
+      // Best distance to start node is always 0
+      set_best(start_index, 0, INVALID_INDEX);
+
+      // Add start node to open set
+      open_set_.emplace_back(start_index, 0, weight * h_(start_index, destination_index));
+
+      int expansions = 0;
+      while (!open_set_.empty()) {
+        // print_open_set();
+
+        if (deadline && ++expansions % CHECK_CLOCK_EXPANSIONS == 0 && Clock::now() > *deadline) {
+          timed_out = true;
+          return false;
+        }
+
+        // Pop the path with the best f_score
+        std::pop_heap(open_set_.begin(), open_set_.end(), CandidateNode());
+        auto current = open_set_.back();
+        open_set_.pop_back();
+
+        // Are we done?
+        if (current.index == destination_index) {
+          return true;
+        }
+
+        // If this path to current.index is worse than the best one we've seen, drop it
+        if (current.g_score > best_g_score(current.index)) {
+          continue;
+        }
+
+        // Loop through neighbors
+        for (const auto &neighbor : graph_->get_neighbors(current.index)) {
+          relax(current, neighbor, destination_index, weight);
+        }
+
+        // Loop through query neighbors
+        auto query_neighbors = get_query_neighbors(current.index);
+        for (auto it = query_neighbors.first; it != query_neighbors.second; ++it) {
+          relax(current, it->second, destination_index, weight);
+        }
+      }
+
+      return false;
+    }
+
+    // After a weighted search, the optimal cost is >= min(g + h) across the open set
+    double lower_bound(double weight) const
+    {
+      double result = std::numeric_limits<double>::max();
+      for (const auto &c : open_set_) {
+        result = std::min(result, c.g_score + (c.f_score - c.g_score) / weight);
+      }
+      return result;
+    }
+
   public:
 
-    explicit Solver(std::vector<Edge> edges, HeuristicFn h) : graph_{Graph(std::move(edges))}, h_{std::move(h)}
+    Solver(std::shared_ptr<const Graph> graph, Heuristic h) :
+      SolverBase{std::move(graph)},
+      h_{std::move(h)}
     {}
 
+    // Access the heuristic, e.g., to set per-query state
+    Heuristic &heuristic()
+    { return h_; }
+
     // Find the best path from start to destination, return true if successful
-    bool find_shortest_path(node_type start, node_type destination, std::vector<node_type> &result);
+    // Query edges are only used for this query, e.g., to connect the start and destination to the graph.
+    // The nodes in the query edges must be in the graph.
+    bool find_shortest_path(node_type start, node_type destination, std::vector<node_type> &result,
+                            const std::vector<Edge> &query_edges = {})
+    {
+      // Map the start and destination to dense indices
+      index_type start_index = graph_->index(start);
+      index_type destination_index = graph_->index(destination);
+      if (start_index == INVALID_INDEX || destination_index == INVALID_INDEX) {
+        return false;
+      }
+
+      set_query_edges(query_edges);
+
+      bool timed_out;
+      if (search(start_index, destination_index, 1, nullptr, timed_out)) {
+        result.clear();
+        reconstruct_path(destination_index, result);
+        return true;
+      }
+
+      return false;
+    }
+
+    // Anytime search: run weighted A* with a weight that shrinks towards 1, and stop when the budget (seconds) runs out
+    // Return true if a path was found, set optimal to true if the path is provably optimal
+    bool find_path_anytime(node_type start, node_type destination, std::vector<node_type> &result,
+                           double budget, bool &optimal, const std::vector<Edge> &query_edges = {},
+                           double initial_weight = 3)
+    {
+      auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(budget));
+      optimal = false;
+
+      index_type start_index = graph_->index(start);
+      index_type destination_index = graph_->index(destination);
+      if (start_index == INVALID_INDEX || destination_index == INVALID_INDEX) {
+        return false;
+      }
+
+      set_query_edges(query_edges);
+
+      bool found = false;
+      double best_cost = std::numeric_limits<double>::max();
+      for (double weight = std::max(1.0, initial_weight); !optimal;) {
+        bool timed_out;
+        bool reached = search(start_index, destination_index, weight, &deadline, timed_out);
+
+        if (timed_out) {
+          // Keep the best path so far
+          break;
+        }
+
+        if (!reached) {
+          // No path at any weight
+          break;
+        }
+
+        // Keep the shortest path, a smaller weight usually (but not always) finds a shorter path
+        double cost = best_g_score(destination_index);
+        if (cost < best_cost) {
+          found = true;
+          best_cost = cost;
+          result.clear();
+          reconstruct_path(destination_index, result);
+        }
+
+        // Done if the best path is as short as the lower bound
+        optimal = weight == 1 || best_cost <= lower_bound(weight);
+
+        // Shrink the weight, snap to 1 when close
+        weight = 1 + (weight - 1) / 2;
+        if (weight < 1.05) {
+          weight = 1;
+        }
+      }
+
+      return found;
+    }
+  };
+
+  // Compute the shortest distance from source to every node, unreachable nodes are set to infinity
+  void shortest_distances(const Graph &graph, index_type source, std::vector<double> &distances);
+
+  // Incremental shortest path search, based on D* Lite (Koenig and Likhachev, 2002)
+  // The search runs backwards from the destination, so the start can move, and edges can be added, changed
+  // or removed between queries. Each query only repairs the part of the search tree affected by the changes.
+  // The destination is fixed, create a new solver for a new destination.
+  template<typename Heuristic>
+  class IncrementalSolver
+  {
+    using Clock = std::chrono::steady_clock;
+
+    // Check the clock every so often
+    static constexpr int CHECK_CLOCK_EXPANSIONS = 64;
+
+    // Keys are compared lexicographically
+    struct Key
+    {
+      double k1;
+      double k2;
+
+      bool operator<(const Key &that) const
+      { return k1 < that.k1 || (k1 == that.k1 && k2 < that.k2); }
+
+      bool operator!=(const Key &that) const
+      { return k1 != that.k1 || k2 != that.k2; }
+    };
+
+    struct Entry
+    {
+      Key key;
+      index_type index;
+
+      // Min heap
+      bool operator()(const Entry &a, const Entry &b) const
+      { return b.key < a.key; }
+    };
+
+    // The graph provides the node ids and the initial edges
+    std::shared_ptr<const Graph> graph_;
+    Heuristic h_;
+
+    // Adjacency lists, these change as edges are updated
+    std::vector<std::vector<Neighbor>> neighbors_;
+
+    // Per-node state, indexed by dense index
+    std::vector<double> g_;                   // Distance to the destination, as of the last expansion
+    std::vector<double> rhs_;                 // One-step lookahead distance to the destination
+    std::vector<Key> key_;                    // Current key, valid if in_open_set_[i]
+    std::vector<char> in_open_set_;
+
+    // Open set, kept as a binary heap. Entries are removed lazily: an entry is stale if the node is no longer in
+    // the open set, or if the key has changed
+    std::vector<Entry> open_set_;
+
+    index_type start_;
+    index_type destination_;
+
+    // Accumulated heuristic correction for start movement
+    double km_ = 0;
+
+    static constexpr double INF = std::numeric_limits<double>::infinity();
+
+    Key calculate_key(index_type s) const
+    {
+      double k2 = std::min(g_[s], rhs_[s]);
+      return Key{k2 + h_(start_, s) + km_, k2};
+    }
+
+    // Pop stale entries, return false if the open set is empty
+    bool clean_top()
+    {
+      while (!open_set_.empty()) {
+        const auto &top = open_set_.front();
+        if (in_open_set_[top.index] && !(key_[top.index] != top.key)) {
+          return true;
+        }
+        std::pop_heap(open_set_.begin(), open_set_.end(), Entry());
+        open_set_.pop_back();
+      }
+      return false;
+    }
+
+    void update_vertex(index_type u)
+    {
+      if (g_[u] != rhs_[u]) {
+        key_[u] = calculate_key(u);
+        in_open_set_[u] = 1;
+        open_set_.push_back(Entry{key_[u], u});
+        std::push_heap(open_set_.begin(), open_set_.end(), Entry());
+      } else {
+        in_open_set_[u] = 0;
+      }
+    }
+
+    // Best one-step lookahead through the neighbors of u
+    double min_successor(index_type u) const
+    {
+      double result = INF;
+      for (const auto &neighbor : neighbors_[u]) {
+        result = std::min(result, neighbor.distance + g_[neighbor.index]);
+      }
+      return result;
+    }
+
+    // The cost of u -> v changed from c_old to c_new, fix rhs_[u]
+    void update_edge(index_type u, index_type v, double c_old, double c_new)
+    {
+      if (u == destination_) {
+        return;
+      }
+
+      if (c_new < c_old) {
+        rhs_[u] = std::min(rhs_[u], c_new + g_[v]);
+      } else if (rhs_[u] == c_old + g_[v]) {
+        rhs_[u] = min_successor(u);
+      }
+
+      update_vertex(u);
+    }
+
+    // Set the cost of a -> b in the adjacency list, INF removes the edge, return the old cost
+    double set_neighbor(index_type a, index_type b, double distance)
+    {
+      auto &neighbors = neighbors_[a];
+      auto it = std::find_if(neighbors.begin(), neighbors.end(), [b](const Neighbor &n)
+      { return n.index == b; });
+
+      double c_old = it == neighbors.end() ? INF : it->distance;
+
+      if (std::isinf(distance)) {
+        if (it != neighbors.end()) {
+          neighbors.erase(it);
+        }
+      } else if (it == neighbors.end()) {
+        neighbors.emplace_back(b, distance);
+      } else {
+        it->distance = distance;
+      }
+
+      return c_old;
+    }
+
+    // Repair the search tree. If deadline isn't null, stop when it passes and return false.
+    // The tree is consistent between expansions, so an interrupted repair can be resumed by the next call.
+    bool compute_shortest_path(const Clock::time_point *deadline)
+    {
+      int expansions = 0;
+      while (clean_top() &&
+             (open_set_.front().key < calculate_key(start_) || rhs_[start_] > g_[start_])) {
+        if (deadline && ++expansions % CHECK_CLOCK_EXPANSIONS == 0 && Clock::now() > *deadline) {
+          return false;
+        }
+
+        index_type u = open_set_.front().index;
+        Key k_old = open_set_.front().key;
+        Key k_new = calculate_key(u);
+
+        if (k_old < k_new) {
+          // The heuristic changed, re-insert with the new key
+          update_vertex(u);
+        } else if (g_[u] > rhs_[u]) {
+          // Overconsistent: the path through u got shorter
+          g_[u] = rhs_[u];
+          in_open_set_[u] = 0;
+          for (const auto &neighbor : neighbors_[u]) {
+            if (neighbor.index != destination_) {
+              rhs_[neighbor.index] = std::min(rhs_[neighbor.index], neighbor.distance + g_[u]);
+            }
+            update_vertex(neighbor.index);
+          }
+        } else {
+          // Underconsistent: the path through u got longer
+          double g_old = g_[u];
+          g_[u] = INF;
+          for (const auto &neighbor : neighbors_[u]) {
+            if (neighbor.index != destination_ && rhs_[neighbor.index] == neighbor.distance + g_old) {
+              rhs_[neighbor.index] = min_successor(neighbor.index);
+            }
+            update_vertex(neighbor.index);
+          }
+          update_vertex(u);
+        }
+      }
+
+      return true;
+    }
+
+    // Follow the best successors from the start to the destination
+    bool extract_path(std::vector<node_type> &result) const
+    {
+      if (std::isinf(rhs_[start_])) {
+        return false;
+      }
+
+      index_type current = start_;
+      result.push_back(graph_->node(current));
+      while (current != destination_ && result.size() <= graph_->num_nodes()) {
+        index_type next = INVALID_INDEX;
+        double best = INF;
+        for (const auto &neighbor : neighbors_[current]) {
+          double d = neighbor.distance + g_[neighbor.index];
+          if (d < best) {
+            best = d;
+            next = neighbor.index;
+          }
+        }
+
+        if (next == INVALID_INDEX) {
+          return false;
+        }
+
+        current = next;
+        result.push_back(graph_->node(current));
+      }
+
+      return current == destination_;
+    }
+
+  public:
+
+    IncrementalSolver(std::shared_ptr<const Graph> graph, Heuristic h, node_type start, node_type destination) :
+      graph_{std::move(graph)},
+      h_{std::move(h)},
+      neighbors_(graph_->num_nodes()),
+      g_(graph_->num_nodes(), INF),
+      rhs_(graph_->num_nodes(), INF),
+      key_(graph_->num_nodes()),
+      in_open_set_(graph_->num_nodes(), 0),
+      start_{graph_->index(start)},
+      destination_{graph_->index(destination)}
+    {
+      assert(start_ != INVALID_INDEX && destination_ != INVALID_INDEX);
+
+      for (size_t i = 0; i < graph_->num_nodes(); ++i) {
+        for (const auto &neighbor : graph_->get_neighbors(i)) {
+          neighbors_[i].push_back(neighbor);
+        }
+      }
+
+      rhs_[destination_] = 0;
+      update_vertex(destination_);
+    }
+
+    // Access the heuristic, e.g., to move nodes
+    Heuristic &heuristic()
+    { return h_; }
+
+    // Add, change or remove (distance is infinity) an edge
+    void set_edge(node_type a, node_type b, double distance)
+    {
+      index_type u = graph_->index(a);
+      index_type v = graph_->index(b);
+      assert(u != INVALID_INDEX && v != INVALID_INDEX);
+
+      double c_old = set_neighbor(u, v, distance);
+      if (c_old == distance) {
+        return;
+      }
+      set_neighbor(v, u, distance);
+
+      update_edge(u, v, c_old, distance);
+      update_edge(v, u, c_old, distance);
+    }
+
+    // Call after the heuristic for a node changes, e.g., the node moved
+    // The heuristic must remain consistent
+    void node_moved(node_type node)
+    {
+      index_type u = graph_->index(node);
+      if (in_open_set_[u]) {
+        update_vertex(u);
+      }
+    }
+
+    // Call after the start moves, distance must be >= the change in the heuristic, e.g., h(old start, new start)
+    void start_moved(double distance)
+    { km_ += distance; }
+
+    // Find the best path from the start to the destination, return true if successful
+    bool find_shortest_path(std::vector<node_type> &result)
+    {
+      result.clear();
+      compute_shortest_path(nullptr);
+      return extract_path(result);
+    }
+
+    // Budgeted version: give up when budget (seconds) runs out, set timed_out and return false
+    // The work done so far is kept, so the next query picks up where this one stopped
+    bool find_shortest_path(std::vector<node_type> &result, double budget, bool &timed_out)
+    {
+      auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(budget));
+      result.clear();
+      timed_out = !compute_shortest_path(&deadline);
+      return !timed_out && extract_path(result);
+    }
+  };
+
+  template<typename Heuristic>
+  constexpr double IncrementalSolver<Heuristic>::INF;
+
+  // Shortest distances and paths between every pair of a set of query nodes
+  struct PathMatrix
+  {
+    size_t size{0};
+
+    // Distance from query node i to query node j is distances[i * size + j], infinity if there's no path
+    std::vector<double> distances;
+
+    // Path from query node i to query node j is paths[i * size + j], empty if there's no path or no paths were requested
+    std::vector<std::vector<node_type>> paths;
+
+    double distance(size_t i, size_t j) const
+    { return distances[i * size + j]; }
+
+    const std::vector<node_type> &path(size_t i, size_t j) const
+    { return paths[i * size + j]; }
+  };
+
+  // Find the shortest paths between every pair of query nodes by running Dijkstra from each query node
+  // The sources are spread across num_threads worker threads
+  // Query nodes are endpoints: paths never pass through other query nodes
+  // If with_paths is false only the distances are filled in, this saves a lot of memory for large matrices
+  void find_all_shortest_paths(const Graph &graph, const std::vector<node_type> &queries, int num_threads,
+                               PathMatrix &result, bool with_paths = true);
+
+  // Find the shortest path from query node i to query node i + 1, for each i
+  // Each Dijkstra stops as soon as the next query node is settled, and only size - 1 paths are stored
+  // Same threading and endpoint rules as find_all_shortest_paths
+  // distances[i] is infinity and paths[i] is empty if there's no path from query node i to query node i + 1
+  void find_consecutive_shortest_paths(const Graph &graph, const std::vector<node_type> &queries, int num_threads,
+                                       std::vector<double> &distances, std::vector<std::vector<node_type>> &paths);
+
+  // Landmark distance tables for the ALT (A*, landmarks, triangle inequality) heuristic
+  // Computed once per graph and shared by all solvers
+  class Landmarks
+  {
+    size_t num_nodes_;
+
+    // Dense indices of the landmarks
+    std::vector<index_type> landmarks_;
+
+    // Distance from landmark l to node i is distances_[i * size() + l], so the landmarks for a node are contiguous
+    std::vector<double> distances_;
+
+  public:
+
+    // Pick up to k landmarks using farthest-first selection, and run Dijkstra from each
+    Landmarks(const Graph &graph, int k);
+
+    size_t size() const
+    { return landmarks_.size(); }
+
+    index_type landmark(size_t l) const
+    { return landmarks_[l]; }
+
+    double distance(size_t l, index_type index) const
+    { return distances_[index * size() + l]; }
+  };
+
+  // Heuristic: the max of a base heuristic and the landmark bounds
+  // The destination may be in the graph, or connected to the graph by query edges, so the bounds are computed
+  // from the entries, which are the nodes connected to the destination and their distances
+  template<typename Base>
+  class LandmarkHeuristic
+  {
+    Base base_;
+    std::shared_ptr<const Landmarks> landmarks_;
+    index_type destination_ = INVALID_INDEX;
+
+    // For each landmark l, across all entries e:
+    // near_[l] = min(d(l, e) + e.distance), so d(a, destination) >= near_[l] - d(l, a)
+    // far_[l] = max(d(l, e) - e.distance), so d(a, destination) >= d(l, a) - far_[l]
+    std::vector<double> near_;
+    std::vector<double> far_;
+
+  public:
+
+    LandmarkHeuristic(Base base, std::shared_ptr<const Landmarks> landmarks) :
+      base_{std::move(base)},
+      landmarks_{std::move(landmarks)},
+      near_(landmarks_->size()),
+      far_(landmarks_->size())
+    {}
+
+    // Call before each query. If the destination is in the graph, entries can be {Neighbor{destination, 0}}
+    void set_destination(index_type destination, const std::vector<Neighbor> &entries)
+    {
+      destination_ = destination;
+
+      for (size_t l = 0; l < landmarks_->size(); ++l) {
+        near_[l] = std::numeric_limits<double>::infinity();
+        far_[l] = -std::numeric_limits<double>::infinity();
+
+        for (const auto &entry : entries) {
+          double d = landmarks_->distance(l, entry.index);
+          if (!std::isinf(d)) {
+            near_[l] = std::min(near_[l], d + entry.distance);
+            far_[l] = std::max(far_[l], d - entry.distance);
+          }
+        }
+      }
+    }
+
+    double operator()(index_type a, index_type b) const
+    {
+      double h = base_(a, b);
+
+      if (b != destination_) {
+        return h;
+      }
+
+      // Skip landmarks that can't reach a or the destination
+      for (size_t l = 0; l < landmarks_->size(); ++l) {
+        double d = landmarks_->distance(l, a);
+        if (!std::isinf(d) && !std::isinf(near_[l])) {
+          h = std::max(h, std::max(near_[l] - d, d - far_[l]));
+        }
+      }
+
+      return h;
+    }
   };
 
 } // namespace astar
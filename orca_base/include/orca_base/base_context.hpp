@@ -27,6 +27,7 @@ namespace orca_base
   CXT_MACRO_MEMBER(xy_gain, double, 0.5)                      /* Attenuate joystick inputs  */ \
   CXT_MACRO_MEMBER(yaw_gain, double, 0.3)                     /* Attenuate joystick inputs  */ \
   CXT_MACRO_MEMBER(vertical_gain, double, 0.5)                /* Attenuate joystick inputs  */ \
+  CXT_MACRO_MEMBER(thrust_allocator, bool, true)              /* Allocate thrust by priority, false for the fixed mixing table  */ \
   \
   CXT_MACRO_MEMBER(rov_pressure_pid_kp, double, 0.00024)      /* ROV hold pressure pid Kp  */ \
   CXT_MACRO_MEMBER(rov_pressure_pid_ki, double, 0.00015)      /* ROV hold pressure pid Ki  */ \
@@ -51,6 +52,20 @@ namespace orca_base
   CXT_MACRO_MEMBER(auv_yaw_speed, double, M_PI_4 / 2)         /* AUV rotation speed  */ \
   \
   CXT_MACRO_MEMBER(keep_poses, int, 500)                      /* Max # of poses on filtered_path  */ \
+  CXT_MACRO_MEMBER(rviz_period_ms, int, 500)                  /* Publish rviz markers and paths every n ms, read at startup  */ \
+  \
+  CXT_MACRO_MEMBER(executor_threads, int, 1)                  /* Executor threads, 1 for single-threaded, 0 for 1 per cpu, read at startup  */ \
+  CXT_MACRO_MEMBER(control_thread, bool, false)               /* Run AUV missions on a dedicated thread, read at startup  */ \
+  CXT_MACRO_MEMBER(control_period_ms, int, 20)                /* Control thread period, read at startup  */ \
+  CXT_MACRO_MEMBER(control_priority, int, 0)                  /* Control thread SCHED_FIFO priority, 0 for normal, read at startup  */ \
+  CXT_MACRO_MEMBER(control_cpu, int, -1)                      /* Pin the control thread to this cpu, -1 for any, read at startup  */ \
+  \
+  CXT_MACRO_MEMBER(auv_landmarks, int, 4)                     /* A* landmarks per map, 0 for straight-line only  */ \
+  CXT_MACRO_MEMBER(auv_planning_threads, int, 4)              /* Threads used to plan all legs of a mission  */ \
+  CXT_MACRO_MEMBER(auv_replan_budget, double, 0.01)           /* Max A* time when replanning off course, seconds  */ \
+  CXT_MACRO_MEMBER(auv_sample_segments, bool, false)          /* Sample trajectories when planned, not as they run  */ \
+  CXT_MACRO_MEMBER(auv_spline_trajectory, bool, false)        /* Smooth trajectory through the waypoints  */ \
+  CXT_MACRO_MEMBER(auv_tour_budget, double, 0)                /* Time to find a short tour through the targets, 0 for map order  */ \
   \
   CXT_MACRO_MEMBER(auv_open_water, bool, true)                /* Dead reckoning between waypoints  */ \
   CXT_MACRO_MEMBER(auv_epsilon_xy, double, 0.1)               /* Deadzone controller epsilon xy  */ \
@@ -1,6 +1,8 @@
 #ifndef ORCA_BASE_BASE_NODE_HPP
 #define ORCA_BASE_BASE_NODE_HPP
 
+#include <mutex>
+
 #include "rclcpp_action/rclcpp_action.hpp"
 
 #include "fiducial_vlam_msgs/msg/map.hpp"
@@ -16,9 +18,13 @@
 #include "orca_shared/monotonic.hpp"
 
 #include "orca_base/base_context.hpp"
+#include "orca_base/control_thread.hpp"
+#include "orca_base/latest_slot.hpp"
 #include "orca_base/map.hpp"
 #include "orca_base/mission.hpp"
 #include "orca_base/joystick.hpp"
+#include "orca_base/ring_buffer.hpp"
+#include "orca_base/thrusters.hpp"
 
 using namespace std::chrono_literals;
 
@@ -53,20 +59,6 @@ namespace orca_base
     return mode >= Control::AUV_KEEP_STATION;
   }
 
-  //=============================================================================
-  // Thrusters
-  //=============================================================================
-
-  struct Thruster
-  {
-    std::string frame_id;   // URDF link frame id
-    bool ccw;               // True if counterclockwise
-    double forward_factor;
-    double strafe_factor;
-    double yaw_factor;
-    double vertical_factor;
-  };
-
   //=============================================================================
   // BaseNode
   //=============================================================================
@@ -80,16 +72,6 @@ namespace orca_base
     const rclcpp::Duration BARO_TIMEOUT{RCL_S_TO_NS(1)};  // Holding z: disarm if we lose barometer
     const std::chrono::milliseconds SPIN_PERIOD{100ms};   // Check timeouts at 10Hz
 
-    // Thrusters, order must match the order of the <thruster> tags in the URDF
-    const std::vector<Thruster> THRUSTERS = {
-      {"t200_link_front_right",    false, 1.0, 1.0,  1.0,  0.0},
-      {"t200_link_front_left",     false, 1.0, -1.0, -1.0, 0.0},
-      {"t200_link_rear_right",     true,  1.0, -1.0, 1.0,  0.0},
-      {"t200_link_rear_left",      true,  1.0, 1.0,  -1.0, 0.0},
-      {"t200_link_vertical_right", false, 0.0, 0.0,  0.0,  1.0},
-      {"t200_link_vertical_left",  true,  0.0, 0.0,  0.0,  -1.0},
-    };
-
     // Joystick assignments
     const int joy_axis_yaw_ = JOY_AXIS_LEFT_LR;
     const int joy_axis_forward_ = JOY_AXIS_LEFT_FB;
@@ -113,6 +95,9 @@ namespace orca_base
     // Parameters and dynamics model
     BaseContext cxt_;
 
+    // Parameter changes, only used by the parameter callback
+    BaseContext new_cxt_;
+
     // Mode
     uint8_t mode_{orca_msgs::msg::Control::DISARMED};
 
@@ -132,12 +117,44 @@ namespace orca_base
 
     // AUV operation
     std::shared_ptr<Mission> mission_;            // The mission we're running
-    Map map_;                                     // Map of fiducial markers
-    nav_msgs::msg::Path filtered_path_;           // Estimate of the actual path (from filtered_pose_)
+    std::shared_ptr<Mission> retired_mission_;    // Finished mission, destroyed without the lock
+    uint8_t pending_mode_{orca_msgs::msg::Control::DISARMED};  // AUV mode requested by joy_callback
+    std::mutex path_mutex_;                       // Guards filtered_poses_, held while publish_rviz copies it
+    RingBuffer<orca::PoseStamped> filtered_poses_;  // Estimate of the actual path (from filtered_pose_)
+    nav_msgs::msg::Path filtered_path_;           // Re-used to publish filtered_poses_, only used by publish_rviz
+    int planned_path_seq_{-1};                    // Most recent planned path published
 
     // Outputs
     int tilt_{};                                  // Camera tilt
     int brightness_{};                            // Lights
+    Thrusters thrusters_;                         // Thruster configuration and most recent efforts
+
+    // Messages are re-used, so the control loop doesn't allocate
+    orca_msgs::msg::Control control_msg_;
+    visualization_msgs::msg::MarkerArray thrust_markers_msg_;
+
+    // The executor thread(s) and the control thread share the node state, callbacks that touch the state
+    // hold state_mutex_. The map and the recorded path have their own locks. The control thread may run at
+    // SCHED_FIFO priority, so this is a priority inheritance mutex, and it's only held for short sections:
+    // maps and planners are built without it, and missions are destroyed without it.
+    PiMutex state_mutex_;
+
+    // Map of fiducial markers, owned by map_callback, which rebuilds it without holding any locks
+    Map map_;
+
+    // Copy of map_ for everyone else, swapped under map_mutex_, the copy shares the marker graph
+    std::mutex map_mutex_;
+    std::shared_ptr<const Map> latest_map_;
+
+    // Control thread, optional
+    // Odometry is passed to the control thread through odom_slot_, without the lock
+    LatestSlot<nav_msgs::msg::Odometry> odom_slot_;
+    nav_msgs::msg::Odometry::SharedPtr odom_msg_{std::make_shared<nav_msgs::msg::Odometry>()};  // Control thread copy
+    ControlThread control_thread_;
+
+    // Callback groups
+    rclcpp::callback_group::CallbackGroup::SharedPtr control_group_;
+    rclcpp::callback_group::CallbackGroup::SharedPtr housekeeping_group_;
 
     // Subscriptions
     rclcpp::Subscription<orca_msgs::msg::Barometer>::SharedPtr baro_sub_;
@@ -148,12 +165,16 @@ namespace orca_base
     rclcpp::Subscription<fiducial_vlam_msgs::msg::Map>::SharedPtr map_sub_;
     rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
 
-    // Timer
+    // Timers
     rclcpp::TimerBase::SharedPtr spin_timer_;
+    rclcpp::TimerBase::SharedPtr rviz_timer_;
 
     // Validate parameters
     void validate_parameters();
 
+    // Copy parameter changes to cxt_ and validate them, takes state_mutex_
+    void parameters_changed();
+
     // Subscription callbacks
     void baro_callback(orca_msgs::msg::Barometer::SharedPtr msg, bool first);
 
@@ -170,10 +191,10 @@ namespace orca_base
     void odom_callback(nav_msgs::msg::Odometry::SharedPtr msg, bool first);
 
     // Callback wrappers
-    monotonic::Monotonic<BaseNode *, const orca_msgs::msg::Barometer::SharedPtr> baro_cb_{this, &BaseNode::baro_callback};
-    monotonic::Monotonic<BaseNode *, sensor_msgs::msg::Joy::SharedPtr> joy_cb_{this, &BaseNode::joy_callback};
-    monotonic::Valid<BaseNode *, fiducial_vlam_msgs::msg::Map::SharedPtr> map_cb_{this, &BaseNode::map_callback};
-    monotonic::Monotonic<BaseNode *, nav_msgs::msg::Odometry::SharedPtr> odom_cb_{this, &BaseNode::odom_callback};
+    monotonic::MonotonicMember<BaseNode, orca_msgs::msg::Barometer::SharedPtr, &BaseNode::baro_callback> baro_cb_{this};
+    monotonic::MonotonicMember<BaseNode, sensor_msgs::msg::Joy::SharedPtr, &BaseNode::joy_callback> joy_cb_{this};
+    monotonic::ValidMember<BaseNode, fiducial_vlam_msgs::msg::Map::SharedPtr, &BaseNode::map_callback> map_cb_{this};
+    monotonic::MonotonicMember<BaseNode, nav_msgs::msg::Odometry::SharedPtr, &BaseNode::odom_callback> odom_cb_{this};
 
     // Publications
     rclcpp::Publisher<orca_msgs::msg::Control>::SharedPtr control_pub_;
@@ -193,6 +214,8 @@ namespace orca_base
 
     void mission_accepted(std::shared_ptr<rclcpp_action::ServerGoalHandle<orca_msgs::action::Mission>> goal_handle);
 
+    void control_tick(double dt, const LoopStats &stats);
+
     void rov_advance(const rclcpp::Time &stamp);
 
     void auv_advance(double dt);
@@ -203,8 +226,23 @@ namespace orca_base
 
     void disarm(const rclcpp::Time &msg_time);
 
-    void set_mode(const rclcpp::Time &msg_time, uint8_t new_mode, const orca::Pose &goal = {},
-                  const std::shared_ptr<rclcpp_action::ServerGoalHandle<orca_msgs::action::Mission>> &goal_handle = nullptr);
+    // Change to a disarmed or ROV mode, call with state_mutex_ held
+    void set_mode(const rclcpp::Time &msg_time, uint8_t new_mode);
+
+    // Start an AUV mission, call without state_mutex_ held
+    void start_mission(const rclcpp::Time &msg_time, uint8_t new_mode, const orca::Pose &goal = {},
+                       const std::shared_ptr<rclcpp_action::ServerGoalHandle<orca_msgs::action::Mission>> &goal_handle = nullptr);
+
+    // Destroy a finished mission, call without state_mutex_ held
+    void release_retired_mission();
+
+    std::shared_ptr<const Map> latest_map();
+
+    bool map_ok()
+    {
+      auto map = latest_map();
+      return map && map->ok();
+    }
 
     bool disarmed()
     { return is_disarmed_mode(mode_); }
@@ -219,20 +257,25 @@ namespace orca_base
     { return is_auv_mode(mode_); }
 
     bool baro_ok(const rclcpp::Time &t)
-    { return baro_cb_.receiving() && t - baro_cb_.prev() < BARO_TIMEOUT; }
+    { return baro_cb_.receiving() && t.nanoseconds() - baro_cb_.prev_ns() < BARO_TIMEOUT.nanoseconds(); }
 
     bool joy_ok(const rclcpp::Time &t)
-    { return joy_cb_.receiving() && t - joy_cb_.prev() < JOY_TIMEOUT; }
+    { return joy_cb_.receiving() && t.nanoseconds() - joy_cb_.prev_ns() < JOY_TIMEOUT.nanoseconds(); }
 
     bool odom_ok(const rclcpp::Time &t)
-    { return odom_cb_.receiving() && t - odom_cb_.prev() < ODOM_TIMEOUT; }
+    { return odom_cb_.receiving() && t.nanoseconds() - odom_cb_.prev_ns() < ODOM_TIMEOUT.nanoseconds(); }
 
   public:
     explicit BaseNode();
 
-    ~BaseNode() override = default;
+    ~BaseNode() override;
 
     void spin_once();
+
+    void publish_rviz();
+
+    int executor_threads() const
+    { return cxt_.executor_threads_; }
   };
 
 } // namespace orca_base
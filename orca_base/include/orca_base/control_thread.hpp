@@ -0,0 +1,123 @@
+#ifndef ORCA_BASE_CONTROL_THREAD_HPP
+#define ORCA_BASE_CONTROL_THREAD_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include <pthread.h>
+
+#include "rclcpp/rclcpp.hpp"
+
+namespace orca_base
+{
+
+  //=====================================================================================
+  // LoopStats measures how late each tick of a fixed-rate loop started
+  //=====================================================================================
+
+  struct LoopStats
+  {
+    uint32_t ticks{0};
+    uint32_t overruns{0};       // Ticks that started more than a period late
+    double jitter{0};           // Lateness of the most recent tick, seconds
+    double jitter_mean{0};
+    double jitter_max{0};
+
+    void add(double lateness, bool overrun)
+    {
+      ++ticks;
+      if (overrun) {
+        ++overruns;
+      }
+      jitter = lateness;
+      jitter_mean += (lateness - jitter_mean) / ticks;
+      jitter_max = std::max(jitter_max, lateness);
+    }
+  };
+
+  //=====================================================================================
+  // PiMutex is a pthread mutex with priority inheritance, use it for locks that the
+  // control thread shares with normal priority threads: a thread that holds the lock
+  // runs at the control thread's priority until it releases it, so a busy normal
+  // priority thread can't hold up the control thread indefinitely.
+  //
+  // Meets the Lockable requirements, so it works with std::lock_guard and std::unique_lock.
+  //=====================================================================================
+
+  class PiMutex
+  {
+    pthread_mutex_t mutex_;
+
+  public:
+
+    PiMutex();
+
+    ~PiMutex();
+
+    PiMutex(const PiMutex &) = delete;
+
+    PiMutex &operator=(const PiMutex &) = delete;
+
+    void lock()
+    { pthread_mutex_lock(&mutex_); }
+
+    bool try_lock()
+    { return pthread_mutex_trylock(&mutex_) == 0; }
+
+    void unlock()
+    { pthread_mutex_unlock(&mutex_); }
+  };
+
+  //=====================================================================================
+  // ControlThread calls tick() at a fixed rate on a dedicated thread
+  //
+  // The thread can be pinned to a cpu and run at a SCHED_FIFO priority. These usually
+  // require privileges (e.g., CAP_SYS_NICE or an rtprio limit), if they fail the thread
+  // logs a warning and runs anyway.
+  //
+  // If a tick starts more than a period late the missed ticks are skipped, not run back
+  // to back.
+  //=====================================================================================
+
+  class ControlThread
+  {
+  public:
+
+    // Called with the time since the previous tick (seconds) and the loop stats, including this tick
+    using Tick = std::function<void(double dt, const LoopStats &stats)>;
+
+  private:
+
+    const rclcpp::Logger logger_;
+    std::chrono::nanoseconds period_{};
+    int priority_{0};
+    int cpu_{-1};
+    Tick tick_;
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    LoopStats stats_;                     // Owned by the thread until it's joined
+
+    void run();
+
+  public:
+
+    explicit ControlThread(const rclcpp::Logger &logger) : logger_{logger}
+    {}
+
+    ~ControlThread()
+    { stop(); }
+
+    // Start the thread. If priority > 0 use SCHED_FIFO at that priority, if cpu >= 0 pin the thread to that cpu
+    void start(std::chrono::nanoseconds period, int priority, int cpu, Tick tick);
+
+    // Stop and join the thread, log the stats
+    void stop();
+  };
+
+} // namespace orca_base
+
+#endif //ORCA_BASE_CONTROL_THREAD_HPP
@@ -0,0 +1,53 @@
+#ifndef ORCA_BASE_LATEST_SLOT_HPP
+#define ORCA_BASE_LATEST_SLOT_HPP
+
+#include <atomic>
+#include <cstdint>
+
+namespace orca_base
+{
+
+  //=====================================================================================
+  // LatestSlot passes the most recent item from one writer thread to one reader thread
+  //
+  // This is a triple buffer: the writer fills the back buffer, the reader copies from the
+  // front buffer, and the two swap with the middle buffer using a single atomic exchange.
+  // Neither side blocks or allocates (if T::operator= doesn't allocate), and the reader
+  // skips items that were overwritten before it got to them.
+  //=====================================================================================
+
+  template<typename T>
+  class LatestSlot
+  {
+    static constexpr uint8_t NEW = 4;   // Set in middle_ if the middle buffer hasn't been read
+
+    T buffers_[3];
+    std::atomic<uint8_t> middle_{1};    // Index of the middle buffer, | NEW
+    uint8_t back_{0};                   // Writer only
+    uint8_t front_{2};                  // Reader only
+
+  public:
+
+    // Called on the writer thread
+    void write(const T &item)
+    {
+      buffers_[back_] = item;
+      back_ = middle_.exchange(back_ | NEW, std::memory_order_acq_rel) & ~NEW;
+    }
+
+    // Called on the reader thread, copy the newest item and return true, or return false if there's nothing new
+    bool read(T &item)
+    {
+      if (!(middle_.load(std::memory_order_relaxed) & NEW)) {
+        return false;
+      }
+
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & ~NEW;
+      item = buffers_[front_];
+      return true;
+    }
+  };
+
+} // namespace orca_base
+
+#endif //ORCA_BASE_LATEST_SLOT_HPP
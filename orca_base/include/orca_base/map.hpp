@@ -1,16 +1,67 @@
 #ifndef ORCA_BASE_MAP_HPP
 #define ORCA_BASE_MAP_HPP
 
+#include <map>
+#include <mutex>
+
 #include "fiducial_vlam_msgs/msg/map.hpp"
 
 #include "orca_shared/geometry.hpp"
 
 #include "orca_base/astar.hpp"
 #include "orca_base/base_context.hpp"
+#include "orca_base/spatial_grid.hpp"
 
 namespace orca_base
 {
 
+  // Markers and the short paths between them, shared by all copies of Map
+  // Built once per set of marker ids, and patched when markers move
+  struct MarkerGraph
+  {
+    // Marker poses, indexed by marker id
+    std::map<astar::node_type, orca::Pose> poses;
+
+    // Marker xy positions, the cell size is MAX_DEAD_RECKONING_DISTANCE
+    SpatialGrid grid;
+
+    // Markers that are < MAX_DEAD_RECKONING_DISTANCE apart are connected
+    std::shared_ptr<const astar::Graph> graph;
+
+    // Marker xy positions, indexed by dense index, read by the A* heuristic
+    std::vector<astar::XY> xy;
+
+    // Number of landmarks to pick
+    int num_landmarks;
+
+    explicit MarkerGraph(int _num_landmarks) : num_landmarks{_num_landmarks}
+    {}
+
+    // Landmark distance tables, used to tighten the A* heuristic
+    // Computed on first use: k Dijkstras per update would be wasted if the markers move again before the next query
+    const std::shared_ptr<const astar::Landmarks> &landmarks() const;
+
+  private:
+
+    mutable std::once_flag landmarks_flag_;
+    mutable std::shared_ptr<const astar::Landmarks> landmarks_;
+  };
+
+  // Waypoints between every pair of a set of poses
+  struct WaypointMatrix
+  {
+    size_t size{0};
+
+    // Length of the path from pose i to pose j is distances[i * size + j], infinity if there's no path
+    std::vector<double> distances;
+
+    // Waypoints from pose i to pose j are waypoints[i * size + j], empty if there's no path or no waypoints were requested
+    std::vector<std::vector<orca::Pose>> waypoints;
+
+    const std::vector<orca::Pose> &get(size_t i, size_t j) const
+    { return waypoints[i * size + j]; }
+  };
+
   class Map
   {
     rclcpp::Logger logger_;
@@ -19,25 +70,103 @@ namespace orca_base
     // Marker map from vlam
     fiducial_vlam_msgs::msg::Map::SharedPtr vlam_map_;
 
+    // Marker graph, rebuilt when the marker ids change, patched when markers move
+    std::shared_ptr<const MarkerGraph> marker_graph_;
+
+    // A* solver and per-query state, re-used across calls to get_waypoints, but not shared between copies of Map
+    struct Query
+    {
+      std::shared_ptr<const MarkerGraph> marker_graph;
+      orca::Pose start;
+      orca::Pose destination;
+      std::vector<astar::Edge> edges;             // Edges that connect the start and destination to the graph
+      std::vector<astar::XY> xy;                  // Copy of marker_graph->xy with the start and destination filled in
+      std::vector<astar::Neighbor> entries;       // Markers connected to the destination
+      std::unique_ptr<astar::Solver<astar::LandmarkHeuristic<astar::EuclideanXY>>> solver;
+
+      const orca::Pose &pose(astar::node_type node) const;
+    };
+
+    mutable std::unique_ptr<Query> query_;
+
+    // Set up query_ to find a path from start_pose to destination_pose
+    void set_query(const orca::Pose &start_pose, const orca::Pose &destination_pose) const;
+
+    // Incremental solver for replans to the same destination, repaired as the markers move
+    struct Replan
+    {
+      std::shared_ptr<const MarkerGraph> marker_graph;  // Marker graph the solver is in sync with
+      orca::Pose start;
+      orca::Pose destination;
+      std::vector<astar::XY> xy;                        // Copy of marker_graph->xy with the start and destination
+      std::vector<astar::node_type> start_neighbors;    // Markers connected to the start
+      std::unique_ptr<astar::IncrementalSolver<astar::EuclideanXY>> solver;
+
+      const orca::Pose &pose(astar::node_type node) const;
+    };
+
+    mutable std::unique_ptr<Replan> replan_;
+
+    // Push the markers that moved to the incremental solver
+    void update_replan(const std::vector<astar::node_type> &moved);
+
+    // True if the last query or replan was to this destination
+    bool same_destination(const orca::Pose &destination_pose) const;
+
+    // Use the incremental solver to generate a path
+    // If budget (seconds) is > 0 and runs out, set timed_out and return false, the next call resumes the search
+    bool replan_waypoints(const orca::Pose &start_pose, const orca::Pose &destination_pose,
+                          std::vector<orca::Pose> &waypoints, double budget, bool &timed_out) const;
+
   public:
 
     explicit Map(const rclcpp::Logger &logger, const BaseContext &cxt) : logger_{logger}, cxt_{cxt}
     {}
 
-    // Initialize or update the map
-    void set_vlam_map(fiducial_vlam_msgs::msg::Map::SharedPtr map)
-    { vlam_map_ = std::move(map); }
+    // Copies share the marker graph, but not the solver
+    Map(const Map &that) :
+      logger_{that.logger_}, cxt_{that.cxt_}, vlam_map_{that.vlam_map_}, marker_graph_{that.marker_graph_}
+    {}
+
+    // Copy that reads a different set of parameters, e.g., a planner's private copy
+    Map(const Map &that, const BaseContext &cxt) :
+      logger_{that.logger_}, cxt_{cxt}, vlam_map_{that.vlam_map_}, marker_graph_{that.marker_graph_}
+    {}
+
+    Map(Map &&that) = default;
+
+    // Initialize or update the map, return true if the markers changed
+    bool set_vlam_map(fiducial_vlam_msgs::msg::Map::SharedPtr map);
 
     // Get the map
     fiducial_vlam_msgs::msg::Map::SharedPtr vlam_map() const
     { return vlam_map_; }
 
     // True if we have a good map
-    bool ok()
+    bool ok() const
     { return vlam_map_ != nullptr; }
 
+    // Find the marker nearest to pose, return false if there are no markers
+    bool nearest_marker(const orca::Pose &pose, int &id, orca::Pose &marker_pose) const;
+
     // Use A* to generate a path from start_pose to destination_pose that stays close to the markers
+    // Replans to the same destination re-use the search tree, and only repair the parts affected by marker changes
     bool get_waypoints(const orca::Pose &start_pose, const orca::Pose &destination_pose, std::vector<orca::Pose> &waypoints) const;
+
+    // Anytime version of get_waypoints: return the best path found within budget seconds,
+    // set optimal to true if the path is provably optimal
+    // Replans to the same destination try the incremental solver first, with half of the budget
+    bool get_waypoints(const orca::Pose &start_pose, const orca::Pose &destination_pose,
+                       std::vector<orca::Pose> &waypoints, double budget, bool &optimal) const;
+
+    // Generate paths between every pair of poses in one pass, e.g., to plan all legs of a mission up front
+    // If with_waypoints is false only the distances are filled in
+    bool get_waypoint_matrix(const std::vector<orca::Pose> &poses, WaypointMatrix &matrix,
+                             bool with_waypoints = true) const;
+
+    // Generate the path from each pose to the next one, e.g., to plan the legs of a mission up front
+    // legs[i] is the waypoints from poses[i] to poses[i + 1], empty if there's no path
+    bool get_leg_waypoints(const std::vector<orca::Pose> &poses, std::vector<std::vector<orca::Pose>> &legs) const;
   };
 
 } // namespace orca_base
@@ -15,7 +15,7 @@ namespace orca_base
   class Mission
   {
     rclcpp::Logger logger_;                               // ROS logger
-    const BaseContext &cxt_;                              // Parameters
+    const BaseContext &cxt_;                              // Parameters, owned by the planner
     std::shared_ptr<PlannerBase> planner_;                // Path planner
 
     // Mission action state
@@ -24,13 +24,25 @@ namespace orca_base
 
   public:
 
-    Mission(const rclcpp::Logger &logger, const BaseContext &cxt,
+    // Start the planner, the mission runs with the planner's copy of the parameters
+    Mission(const rclcpp::Logger &logger,
             std::shared_ptr<rclcpp_action::ServerGoalHandle<orca_msgs::action::Mission>> goal_handle,
             std::shared_ptr<PlannerBase> planner, const orca::PoseStamped &start);
 
     const nav_msgs::msg::Path &planned_path() const
     { return planner_->planned_path(); }
 
+    int planned_path_seq() const
+    { return planner_->planned_path_seq(); }
+
+    // Plan latency and swap counts
+    PlannerDiagnostics planner_diagnostics() const
+    { return planner_->diagnostics(); }
+
+    // Update the map
+    void set_vlam_map(fiducial_vlam_msgs::msg::Map::SharedPtr map)
+    { planner_->set_vlam_map(std::move(map)); }
+
     // Advance the plan, return true to continue
     bool advance(double dt, orca::Pose &plan, const nav_msgs::msg::Odometry &estimate, orca::Acceleration &u_bar);
 
@@ -16,6 +16,24 @@ namespace pid
     }
   }
 
+  // Ziegler–Nichols gains
+  // https://en.wikipedia.org/wiki/Ziegler%E2%80%93Nichols_method
+  inline void ziegler_nichols(double Ku, double Tu, double &Kp, double &Ki, double &Kd)
+  {
+#ifdef CLASSIC
+    // Classic
+    Kp = 0.6 * Ku;
+    Ki = 1.2 * Ku / Tu;
+    Kd = 3 * Ku * Tu / 40;
+#else
+    // P controller
+    // This isn't perfect, but it's stable
+    Kp = 0.5 * Ku;
+    Ki = 0;
+    Kd = 0;
+#endif
+  }
+
   class Controller
   {
   private:
@@ -40,23 +58,10 @@ namespace pid
     }
 
     // Ziegler–Nichols constructor
-    // https://en.wikipedia.org/wiki/Ziegler%E2%80%93Nichols_method
     Controller(bool angle, double Ku, double Tu)
     {
       angle_ = angle;
-
-#ifdef CLASSIC
-      // Classic
-      Kp_ = 0.6 * Ku;
-      Ki_ = 1.2 * Ku / Tu;
-      Kd_ = 3 * Ku * Tu / 40;
-#else
-      // P controller
-      // This isn't perfect, but it's stable
-      Kp_ = 0.5 * Ku;
-      Ki_ = 0;
-      Kd_ = 0;
-#endif
+      ziegler_nichols(Ku, Tu, Kp_, Ki_, Kd_);
     }
 
     // Set target
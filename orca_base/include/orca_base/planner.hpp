@@ -1,6 +1,13 @@
 #ifndef ORCA_BASE_PLANNER_HPP
 #define ORCA_BASE_PLANNER_HPP
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "orca_base/control_thread.hpp"
 #include "orca_base/map.hpp"
 #include "orca_base/segment.hpp"
 
@@ -14,54 +21,298 @@ namespace orca_base
     static constexpr int FAILURE = 2;
   };
 
+  //=====================================================================================
+  // Plan -- a trajectory to a single target
+  //
+  // Segments and controllers are stored by value. There's no std::variant in C++14, so
+  // each segment type has its own vector, and order_ lists the segments in sequence.
+  // clear() keeps the capacity, so a re-used Plan stops allocating once it's big enough.
+  // erase() leaves garbage in the storage, compact() drops it when it piles up.
+  //
+  // Sampled segments point into samples_, and spline segments point into spline_legs_,
+  // so a Plan can't be copied or moved.
+  //=====================================================================================
+
+  class Plan
+  {
+    enum class Type
+    {
+      PAUSE, VERTICAL, ROTATE, LINE, SPLINE
+    };
+
+    struct Entry
+    {
+      Type type;
+      size_t index;
+    };
+
+    std::vector<Pause> pauses_;
+    std::vector<VerticalSegment> vertical_segments_;
+    std::vector<RotateSegment> rotate_segments_;
+    std::vector<LineSegment> line_segments_;
+    std::vector<SplineSegment> spline_segments_;
+    std::vector<Entry> order_;
+    std::vector<SegmentSample> samples_;
+    std::vector<SplineLeg> spline_legs_;
+
+    // Spare storage for compact(), kept so that compaction stops allocating
+    std::vector<Pause> spare_pauses_;
+    std::vector<VerticalSegment> spare_vertical_segments_;
+    std::vector<RotateSegment> spare_rotate_segments_;
+    std::vector<LineSegment> spare_line_segments_;
+    std::vector<SplineSegment> spare_spline_segments_;
+    std::vector<SegmentSample> spare_samples_;
+    std::vector<SplineLeg> spare_spline_legs_;
+
+    // Finish adding segments.back(): add it to order_, add a controller, and sample it if requested
+    template<typename T>
+    void push(std::vector<T> &segments, Type type, const BaseContext &cxt, bool sample)
+    {
+      order_.push_back(Entry{type, segments.size() - 1});
+      controllers.emplace_back(cxt);
+      if (sample) {
+        segments.back().sample(samples_);
+      }
+    }
+
+    // Copy the segments of this type that are still in order_ to spare, and swap
+    template<typename T>
+    void compact_segments(std::vector<T> &segments, std::vector<T> &spare, Type type)
+    {
+      spare.clear();
+      for (auto &entry : order_) {
+        if (entry.type == type) {
+          spare.push_back(segments[entry.index]);
+          entry.index = spare.size() - 1;
+        }
+      }
+      segments.swap(spare);
+    }
+
+  public:
+
+    int target_idx{0};                                          // Target
+    std::vector<SimpleController> controllers;                  // Controllers, 1 per segment
+    nav_msgs::msg::Path path;                                   // Path for rviz
+
+    Plan() = default;
+
+    Plan(const Plan &) = delete;
+
+    Plan &operator=(const Plan &) = delete;
+
+    // Remove all segments and controllers, keep the memory
+    void clear();
+
+    size_t size() const
+    { return order_.size(); }
+
+    bool empty() const
+    { return order_.empty(); }
+
+    SegmentBase &segment(size_t i);
+
+    SegmentBase &back()
+    { return segment(size() - 1); }
+
+    bool is_pause(size_t i) const
+    { return order_[i].type == Type::PAUSE; }
+
+    bool is_spline(size_t i) const
+    { return order_[i].type == Type::SPLINE; }
+
+    SplineSegment &spline_segment(size_t i)
+    {
+      assert(is_spline(i));
+      return spline_segments_[order_[i].index];
+    }
+
+    // Move the last n segments and their controllers to position i
+    void move_back(size_t n, size_t i);
+
+    // Remove n segments and controllers starting at position i, the storage isn't re-used until compact() or clear()
+    void erase(size_t i, size_t n);
+
+    // Drop segments, samples and spline legs left behind by erase() and extend(), if they're at least half of
+    // the storage. The cost is amortized over the splices that made the garbage.
+    void compact();
+
+    void add_pause(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start, double seconds);
+
+    void add_vertical_segment(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start,
+                              const orca::Pose &goal);
+
+    void add_rotate_segment(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start,
+                            const orca::Pose &goal);
+
+    void add_line_segment(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start,
+                          const orca::Pose &goal);
+
+    // Splines are polynomials, so they're never sampled
+    void add_spline_segment(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start,
+                            const std::vector<orca::Pose> &waypoints, const orca::Pose &goal);
+  };
+
+  //=====================================================================================
+  // PlannerDiagnostics
+  //=====================================================================================
+
+  struct PlannerDiagnostics
+  {
+    int plans_requested{0};                                     // Plans requested by the control thread
+    int plans_swapped{0};                                       // Plans swapped in by the control thread
+    double last_latency{0};                                     // Seconds from request to ready, most recent plan
+    double max_latency{0};                                      // Seconds from request to ready, worst case
+  };
+
   //=====================================================================================
   // PlannerBase
+  //
+  // Planning runs on a worker thread. The control thread keeps following the current
+  // plan (or keeps station at the end of it) while the next plan is built, then swaps
+  // the new plan in and starts at its first segment.
+  //
+  // The planner copies the parameters when it's created, the worker thread, the control
+  // thread and the segments all read this copy, so parameter updates can't race with
+  // planning. Updates take effect with the next planner.
+  //
+  // Call start() after the derived constructor has set up the targets.
   //=====================================================================================
 
   class PlannerBase
   {
-    std::vector<std::shared_ptr<SegmentBase>> segments_;        // Trajectory segments
-    std::vector<std::shared_ptr<ControllerBase>> controllers_;  // Trajectory controllers
-
+    // Plan request, passed from the control thread to the worker thread
+    struct Request
+    {
+      orca::PoseStamped start;
+      int target_idx;
+      double budget;
+      std::chrono::steady_clock::time_point requested;
+    };
+
+    // Plans are swapped between threads by swapping pointers:
+    //    plan_ is owned by the control thread
+    //    next_plan_ is guarded by mutex_
+    //    building_ is owned by the worker thread
+    // Once the capacity of all 3 plans is large enough, planning doesn't allocate.
+    std::unique_ptr<Plan> plan_;                                // Current plan
+    std::unique_ptr<Plan> next_plan_;                           // Plan waiting to be swapped in
+    std::unique_ptr<Plan> building_;                            // Plan under construction
+
+    // Control thread state
     int target_idx_;                                            // Current target
     int segment_idx_;                                           // Current segment
+    int splice_end_;                                            // End of the most recent splice
+    bool waiting_;                                              // True if a plan has been requested but not swapped in
+    bool replanning_;                                           // True if the requested plan is an off-course replan
+    bool holding_;                                              // True if the current plan is done, keeping station
+    int path_seq_;                                              // Incremented each time the planned path changes
+
+    // Worker thread state, guarded by mutex_
+    // The control thread takes mutex_ to request plans, swap them in and read the diagnostics, the worker only
+    // holds it for short sections, and it's a priority inheritance mutex so the worker can't be preempted holding it
+    PiMutex mutex_;
+    std::condition_variable_any cv_;
+    bool stop_;                                                 // Shut down the worker
+    bool request_pending_;                                      // Plan request is pending
+    Request request_;                                           // Pending plan request
+    bool legs_pending_;                                         // Legs need to be (re-)planned
+    fiducial_vlam_msgs::msg::Map::SharedPtr map_pending_;       // New map, if any
+    PlannerDiagnostics diagnostics_;
+
+    std::atomic<bool> next_plan_ready_;                         // Lets the control thread skip the lock
+    std::thread worker_;
 
-    nav_msgs::msg::Path planned_path_;                          // Path for rviz
+    // Worker thread only
+    std::vector<std::vector<orca::Pose>> legs_;                 // legs_[i] is target i to target i + 1, if pre-planned
+    std::vector<orca::Pose> waypoints_;                         // Waypoints for the plan under construction
+    std::vector<orca::Pose> prev_waypoints_;                    // Waypoints for the most recent plan
+    int prev_target_idx_{-1};                                   // Target for the most recent plan
 
-    void add_keep_station_segment(orca::Pose &plan, double seconds);
+    void add_keep_station_segment(Plan &plan, orca::Pose &pose, double seconds);
 
-    void add_vertical_segment(orca::Pose &plan, double z);
+    void add_vertical_segment(Plan &plan, orca::Pose &pose, double z);
 
-    void add_rotate_segment(orca::Pose &plan, double yaw);
+    void add_rotate_segment(Plan &plan, orca::Pose &pose, double yaw);
 
-    void add_line_segment(orca::Pose &plan, double x, double y);
+    void add_line_segment(Plan &plan, orca::Pose &pose, double x, double y);
+
+    // Travel to a waypoint: ascend/descend, point in the direction of travel, travel
+    void add_travel_segments(Plan &plan, orca::Pose &pose, const orca::Pose &waypoint);
+
+    // Set the path for rviz
+    void set_path(Plan &plan, const rclcpp::Time &t);
+
+    // Splice a new trajectory from pose into the current plan, keeping the rest of the plan
+    // Return false if the current plan can't be spliced
+    bool splice(const orca::Pose &pose);
+
+    // Rejoin the waypoints of the most recent plan to this target, return false if there's no such plan
+    bool rejoin_prev_waypoints(const orca::Pose &start, int target_idx);
 
     // Plan a trajectory through a series of waypoints
-    void plan_trajectory(const std::vector<orca::Pose> &waypoints, const orca::PoseStamped &start);
+    void plan_trajectory(const std::vector<orca::Pose> &waypoints, const orca::PoseStamped &start, Plan &plan);
+
+    // Plan a trajectory to targets_[request.target_idx]
+    // If budget > 0, limit the time spent in A* to budget seconds, the path may not be optimal
+    void plan_trajectory(const Request &request, Plan &plan);
+
+    // Plan the paths between all targets
+    void plan_legs_now();
+
+    // Worker thread main loop
+    void run_worker();
+
+    // Ask the worker for a plan to targets_[target_idx_]
+    void request_plan(const orca::PoseStamped &start, double budget = 0);
+
+    // Swap in the next plan, called on the control thread
+    // Off-course replans are swapped in mid-segment, the controller state carries over
+    void swap_plan();
 
   protected:
 
     rclcpp::Logger logger_;
-    const BaseContext &cxt_;
-    Map map_;
+    const BaseContext cxt_;                                     // Copy of the parameters, never changes
+    Map map_;                                                   // Owned by the worker thread after start()
 
     std::vector<orca::Pose> targets_;
     bool keep_station_;
 
-    PlannerBase(const rclcpp::Logger &logger, const BaseContext &cxt, Map map, bool keep_station) :
-      logger_{logger}, cxt_{cxt}, map_{std::move(map)}, keep_station_{keep_station}, target_idx_{0}, segment_idx_{0}
-    {}
+    PlannerBase(const rclcpp::Logger &logger, const BaseContext &cxt, Map map, bool keep_station);
+
+    // Re-order targets_ to make a short tour, or shuffle them if random is true
+    void order_targets(bool random);
 
-    // Plan a trajectory to targets_[target_idx_]
-    void plan_trajectory(const orca::PoseStamped &start);
+    // Plan the paths between all targets on the worker thread, call after targets_ is set
+    void plan_legs();
 
   public:
 
+    virtual ~PlannerBase();
+
+    // Start the worker thread, call once after construction
+    void start();
+
+    const BaseContext &cxt() const
+    { return cxt_; }
+
     const std::vector<orca::Pose> &targets() const
     { return targets_; }
 
     const nav_msgs::msg::Path &planned_path() const
-    { return planned_path_; }
+    { return plan_->path; }
+
+    // Changes when planned_path() changes, so callers can skip publishing an unchanged path
+    int planned_path_seq() const
+    { return path_seq_; }
+
+    // Plan latency and swap counts
+    PlannerDiagnostics diagnostics();
+
+    // Update the map, e.g., fiducial_vlam refined the marker poses
+    // The map is handed to the worker thread, this doesn't block
+    void set_vlam_map(fiducial_vlam_msgs::msg::Map::SharedPtr map);
 
     // Advance the plan, return AdvanceRC
     int advance(double dt, orca::Pose &plan, const nav_msgs::msg::Odometry &estimate, orca::Acceleration &u_bar,
@@ -0,0 +1,68 @@
+#ifndef ORCA_BASE_RING_BUFFER_HPP
+#define ORCA_BASE_RING_BUFFER_HPP
+
+#include <vector>
+
+namespace orca_base
+{
+
+  //=====================================================================================
+  // RingBuffer keeps the most recent capacity() items, push() overwrites the oldest item
+  // when the buffer is full. Storage is allocated by reset(), never by push().
+  //=====================================================================================
+
+  template<typename T>
+  class RingBuffer
+  {
+    std::vector<T> items_;
+    size_t next_{0};                  // Position of the next push
+    size_t size_{0};                  // Number of items, <= capacity
+
+  public:
+
+    explicit RingBuffer(size_t capacity = 0) : items_(capacity)
+    {}
+
+    // Remove all items and change the capacity
+    void reset(size_t capacity)
+    {
+      items_.resize(capacity);
+      clear();
+    }
+
+    void clear()
+    {
+      next_ = 0;
+      size_ = 0;
+    }
+
+    size_t capacity() const
+    { return items_.size(); }
+
+    size_t size() const
+    { return size_; }
+
+    bool empty() const
+    { return size_ == 0; }
+
+    void push(const T &item)
+    {
+      if (items_.empty()) {
+        return;
+      }
+
+      items_[next_] = item;
+      next_ = (next_ + 1) % items_.size();
+      if (size_ < items_.size()) {
+        ++size_;
+      }
+    }
+
+    // Item i, 0 is the oldest
+    const T &operator[](size_t i) const
+    { return items_[(next_ + items_.size() - size_ + i) % items_.size()]; }
+  };
+
+} // namespace orca_base
+
+#endif //ORCA_BASE_RING_BUFFER_HPP
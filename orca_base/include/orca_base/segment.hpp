@@ -15,16 +15,39 @@ namespace orca_base
   constexpr double EPSILON_PLAN_XYZ = 0.05;       // Close enough for xyz motion (m)
   constexpr double EPSILON_PLAN_YAW = M_PI / 90;  // Close enough for yaw motion (r)
 
+  //=====================================================================================
+  // SegmentSample is the planned pose, velocity and acceleration at a point in time
+  //=====================================================================================
+
+  struct SegmentSample
+  {
+    orca::Pose plan;
+    orca::Twist twist;
+    orca::Acceleration ff;
+  };
+
   //=====================================================================================
   // Segments describe a trajectory from start to goal over time
+  //
+  // Segments refer to the logger and context, these must outlive the segment.
+  //
+  // If sample() is called the trajectory is integrated once and stored at a fixed rate.
+  // advance() is then a lookup by elapsed time, so the trajectory doesn't depend on the
+  // timing of the calls to advance().
   //=====================================================================================
 
   class SegmentBase
   {
+    std::vector<SegmentSample> *samples_;   // Sample buffer, or nullptr if not sampled
+    size_t first_sample_;                   // First sample for this segment
+    size_t num_samples_;                    // Samples every SAMPLE_DT seconds, the last sample is at duration_
+    double duration_;                       // Time to reach the goal
+    double elapsed_;                        // Time since the segment started
+
   protected:
 
-    rclcpp::Logger logger_;
-    BaseContext cxt_;
+    const rclcpp::Logger &logger_;
+    const BaseContext &cxt_;
 
     // State
     orca::Pose goal_;       // Goal pose
@@ -34,6 +57,12 @@ namespace orca_base
 
     void finish();
 
+    // If the segment was sampled, sample again from the current state
+    void resample();
+
+    // Integrate the motion plan by dt seconds, return true to continue, false if we're done
+    virtual bool step(double dt) = 0;
+
   public:
 
     SegmentBase(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start, const orca::Pose &goal);
@@ -41,7 +70,8 @@ namespace orca_base
     // Write contents to RCLCPP_INFO
     virtual void log_info() = 0;
 
-    // Try to change the goal, return true if it worked
+    // Try to restart the segment at start and change the goal, keeping the current velocity
+    // Return true if it worked
     virtual bool extend(const orca::Pose &start, const orca::Pose &goal)
     { return false; }
 
@@ -57,25 +87,38 @@ namespace orca_base
     const orca::Acceleration &ff() const
     { return ff_; }
 
+    // Sample the trajectory from the current state to the goal, appending to samples
+    // The buffer may be shared by several segments, and must outlive the segment
+    void sample(std::vector<SegmentSample> &samples);
+
+    // Number of samples in the sample buffer, 0 if not sampled
+    size_t num_samples() const
+    { return samples_ ? num_samples_ : 0; }
+
+    // Append the samples to compacted, the caller then copies compacted over the sample buffer
+    void compact_samples(std::vector<SegmentSample> &compacted);
+
     // Advance the motion plan by dt seconds, return true to continue, false if we're done
-    virtual bool advance(double dt) = 0;
+    bool advance(double dt);
   };
 
   //=====================================================================================
-  // Pause stays in one spot for a period of time
+  // Pause stays in one spot for a period of time, there's no need to sample it
   //=====================================================================================
 
   class Pause : public SegmentBase
   {
     double seconds_;
 
+  protected:
+
+    bool step(double dt) override;
+
   public:
 
     Pause(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start, double seconds);
 
     void log_info() override;
-
-    bool advance(double dt) override;
   };
 
   //=====================================================================================
@@ -84,14 +127,16 @@ namespace orca_base
 
   class VerticalSegment : public SegmentBase
   {
+  protected:
+
+    bool step(double dt) override;
+
   public:
 
     VerticalSegment(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start,
                     const orca::Pose &goal);
 
     void log_info() override;
-
-    bool advance(double dt) override;
   };
 
   //=====================================================================================
@@ -100,14 +145,16 @@ namespace orca_base
 
   class RotateSegment : public SegmentBase
   {
+  protected:
+
+    bool step(double dt) override;
+
   public:
 
     RotateSegment(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start,
                   const orca::Pose &goal);
 
     void log_info() override;
-
-    bool advance(double dt) override;
   };
 
   //=====================================================================================
@@ -118,6 +165,10 @@ namespace orca_base
   {
     void init();
 
+  protected:
+
+    bool step(double dt) override;
+
   public:
 
     LineSegment(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start, const orca::Pose &goal);
@@ -125,8 +176,77 @@ namespace orca_base
     void log_info() override;
 
     bool extend(const orca::Pose &start, const orca::Pose &goal) override;
+  };
+
+  //=====================================================================================
+  // SplineLeg is a quintic polynomial in x, y and z from one waypoint to the next
+  //=====================================================================================
+
+  struct SplineLeg
+  {
+    double duration;
+    double c[3][6];         // Coefficients for x, y and z
+  };
+
+  //=====================================================================================
+  // SplineSegment moves smoothly through a series of waypoints without stopping, and
+  // rotates smoothly from the start yaw to the goal yaw on the way
+  //
+  // Each leg is a minimum-jerk (quintic) polynomial. The velocity at each waypoint points
+  // toward the next waypoint, and slows down for sharp turns. Acceleration is 0 at each
+  // waypoint, so the trajectory is C2 continuous.
+  //=====================================================================================
+
+  class SplineSegment : public SegmentBase
+  {
+    std::vector<SplineLeg> *legs_;  // Leg buffer, may be shared by several segments
+    size_t first_leg_;              // First leg for this segment
+    size_t num_legs_;               // Number of legs
+    size_t leg_;                    // Current leg
+    double leg_time_;               // Time since the start of the current leg
+
+    double yaw_start_;              // Yaw moves from yaw_start_ to yaw_start_ + yaw_delta_
+    double yaw_delta_;
+    double yaw_duration_;
+    double time_;                   // Time since the start of the segment
+
+    // Build legs from plan_ and twist_ through points(0) ... points(n - 1), then goal_
+    template<typename Points>
+    void init(const Points &points, size_t n);
+
+  protected:
+
+    bool step(double dt) override;
+
+  public:
+
+    // Move from start through all waypoints to goal, waypoints close to the previous waypoint are skipped
+    // The legs are appended to legs, which must outlive the segment
+    SplineSegment(const rclcpp::Logger &logger, const BaseContext &cxt, const orca::Pose &start,
+                  const std::vector<orca::Pose> &waypoints, const orca::Pose &goal, std::vector<SplineLeg> &legs);
+
+    void log_info() override;
+
+    // Restart at start, keeping the velocity, and move through the remaining waypoints to goal
+    bool extend(const orca::Pose &start, const orca::Pose &goal) override;
 
-    bool advance(double dt) override;
+    size_t num_legs() const
+    { return num_legs_; }
+
+    // Call fn(pose) for the planned pose now and every dt seconds until the goal, e.g., to draw the path
+    // Splines are polynomials, so stepping a copy is exact for any dt
+    template<typename Fn>
+    void for_each_pose(double dt, Fn fn) const
+    {
+      SplineSegment copy{*this};
+      fn(copy.plan_);
+      while (copy.step(dt)) {
+        fn(copy.plan_);
+      }
+    }
+
+    // Append the legs to compacted, the caller then copies compacted over the leg buffer
+    void compact_legs(std::vector<SplineLeg> &compacted);
   };
 
 } // namespace orca_base
@@ -0,0 +1,95 @@
+#ifndef ORCA_BASE_SPATIAL_GRID_HPP
+#define ORCA_BASE_SPATIAL_GRID_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace orca_base
+{
+
+  // Items in the grid
+  struct GridItem
+  {
+    int id;
+    double x;
+    double y;
+
+    GridItem(int _id, double _x, double _y) : id{_id}, x{_x}, y{_y}
+    {}
+  };
+
+  //=====================================================================================
+  // SpatialGrid is a uniform grid over xy positions, used to find nearby items without
+  // testing every item. Set the cell size to the typical search radius.
+  //=====================================================================================
+
+  class SpatialGrid
+  {
+    double cell_size_{1};
+    double min_x_{};
+    double min_y_{};
+    int cols_{};
+    int rows_{};
+
+    // The items in cell c are items_[offsets_[c]] through items_[offsets_[c + 1] - 1]
+    std::vector<size_t> offsets_;
+
+    // Items, sorted by cell
+    std::vector<GridItem> items_;
+
+    int col(double x) const
+    { return std::min(std::max(static_cast<int>(std::floor((x - min_x_) / cell_size_)), 0), cols_ - 1); }
+
+    int row(double y) const
+    { return std::min(std::max(static_cast<int>(std::floor((y - min_y_) / cell_size_)), 0), rows_ - 1); }
+
+    // Call fn(item) for every item in this cell
+    template<typename Fn>
+    void for_each_in_cell(int c, int r, Fn &fn) const
+    {
+      auto cell = r * cols_ + c;
+      for (auto i = offsets_[cell]; i < offsets_[cell + 1]; ++i) {
+        fn(items_[i]);
+      }
+    }
+
+  public:
+
+    SpatialGrid() = default;
+
+    SpatialGrid(const std::vector<GridItem> &items, double cell_size);
+
+    bool empty() const
+    { return items_.empty(); }
+
+    // Call fn(id, distance) for every item within radius of (x, y)
+    template<typename Fn>
+    void for_each_within(double x, double y, double radius, Fn fn) const
+    {
+      if (empty()) {
+        return;
+      }
+
+      auto test = [x, y, radius, &fn](const GridItem &item)
+      {
+        double distance = std::hypot(item.x - x, item.y - y);
+        if (distance < radius) {
+          fn(item.id, distance);
+        }
+      };
+
+      for (int r = row(y - radius); r <= row(y + radius); ++r) {
+        for (int c = col(x - radius); c <= col(x + radius); ++c) {
+          for_each_in_cell(c, r, test);
+        }
+      }
+    }
+
+    // Find the item nearest to (x, y), return false if the grid is empty
+    bool nearest(double x, double y, int &id, double &distance) const;
+  };
+
+} // namespace orca_base
+
+#endif //ORCA_BASE_SPATIAL_GRID_HPP
@@ -0,0 +1,74 @@
+#ifndef ORCA_BASE_THRUST_ALLOCATOR_HPP
+#define ORCA_BASE_THRUST_ALLOCATOR_HPP
+
+#include <array>
+#include <vector>
+
+#include "orca_shared/geometry.hpp"
+
+namespace orca_base
+{
+
+  struct Thruster;
+
+  //=============================================================================
+  // A wrench is expressed in thruster effort units: forward, strafe, yaw, vertical
+  //=============================================================================
+
+  constexpr int WRENCH_FORWARD = 0;
+  constexpr int WRENCH_STRAFE = 1;
+  constexpr int WRENCH_YAW = 2;
+  constexpr int WRENCH_VERTICAL = 3;
+  constexpr int WRENCH_SIZE = 4;
+
+  using Wrench = std::array<double, WRENCH_SIZE>;
+
+  //=============================================================================
+  // ThrustAllocator turns efforts into thruster efforts without distorting the wrench
+  //
+  // The allocation matrix (the pseudo-inverse of the thruster geometry) is computed once
+  // in the constructor. Efforts are scaled so that 1.0 is the largest wrench the vehicle
+  // can produce on that axis alone.
+  //
+  // The efforts are allocated in priority order: vertical, yaw, then forward + strafe.
+  // Each group is scaled down, keeping its direction, until it fits in the thrust that is
+  // left over from the groups before it. So depth and heading are held first, and a hard
+  // push forward can't turn into an unwanted turn.
+  //
+  // If nothing saturates the result is the same as the fixed mixing table.
+  //=============================================================================
+
+  class ThrustAllocator
+  {
+    std::vector<Wrench> b_;               // Wrench produced by each thruster at full effort
+    std::vector<Wrench> pinv_;            // Pseudo-inverse of b_, 1 row per thruster
+    Wrench max_wrench_;                   // Largest wrench on each axis
+    std::vector<double> group_;           // Scratch: thruster efforts for 1 priority group
+
+    // Add as much of this group as fits in [THRUST_FULL_REV, THRUST_FULL_FWD], return the scale
+    double add_group(std::vector<double> &efforts);
+
+  public:
+
+    explicit ThrustAllocator(const std::vector<Thruster> &thrusters);
+
+    const std::vector<Wrench> &pinv() const
+    { return pinv_; }
+
+    const Wrench &max_wrench() const
+    { return max_wrench_; }
+
+    // Wrench produced by these thruster efforts
+    Wrench wrench(const std::vector<double> &efforts) const;
+
+    // Wrench requested by these efforts
+    Wrench wrench(const orca::Efforts &efforts) const;
+
+    // Allocate efforts to thrusters, limit forward + strafe to xy_limit per thruster
+    // efforts must have 1 element per thruster
+    void allocate(const orca::Efforts &efforts, double xy_limit, std::vector<double> &thruster_efforts);
+  };
+
+} // namespace orca_base
+
+#endif //ORCA_BASE_THRUST_ALLOCATOR_HPP
@@ -0,0 +1,84 @@
+#ifndef ORCA_BASE_THRUSTERS_HPP
+#define ORCA_BASE_THRUSTERS_HPP
+
+#include <string>
+#include <vector>
+
+#include "orca_msgs/msg/control.hpp"
+#include "visualization_msgs/msg/marker_array.hpp"
+
+#include "orca_shared/geometry.hpp"
+
+#include "orca_base/thrust_allocator.hpp"
+
+namespace orca_base
+{
+
+  //=============================================================================
+  // Thruster
+  //=============================================================================
+
+  struct Thruster
+  {
+    std::string frame_id;   // URDF link frame id
+    bool ccw;               // True if counterclockwise
+    double forward_factor;
+    double strafe_factor;
+    double yaw_factor;
+    double vertical_factor;
+  };
+
+  //=============================================================================
+  // Thrusters combines efforts to get thruster efforts
+  //
+  // Storage is allocated in the constructor, so mixing and filling in messages doesn't
+  // allocate. This keeps the control loop free of allocations.
+  //=============================================================================
+
+  class Thrusters
+  {
+    std::vector<Thruster> thrusters_;
+    std::vector<double> efforts_;         // Most recent thruster efforts, 1 per thruster
+    ThrustAllocator allocator_;
+
+  public:
+
+    // Order must match the order of the <thruster> tags in the URDF
+    Thrusters();
+
+    const std::vector<Thruster> &thrusters() const
+    { return thrusters_; }
+
+    const std::vector<double> &efforts() const
+    { return efforts_; }
+
+    const ThrustAllocator &allocator() const
+    { return allocator_; }
+
+    // Combine efforts to get thruster efforts using the mixing table, clamp forward + strafe to xy_limit
+    // Clamps each thruster on its own, so the wrench is distorted when thrusters saturate
+    void mix(const orca::Efforts &efforts, double xy_limit);
+
+    // Allocate efforts to thrusters, see ThrustAllocator
+    void allocate(const orca::Efforts &efforts, double xy_limit)
+    { allocator_.allocate(efforts, xy_limit, efforts_); }
+
+    // Write thruster pwm values to msg.thruster_pwm
+    void to_msg(orca_msgs::msg::Control &msg) const;
+
+    // The per-tick work of BaseNode::publish_control: combine efforts to get thruster efforts, using the allocator or
+    // the mixing table, and fill in the stamp, frame, error, efforts and thruster pwm values
+    // The caller fills in the scalar fields: mode, tilt, lights, stability and diagnostics
+    void update_control(const orca::Efforts &efforts, double xy_limit, bool use_allocator, const rclcpp::Time &stamp,
+                        const std::string &frame_id, const orca::Pose &error, orca_msgs::msg::Control &msg);
+
+    // Add 1 marker per thruster to msg, call once, then call update_markers
+    void init_markers(visualization_msgs::msg::MarkerArray &msg) const;
+
+    // Update the markers to show the most recent thruster efforts
+    void update_markers(const rclcpp::Time &stamp, visualization_msgs::msg::MarkerArray &msg) const;
+  };
+
+} // namespace orca_base
+
+#endif //ORCA_BASE_THRUSTERS_HPP
@@ -0,0 +1,29 @@
+#ifndef ORCA_BASE_TOUR_HPP
+#define ORCA_BASE_TOUR_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace astar
+{
+
+  // Order n nodes to make the path that visits each node once as short as possible
+  // The path is open: it may start and end at any node
+  //
+  // distances[i * n + j] is the distance from node i to node j, and should be symmetric, e.g., from
+  // find_all_shortest_paths. Unreachable pairs are infinity, they're avoided if possible.
+  //
+  // Build a tour using nearest neighbor, starting at node 0, then improve it with 2-opt and Or-opt
+  // moves. Moves are limited to the nearest neighbors of each node, so each pass is ~O(n), plus the
+  // cost of moving nodes around in the tour. Once there's no improvement, kick the tour and try again
+  // until budget seconds have passed, or the kicks stop helping.
+  //
+  // Returns the nodes in visiting order.
+  std::vector<int> optimize_tour(const std::vector<double> &distances, size_t n, double budget);
+
+  // Length of an open tour, using the same distances
+  double tour_length(const std::vector<double> &distances, size_t n, const std::vector<int> &tour);
+
+} // namespace astar
+
+#endif //ORCA_BASE_TOUR_HPP
@@ -1,122 +1,441 @@
 #include "orca_base/astar.hpp"
 
+#include <atomic>
+#include <thread>
+
 namespace astar
 {
 
   std::ostream &operator<<(std::ostream &os, CandidateNode const &c)
   {
-    return os << "{marker: " << c.node << ", g_score: " << c.g_score << ", f_score: " << c.f_score << "}";
+    return os << "{index: " << c.index << ", g_score: " << c.g_score << ", f_score: " << c.f_score << "}";
   }
 
-  // Return the neighbors of this node
-  std::vector<Neighbor> Graph::get_neighbors(node_type node)
+  void Graph::build(const std::vector<Edge> &edges, const std::vector<node_type> &extra_nodes)
   {
-    std::vector<Neighbor> neighbors;
+    // Collect the sorted, unique node ids
+    nodes_.clear();
+    nodes_.reserve(edges.size() * 2 + extra_nodes.size());
+    nodes_.insert(nodes_.end(), extra_nodes.begin(), extra_nodes.end());
+    for (const auto &edge : edges) {
+      nodes_.push_back(edge.a);
+      nodes_.push_back(edge.b);
+    }
+    std::sort(nodes_.begin(), nodes_.end());
+    nodes_.erase(std::unique(nodes_.begin(), nodes_.end()), nodes_.end());
+
+    // Count the neighbors of each node, edges go in both directions
+    offsets_.assign(nodes_.size() + 1, 0);
+    for (const auto &edge : edges) {
+      offsets_[index(edge.a) + 1]++;
+      offsets_[index(edge.b) + 1]++;
+    }
+
+    // Prefix sum turns counts into offsets
+    for (size_t i = 1; i < offsets_.size(); ++i) {
+      offsets_[i] += offsets_[i - 1];
+    }
+
+    // Fill in the neighbors
+    std::vector<size_t> next{offsets_.begin(), offsets_.end() - 1};
+    neighbors_.assign(offsets_.back(), Neighbor{0, 0});
+    for (const auto &edge : edges) {
+      auto a = index(edge.a);
+      auto b = index(edge.b);
+      neighbors_[next[a]++] = Neighbor{b, edge.distance};
+      neighbors_[next[b]++] = Neighbor{a, edge.distance};
+    }
+  }
 
-    for (auto edge : edges_) {
-      if (edge.a == node) {
-        neighbors.emplace_back(edge.b, edge.distance);
-      } else if (edge.b == node) {
-        neighbors.emplace_back(edge.a, edge.distance);
+  Graph::Graph(const Graph &base, const std::vector<Edge> &edges, const std::vector<node_type> &extra_nodes)
+  {
+    // Recover the edge list from the base graph, each edge appears twice in the CSR adjacency list
+    std::vector<Edge> all_edges;
+    all_edges.reserve(base.neighbors_.size() / 2 + edges.size());
+    for (size_t i = 0; i < base.num_nodes(); ++i) {
+      for (const auto &neighbor : base.get_neighbors(i)) {
+        if (static_cast<index_type>(i) < neighbor.index) {
+          all_edges.emplace_back(base.node(i), base.node(neighbor.index), neighbor.distance);
+        }
       }
     }
+    all_edges.insert(all_edges.end(), edges.begin(), edges.end());
 
-    return neighbors;
+    std::vector<node_type> all_nodes{base.nodes_};
+    all_nodes.insert(all_nodes.end(), extra_nodes.begin(), extra_nodes.end());
+
+    build(all_edges, all_nodes);
   }
 
-  void Solver::print_open_set()
+  Graph::Graph(const Graph &base, const std::vector<node_type> &changed, const std::vector<Edge> &edges) :
+    nodes_{base.nodes_}
+  {
+    std::vector<bool> is_changed(nodes_.size(), false);
+    for (auto node : changed) {
+      assert(index(node) != INVALID_INDEX);
+      is_changed[index(node)] = true;
+    }
+
+    // Count the neighbors: base edges between unchanged nodes, plus the new edges
+    offsets_.assign(nodes_.size() + 1, 0);
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+      if (!is_changed[i]) {
+        for (const auto &neighbor : base.get_neighbors(i)) {
+          if (!is_changed[neighbor.index]) {
+            offsets_[i + 1]++;
+          }
+        }
+      }
+    }
+    for (const auto &edge : edges) {
+      assert(is_changed[index(edge.a)] || is_changed[index(edge.b)]);
+      offsets_[index(edge.a) + 1]++;
+      offsets_[index(edge.b) + 1]++;
+    }
+
+    // Prefix sum turns counts into offsets
+    for (size_t i = 1; i < offsets_.size(); ++i) {
+      offsets_[i] += offsets_[i - 1];
+    }
+
+    // Fill in the neighbors
+    std::vector<size_t> next{offsets_.begin(), offsets_.end() - 1};
+    neighbors_.assign(offsets_.back(), Neighbor{0, 0});
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+      if (!is_changed[i]) {
+        for (const auto &neighbor : base.get_neighbors(i)) {
+          if (!is_changed[neighbor.index]) {
+            neighbors_[next[i]++] = neighbor;
+          }
+        }
+      }
+    }
+    for (const auto &edge : edges) {
+      auto a = index(edge.a);
+      auto b = index(edge.b);
+      neighbors_[next[a]++] = Neighbor{b, edge.distance};
+      neighbors_[next[b]++] = Neighbor{a, edge.distance};
+    }
+  }
+
+  // Map a node id to a dense index
+  index_type Graph::index(node_type node) const
+  {
+    auto it = std::lower_bound(nodes_.begin(), nodes_.end(), node);
+    if (it == nodes_.end() || *it != node) {
+      return INVALID_INDEX;
+    }
+
+    return static_cast<index_type>(it - nodes_.begin());
+  }
+
+  void SolverBase::print_open_set()
   {
     auto temp = open_set_;
 
     std::cout << "queue: ";
     while (!temp.empty()) {
-      auto c = temp.top();
-      temp.pop();
-      std::cout << c << ", ";
+      std::pop_heap(temp.begin(), temp.end(), CandidateNode());
+      std::cout << temp.back() << ", ";
+      temp.pop_back();
     }
     std::cout << std::endl;
   }
 
   // Follow the parent links to reconstruct the shortest path
-  void Solver::reconstruct_path(node_type node, std::vector<node_type> &path)
+  void SolverBase::reconstruct_path(index_type index, std::vector<node_type> &path)
   {
-    if (best_parents_.find(node) != best_parents_.end()) {
-      reconstruct_path(best_parents_[node], path);
+    for (; index != INVALID_INDEX; index = best_parents_[index]) {
+      path.push_back(graph_->node(index));
     }
-    std::cout << node << ", ";
-    path.push_back(node);
+    std::reverse(path.begin(), path.end());
   }
 
-  void Solver::reset()
+  void SolverBase::reset()
   {
-    // Clear everything
-    best_g_score_.clear();
-    best_parents_.clear();
-    open_set_ = std::priority_queue<CandidateNode, std::vector<CandidateNode>, CandidateNode>();
+    // Invalidate all per-node state
+    if (++generation_ == 0) {
+      // Wrapped around, clear the stamps so that stale entries can't match
+      std::fill(stamp_.begin(), stamp_.end(), 0);
+      generation_ = 1;
+    }
 
-    // Initialize best_g_score_ with ~infinity
-    for (auto edge : graph_.edges_) {
-      best_g_score_[edge.a] = std::numeric_limits<double>::max();
-      best_g_score_[edge.b] = std::numeric_limits<double>::max();
+    open_set_.clear();
+  }
+
+  void SolverBase::set_query_edges(const std::vector<Edge> &query_edges)
+  {
+    query_neighbors_.clear();
+
+    for (const auto &edge : query_edges) {
+      index_type a = graph_->index(edge.a);
+      index_type b = graph_->index(edge.b);
+      assert(a != INVALID_INDEX && b != INVALID_INDEX);
+      query_neighbors_.emplace_back(a, Neighbor{b, edge.distance});
+      query_neighbors_.emplace_back(b, Neighbor{a, edge.distance});
     }
+
+    std::sort(query_neighbors_.begin(), query_neighbors_.end(),
+              [](const std::pair<index_type, Neighbor> &x, const std::pair<index_type, Neighbor> &y)
+              { return x.first < y.first; });
+  }
+
+  std::pair<const std::pair<index_type, Neighbor> *, const std::pair<index_type, Neighbor> *>
+  SolverBase::get_query_neighbors(index_type index) const
+  {
+    // Usually empty, or just a few entries
+    auto range = std::equal_range(query_neighbors_.data(), query_neighbors_.data() + query_neighbors_.size(),
+                                  std::make_pair(index, Neighbor{0, 0}),
+                                  [](const std::pair<index_type, Neighbor> &x, const std::pair<index_type, Neighbor> &y)
+                                  { return x.first < y.first; });
+    return {range.first, range.second};
   }
 
-  // Find the best path from start to destination, return true if successful
-  bool Solver::find_shortest_path(node_type start, node_type destination, std::vector<node_type> &result)
+  // Dijkstra with re-usable buffers
+  class Dijkstra
   {
-    reset();
+    using Entry = std::pair<double, index_type>;
+
+    const Graph &graph_;
+    std::vector<Entry> heap_;
+
+  public:
 
-    // Best distance to start node is always 0
-    best_g_score_[start] = 0;
+    std::vector<double> distances;
+    std::vector<index_type> parents;
 
-    // Add start node to open set
-    open_set_.push(CandidateNode(start, 0, h_(start, destination)));
+    explicit Dijkstra(const Graph &graph) : graph_{graph}
+    {}
 
-    while (!open_set_.empty()) {
-      // print_open_set();
+    // Run from source. Nodes marked as terminal are reached but not expanded.
+    // Stop early once num_targets nodes marked as target have been settled.
+    void run(index_type source, const std::vector<char> *terminal = nullptr, const std::vector<char> *target = nullptr,
+             size_t num_targets = 0)
+    {
+      distances.assign(graph_.num_nodes(), std::numeric_limits<double>::infinity());
+      parents.assign(graph_.num_nodes(), INVALID_INDEX);
+      distances[source] = 0;
 
-      // Pop the path with the best f_score
-      auto current = open_set_.top();
-      open_set_.pop();
-      // std::cout << "pop " << current << std::endl;
+      // Min heap of (distance, index)
+      heap_.clear();
+      heap_.emplace_back(0, source);
+      while (!heap_.empty()) {
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+        auto current = heap_.back();
+        heap_.pop_back();
 
-      // Are we done?
-      if (current.node == destination) {
-        result.clear();
-        std::cout << "reconstructed path: ";
-        reconstruct_path(destination, result);
-        std::cout << std::endl;
-        return true;
+        if (current.first > distances[current.second]) {
+          continue;
+        }
+
+        if (target && (*target)[current.second] && num_targets-- == 1) {
+          return;
+        }
+
+        if (terminal && current.second != source && (*terminal)[current.second]) {
+          continue;
+        }
+
+        for (const auto &neighbor : graph_.get_neighbors(current.second)) {
+          double distance = current.first + neighbor.distance;
+          if (distance < distances[neighbor.index]) {
+            distances[neighbor.index] = distance;
+            parents[neighbor.index] = current.second;
+            heap_.emplace_back(distance, neighbor.index);
+            std::push_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+          }
+        }
       }
+    }
+  };
 
-      // If this path to current.node is worse than the best one we've seen, drop it
-      if (current.g_score > best_g_score_[current.node]) {
-        continue;
+  void shortest_distances(const Graph &graph, index_type source, std::vector<double> &distances)
+  {
+    Dijkstra dijkstra{graph};
+    dijkstra.run(source);
+    distances = std::move(dijkstra.distances);
+  }
+
+  void find_all_shortest_paths(const Graph &graph, const std::vector<node_type> &queries, int num_threads,
+                               PathMatrix &result, bool with_paths)
+  {
+    size_t size = queries.size();
+    result.size = size;
+    result.distances.assign(size * size, std::numeric_limits<double>::infinity());
+    result.paths.assign(with_paths ? size * size : 0, std::vector<node_type>{});
+
+    // Map the query nodes to dense indices, and mark them
+    std::vector<index_type> indices;
+    std::vector<char> marked(graph.num_nodes(), 0);
+    size_t num_marked = 0;
+    for (auto query : queries) {
+      index_type index = graph.index(query);
+      indices.push_back(index);
+      if (index != INVALID_INDEX && !marked[index]) {
+        marked[index] = 1;
+        num_marked++;
       }
+    }
+
+    // Each worker pulls the next source, and writes one row of the result
+    std::atomic<size_t> next_source{0};
+    auto worker = [&]()
+    {
+      Dijkstra dijkstra{graph};
 
-      // Loop through neighbors
-      std::vector<Neighbor> neighbors = graph_.get_neighbors(current.node);
-      // std::cout << "considering " << neighbors.size() << " neighbors" << std::endl;
-      for (auto neighbor : neighbors) {
-        // tentative_g_score is the distance from start through current to the neighbor
-        double tentative_g_score = best_g_score_[current.node] + neighbor.distance;
-
-        // Does this beat the current best path?
-        if (tentative_g_score < best_g_score_[neighbor.node]) {
-          // Yes! Remember this path
-          best_g_score_[neighbor.node] = tentative_g_score;
-          best_parents_[neighbor.node] = current.node;
-
-          // Add the neighbor to the open set
-          auto c = CandidateNode(neighbor.node, tentative_g_score, h_(neighbor.node, destination));
-          // std::cout << "push " << c << std::endl;
-          open_set_.push(c);
+      for (size_t i = next_source++; i < size; i = next_source++) {
+        if (indices[i] == INVALID_INDEX) {
+          continue;
         }
+
+        dijkstra.run(indices[i], &marked, &marked, num_marked);
+
+        for (size_t j = 0; j < size; ++j) {
+          if (indices[j] == INVALID_INDEX || std::isinf(dijkstra.distances[indices[j]])) {
+            continue;
+          }
+
+          result.distances[i * size + j] = dijkstra.distances[indices[j]];
+
+          if (!with_paths) {
+            continue;
+          }
+
+          auto &path = result.paths[i * size + j];
+          for (index_type index = indices[j]; index != INVALID_INDEX; index = dijkstra.parents[index]) {
+            path.push_back(graph.node(index));
+          }
+          std::reverse(path.begin(), path.end());
+        }
+      }
+    };
+
+    // The calling thread is one of the workers
+    std::vector<std::thread> threads;
+    for (int t = 1; t < std::min(num_threads, static_cast<int>(size)); ++t) {
+      threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  void find_consecutive_shortest_paths(const Graph &graph, const std::vector<node_type> &queries, int num_threads,
+                                       std::vector<double> &distances, std::vector<std::vector<node_type>> &paths)
+  {
+    size_t size = queries.empty() ? 0 : queries.size() - 1;
+    distances.assign(size, std::numeric_limits<double>::infinity());
+    paths.assign(size, std::vector<node_type>{});
+
+    // Map the query nodes to dense indices, and mark them
+    std::vector<index_type> indices;
+    std::vector<char> marked(graph.num_nodes(), 0);
+    for (auto query : queries) {
+      index_type index = graph.index(query);
+      indices.push_back(index);
+      if (index != INVALID_INDEX) {
+        marked[index] = 1;
       }
     }
 
-    return false;
+    // Each worker pulls the next source, and writes one leg of the result
+    std::atomic<size_t> next_source{0};
+    auto worker = [&]()
+    {
+      Dijkstra dijkstra{graph};
+      std::vector<char> target(graph.num_nodes(), 0);
+
+      for (size_t i = next_source++; i < size; i = next_source++) {
+        auto source = indices[i];
+        auto destination = indices[i + 1];
+        if (source == INVALID_INDEX || destination == INVALID_INDEX) {
+          continue;
+        }
+
+        target[destination] = 1;
+        dijkstra.run(source, &marked, &target, 1);
+        target[destination] = 0;
+
+        if (std::isinf(dijkstra.distances[destination])) {
+          continue;
+        }
+
+        distances[i] = dijkstra.distances[destination];
+
+        auto &path = paths[i];
+        for (index_type index = destination; index != INVALID_INDEX; index = dijkstra.parents[index]) {
+          path.push_back(graph.node(index));
+        }
+        std::reverse(path.begin(), path.end());
+      }
+    };
+
+    // The calling thread is one of the workers
+    std::vector<std::thread> threads;
+    for (int t = 1; t < std::min(num_threads, static_cast<int>(size)); ++t) {
+      threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+      thread.join();
+    }
   }
 
+  Landmarks::Landmarks(const Graph &graph, int k) : num_nodes_{graph.num_nodes()}
+  {
+    if (num_nodes_ == 0 || k <= 0) {
+      return;
+    }
+
+    std::vector<std::vector<double>> tables;
+    std::vector<double> distances;
+
+    // Seed from the first node with neighbors, skipping isolated pseudo-nodes like Map's DESTINATION_ID
+    size_t seed = 0;
+    while (seed < num_nodes_ && graph.get_neighbors(seed).empty()) {
+      ++seed;
+    }
+    if (seed == num_nodes_) {
+      return;
+    }
+
+    // Distance from each node to the closest landmark, seeded with the distances from the seed node
+    std::vector<double> closest;
+    shortest_distances(graph, static_cast<index_type>(seed), closest);
+
+    while (landmarks_.size() < static_cast<size_t>(k)) {
+      // Pick the node farthest from the landmarks we have, unreachable nodes come first, so each component
+      // gets a landmark. Ignore nodes without neighbors.
+      index_type next = INVALID_INDEX;
+      for (size_t i = 0; i < num_nodes_; ++i) {
+        if (!graph.get_neighbors(i).empty() && closest[i] > 0 &&
+            (next == INVALID_INDEX || closest[i] > closest[next])) {
+          next = static_cast<index_type>(i);
+        }
+      }
+
+      if (next == INVALID_INDEX) {
+        // Every node with neighbors is a landmark
+        break;
+      }
+
+      shortest_distances(graph, next, distances);
+      for (size_t i = 0; i < num_nodes_; ++i) {
+        closest[i] = std::min(closest[i], distances[i]);
+      }
+
+      landmarks_.push_back(next);
+      tables.push_back(distances);
+    }
+
+    // Transpose so that the landmarks for a node are contiguous
+    distances_.resize(num_nodes_ * size());
+    for (size_t l = 0; l < size(); ++l) {
+      for (size_t i = 0; i < num_nodes_; ++i) {
+        distances_[i * size() + l] = tables[l][i];
+      }
+    }
+  }
 
 } // namespace astar
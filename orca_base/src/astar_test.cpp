@@ -1,4 +1,10 @@
 #include "orca_base/astar.hpp"
+#include "orca_base/tour.hpp"
+
+#include <chrono>
+#include <map>
+#include <numeric>
+#include <random>
 
 
 void test1()
@@ -25,7 +31,8 @@ void test1()
 
   };
 
-  auto solver = astar::Solver(edges, heuristic);
+  auto graph = std::make_shared<const astar::Graph>(edges);
+  astar::Solver<astar::NodeIdHeuristic> solver{graph, astar::NodeIdHeuristic{graph, heuristic}};
 
   std::vector<int> path;
   std::cout << (solver.find_shortest_path(0, 3, path) ? "success" : "failure") << std::endl;
@@ -36,7 +43,661 @@ void test1()
   std::cout << std::endl;
 }
 
+// Start node isn't in the graph, then re-use the solver for a good query
+void test2()
+{
+  using astar::Edge;
+
+  std::vector<Edge> edges = std::vector<Edge>{
+    Edge(0, 1, 10),
+    Edge(1, 2, 10)
+  };
+
+  auto graph = std::make_shared<const astar::Graph>(edges);
+  astar::Solver<astar::NodeIdHeuristic> solver{graph, astar::NodeIdHeuristic{graph, [](astar::node_type a,
+                                                                                      astar::node_type b) -> double
+  { return 0; }}};
+
+  std::vector<int> path;
+  std::cout << (solver.find_shortest_path(5, 2, path) ? "failure" : "success") << std::endl;
+  std::cout << (solver.find_shortest_path(0, 2, path) && path.size() == 3 ? "success" : "failure") << std::endl;
+  std::cout << (solver.find_shortest_path(2, 0, path) && path.front() == 2 ? "success" : "failure") << std::endl;
+}
+
+// Tours: points on a line are easy, and small random tours can be checked by brute force
+void test_tour()
+{
+  auto euclidean = [](const std::vector<astar::XY> &xy)
+  {
+    std::vector<double> distances;
+    for (const auto &a : xy) {
+      for (const auto &b : xy) {
+        distances.push_back(std::hypot(a.x - b.x, a.y - b.y));
+      }
+    }
+    return distances;
+  };
+
+  std::mt19937 gen{11};
+  std::uniform_real_distribution<double> coord{0, 100};
+
+  // Shuffled points on a line, the best tour goes from one end to the other
+  std::vector<astar::XY> line;
+  for (int i = 0; i < 50; ++i) {
+    line.push_back(astar::XY{static_cast<double>(i), 0});
+  }
+  std::shuffle(line.begin(), line.end(), gen);
+  auto distances = euclidean(line);
+  auto tour = astar::optimize_tour(distances, line.size(), 1);
+  std::cout << (std::abs(astar::tour_length(distances, line.size(), tour) - 49) < 1e-9 ? "success" : "failure")
+            << std::endl;
+
+  // Random points, compare to the best of all permutations
+  constexpr int NUM_TRIALS = 50;
+  constexpr int NUM_POINTS = 8;
+  double worst = 1;
+  for (int trial = 0; trial < NUM_TRIALS; ++trial) {
+    std::vector<astar::XY> xy;
+    for (int i = 0; i < NUM_POINTS; ++i) {
+      xy.push_back(astar::XY{coord(gen), coord(gen)});
+    }
+    distances = euclidean(xy);
+
+    std::vector<int> perm(NUM_POINTS);
+    std::iota(perm.begin(), perm.end(), 0);
+    double best = std::numeric_limits<double>::infinity();
+    do {
+      best = std::min(best, astar::tour_length(distances, NUM_POINTS, perm));
+    } while (std::next_permutation(perm.begin(), perm.end()));
+
+    tour = astar::optimize_tour(distances, NUM_POINTS, 1);
+    std::vector<int> sorted = tour;
+    std::sort(sorted.begin(), sorted.end());
+    std::iota(perm.begin(), perm.end(), 0);
+    worst = sorted == perm ? std::max(worst, astar::tour_length(distances, NUM_POINTS, tour) / best) : 1e9;
+  }
+  std::cout << (worst < 1.1 ? "success" : "failure") << std::endl;
+  std::cout << "worst of " << NUM_TRIALS << " tours is " << worst << "x the best tour" << std::endl;
+}
+
+// Anytime search: with lots of time the path is optimal, with no time there may be no path at all
+void test_anytime()
+{
+  using astar::Edge;
+
+  constexpr int NUM_NODES = 1000;
+  constexpr double MAX_DISTANCE = 7;
+  constexpr int NUM_QUERIES = 100;
+
+  std::mt19937 gen{3};
+  std::uniform_real_distribution<double> coord{0, 100};
+  std::vector<astar::XY> xy;
+  for (int i = 0; i < NUM_NODES; ++i) {
+    xy.push_back(astar::XY{coord(gen), coord(gen)});
+  }
+
+  std::vector<Edge> edges;
+  for (int i = 0; i < NUM_NODES; ++i) {
+    for (int j = i + 1; j < NUM_NODES; ++j) {
+      double d = std::hypot(xy[i].x - xy[j].x, xy[i].y - xy[j].y);
+      if (d < MAX_DISTANCE) {
+        edges.emplace_back(i, j, d);
+      }
+    }
+  }
+
+  auto path_length = [&xy](const std::vector<int> &path)
+  {
+    double length = 0;
+    for (size_t k = 1; k < path.size(); ++k) {
+      length += std::hypot(xy[path[k]].x - xy[path[k - 1]].x, xy[path[k]].y - xy[path[k - 1]].y);
+    }
+    return length;
+  };
+
+  auto graph = std::make_shared<const astar::Graph>(edges);
+  astar::Solver<astar::EuclideanXY> solver{graph, astar::EuclideanXY{xy.data()}};
+
+  std::uniform_int_distribution<int> pick{0, NUM_NODES - 1};
+  std::vector<int> expected, path;
+  bool ok = true;
+  int num_optimal = 0;
+  for (int i = 0; i < NUM_QUERIES; ++i) {
+    int a = pick(gen), b = pick(gen);
+    bool found = solver.find_shortest_path(a, b, expected);
+
+    // Plenty of time
+    bool optimal;
+    ok = ok && solver.find_path_anytime(a, b, path, 10, optimal) == found;
+    ok = ok && (!found || (optimal && std::abs(path_length(path) - path_length(expected)) < 1e-9));
+
+    // No time, a path (if any) must be valid and within the initial weight of optimal
+    if (solver.find_path_anytime(a, b, path, 0, optimal, {}, 3)) {
+      ok = ok && found && path.front() == a && path.back() == b &&
+           path_length(path) <= 3 * path_length(expected) + 1e-9;
+      ok = ok && (!optimal || std::abs(path_length(path) - path_length(expected)) < 1e-9);
+      if (optimal) {
+        num_optimal++;
+      }
+    }
+  }
+
+  std::cout << (ok ? "success" : "failure") << std::endl;
+  std::cout << "anytime with no budget, " << num_optimal << " of " << NUM_QUERIES << " paths proved optimal"
+            << std::endl;
+}
+
+// Run the same queries through a solver, return the total path length and the elapsed time in ms
+template<typename Heuristic>
+double run_queries(astar::Solver<Heuristic> &solver, const std::vector<std::pair<int, int>> &queries, size_t &length)
+{
+  std::vector<int> path;
+  length = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (const auto &query : queries) {
+    if (solver.find_shortest_path(query.first, query.second, path)) {
+      length += path.size();
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+// Micro-benchmark: std::function heuristic that looks up node ids vs. the inlined EuclideanXY heuristic
+void benchmark()
+{
+  using astar::Edge;
+
+  // Random nodes in a 100m x 100m square, node ids are sparse
+  constexpr int NUM_NODES = 2000;
+  constexpr double MAX_DISTANCE = 5;
+  constexpr int NUM_QUERIES = 2000;
+
+  std::mt19937 gen{42};
+  std::uniform_real_distribution<double> coord{0, 100};
+  std::vector<astar::XY> points;
+  for (int i = 0; i < NUM_NODES; ++i) {
+    points.push_back(astar::XY{coord(gen), coord(gen)});
+  }
+
+  auto distance = [](const astar::XY &a, const astar::XY &b)
+  { return std::hypot(a.x - b.x, a.y - b.y); };
+
+  std::vector<Edge> edges;
+  std::vector<astar::node_type> nodes;
+  std::map<astar::node_type, astar::XY> id_to_xy;
+  for (int i = 0; i < NUM_NODES; ++i) {
+    nodes.push_back(i * 3);
+    id_to_xy[i * 3] = points[i];
+    for (int j = i + 1; j < NUM_NODES; ++j) {
+      double d = distance(points[i], points[j]);
+      if (d < MAX_DISTANCE) {
+        edges.emplace_back(i * 3, j * 3, d);
+      }
+    }
+  }
+
+  auto graph = std::make_shared<const astar::Graph>(edges, nodes);
+
+  std::vector<astar::XY> xy(graph->num_nodes());
+  for (size_t i = 0; i < graph->num_nodes(); ++i) {
+    xy[i] = id_to_xy[graph->node(i)];
+  }
+
+  std::uniform_int_distribution<int> pick{0, NUM_NODES - 1};
+  std::vector<std::pair<int, int>> queries;
+  for (int i = 0; i < NUM_QUERIES; ++i) {
+    queries.emplace_back(pick(gen) * 3, pick(gen) * 3);
+  }
+
+  astar::Solver<astar::NodeIdHeuristic> fn_solver{graph, astar::NodeIdHeuristic{graph,
+                                                                                [&id_to_xy, &distance](astar::node_type a,
+                                                                                                       astar::node_type b)
+                                                                                {
+                                                                                  return distance(id_to_xy.at(a),
+                                                                                                  id_to_xy.at(b));
+                                                                                }}};
+  astar::Solver<astar::EuclideanXY> xy_solver{graph, astar::EuclideanXY{xy.data()}};
+
+  size_t fn_length, xy_length;
+  double fn_ms = run_queries(fn_solver, queries, fn_length);
+  double xy_ms = run_queries(xy_solver, queries, xy_length);
+
+  std::cout << (fn_length == xy_length ? "success" : "failure") << std::endl;
+  std::cout << "benchmark " << NUM_QUERIES << " queries, " << graph->num_nodes() << " nodes, "
+            << edges.size() << " edges" << std::endl;
+  std::cout << "  std::function heuristic: " << fn_ms << " ms" << std::endl;
+  std::cout << "  EuclideanXY heuristic: " << xy_ms << " ms (" << fn_ms / xy_ms << "x)" << std::endl;
+}
+
+// Replacing the edges of a moved node should match building the graph from scratch
+void test_replace_edges()
+{
+  using astar::Edge;
+
+  // Square 0-1-2-3, node 1 moves and is now connected to 3 instead of 0 and 2
+  astar::Graph base{std::vector<Edge>{Edge(0, 1, 1), Edge(1, 2, 1), Edge(2, 3, 1), Edge(3, 0, 1)}};
+  astar::Graph patched{base, {1}, std::vector<Edge>{Edge(1, 3, 2)}};
+  astar::Graph rebuilt{std::vector<Edge>{Edge(2, 3, 1), Edge(3, 0, 1), Edge(1, 3, 2)}};
+
+  bool ok = patched.num_nodes() == rebuilt.num_nodes();
+  for (size_t i = 0; ok && i < patched.num_nodes(); ++i) {
+    std::vector<std::pair<astar::node_type, double>> a, b;
+    for (const auto &neighbor : patched.get_neighbors(i)) {
+      a.emplace_back(patched.node(neighbor.index), neighbor.distance);
+    }
+    for (const auto &neighbor : rebuilt.get_neighbors(i)) {
+      b.emplace_back(rebuilt.node(neighbor.index), neighbor.distance);
+    }
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    ok = patched.node(i) == rebuilt.node(i) && a == b;
+  }
+
+  std::cout << (ok ? "success" : "failure") << std::endl;
+}
+
+// Landmark selection should skip isolated pseudo-nodes, like Map's DESTINATION_ID
+void test_landmarks()
+{
+  using astar::Edge;
+
+  // Chain 5-6-7-0-1-2, node 0 is in the middle, node -2 is isolated and has the first dense index
+  std::vector<Edge> edges = std::vector<Edge>{
+    Edge(5, 6, 1),
+    Edge(6, 7, 1),
+    Edge(7, 0, 1),
+    Edge(0, 1, 1),
+    Edge(1, 2, 1)
+  };
+
+  astar::Graph graph{edges, {-2}};
+  astar::Landmarks landmarks{graph, 1};
+
+  // The first landmark is the farthest from the first real node, i.e., an end of the chain
+  auto node = landmarks.size() == 1 ? graph.node(landmarks.landmark(0)) : 0;
+  std::cout << (node == 5 || node == 2 ? "success" : "failure") << std::endl;
+}
+
+// Micro-benchmark: EuclideanXY vs. landmarks on a serpentine corridor, where straight-line distance is a weak bound
+void benchmark_landmarks()
+{
+  using astar::Edge;
+
+  // 20 rows, 50 nodes per row, 1m apart, rows are 2m apart and connected at alternating ends
+  constexpr int NUM_ROWS = 20;
+  constexpr int NUM_COLS = 50;
+  constexpr int NUM_QUERIES = 2000;
+
+  std::vector<Edge> edges;
+  std::vector<astar::XY> xy;
+  for (int row = 0; row < NUM_ROWS; ++row) {
+    for (int col = 0; col < NUM_COLS; ++col) {
+      int node = row * NUM_COLS + col;
+      xy.push_back(astar::XY{static_cast<double>(col), row * 2.0});
+      if (col > 0) {
+        edges.emplace_back(node - 1, node, 1);
+      }
+    }
+    if (row > 0) {
+      int col = row % 2 ? NUM_COLS - 1 : 0;
+      edges.emplace_back((row - 1) * NUM_COLS + col, row * NUM_COLS + col, 2);
+    }
+  }
+
+  // Node ids are dense, so xy is already indexed by dense index
+  auto graph = std::make_shared<const astar::Graph>(edges);
+  auto landmarks = std::make_shared<const astar::Landmarks>(*graph, 4);
+
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> pick{0, NUM_ROWS * NUM_COLS - 1};
+  std::vector<std::pair<int, int>> queries;
+  for (int i = 0; i < NUM_QUERIES; ++i) {
+    queries.emplace_back(pick(gen), pick(gen));
+  }
+
+  astar::Solver<astar::EuclideanXY> xy_solver{graph, astar::EuclideanXY{xy.data()}};
+  astar::Solver<astar::LandmarkHeuristic<astar::EuclideanXY>> alt_solver{
+    graph, astar::LandmarkHeuristic<astar::EuclideanXY>{astar::EuclideanXY{xy.data()}, landmarks}};
+
+  size_t xy_length;
+  double xy_ms = run_queries(xy_solver, queries, xy_length);
+
+  std::vector<int> path;
+  size_t alt_length = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const auto &query : queries) {
+    alt_solver.heuristic().set_destination(query.second, {astar::Neighbor{query.second, 0}});
+    if (alt_solver.find_shortest_path(query.first, query.second, path)) {
+      alt_length += path.size();
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+  double alt_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+  std::cout << (xy_length == alt_length ? "success" : "failure") << std::endl;
+  std::cout << "benchmark " << NUM_QUERIES << " queries, corridor with " << graph->num_nodes() << " nodes, "
+            << landmarks->size() << " landmarks" << std::endl;
+  std::cout << "  EuclideanXY heuristic: " << xy_ms << " ms" << std::endl;
+  std::cout << "  LandmarkHeuristic: " << alt_ms << " ms (" << xy_ms / alt_ms << "x)" << std::endl;
+}
+
+// Batched many-to-many paths vs. one A* query per pair
+void benchmark_all_pairs()
+{
+  using astar::Edge;
+
+  constexpr int NUM_NODES = 2000;
+  constexpr double MAX_DISTANCE = 5;
+  constexpr int NUM_QUERIES = 40;
+
+  std::mt19937 gen{7};
+  std::uniform_real_distribution<double> coord{0, 100};
+  std::vector<astar::XY> xy;
+  for (int i = 0; i < NUM_NODES; ++i) {
+    xy.push_back(astar::XY{coord(gen), coord(gen)});
+  }
+
+  std::vector<Edge> edges;
+  for (int i = 0; i < NUM_NODES; ++i) {
+    for (int j = i + 1; j < NUM_NODES; ++j) {
+      double d = std::hypot(xy[i].x - xy[j].x, xy[i].y - xy[j].y);
+      if (d < MAX_DISTANCE) {
+        edges.emplace_back(i, j, d);
+      }
+    }
+  }
+
+  auto graph = std::make_shared<const astar::Graph>(edges);
+
+  std::uniform_int_distribution<int> pick{0, NUM_NODES - 1};
+  std::vector<astar::node_type> queries;
+  for (int i = 0; i < NUM_QUERIES; ++i) {
+    queries.push_back(pick(gen));
+  }
+
+  // One A* query per pair
+  astar::Solver<astar::EuclideanXY> solver{graph, astar::EuclideanXY{xy.data()}};
+  std::vector<double> expected(NUM_QUERIES * NUM_QUERIES, std::numeric_limits<double>::infinity());
+  std::vector<bool> exact(NUM_QUERIES * NUM_QUERIES, true);
+  std::vector<int> path;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < NUM_QUERIES; ++i) {
+    for (int j = 0; j < NUM_QUERIES; ++j) {
+      if (solver.find_shortest_path(queries[i], queries[j], path)) {
+        double distance = 0;
+        for (size_t k = 1; k < path.size(); ++k) {
+          distance += std::hypot(xy[path[k]].x - xy[path[k - 1]].x, xy[path[k]].y - xy[path[k - 1]].y);
+        }
+        expected[i * NUM_QUERIES + j] = distance;
+
+        // Batched paths don't go through other query nodes, so they may be longer
+        for (size_t k = 1; k + 1 < path.size(); ++k) {
+          if (std::find(queries.begin(), queries.end(), path[k]) != queries.end()) {
+            exact[i * NUM_QUERIES + j] = false;
+          }
+        }
+      }
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+  double pairs_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+  // Batched, 1 and 4 threads
+  double batch_ms[2];
+  int threads[2] = {1, 4};
+  bool ok = true;
+  for (int t = 0; t < 2; ++t) {
+    astar::PathMatrix matrix;
+    start = std::chrono::steady_clock::now();
+    astar::find_all_shortest_paths(*graph, queries, threads[t], matrix);
+    stop = std::chrono::steady_clock::now();
+    batch_ms[t] = std::chrono::duration<double, std::milli>(stop - start).count();
+
+    for (size_t k = 0; k < expected.size(); ++k) {
+      if (std::isinf(expected[k])) {
+        ok = ok && std::isinf(matrix.distances[k]);
+      } else if (exact[k]) {
+        ok = ok && std::abs(expected[k] - matrix.distances[k]) < 1e-9;
+      } else {
+        ok = ok && matrix.distances[k] > expected[k] - 1e-9;
+      }
+    }
+  }
+
+  // Consecutive legs only, these must match the matrix
+  astar::PathMatrix matrix;
+  astar::find_all_shortest_paths(*graph, queries, 4, matrix);
+  std::vector<double> leg_distances;
+  std::vector<std::vector<astar::node_type>> leg_paths;
+  start = std::chrono::steady_clock::now();
+  astar::find_consecutive_shortest_paths(*graph, queries, 4, leg_distances, leg_paths);
+  stop = std::chrono::steady_clock::now();
+  double legs_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+  ok = ok && leg_distances.size() == NUM_QUERIES - 1;
+  for (size_t i = 0; ok && i + 1 < NUM_QUERIES; ++i) {
+    if (std::isinf(matrix.distance(i, i + 1))) {
+      ok = std::isinf(leg_distances[i]) && leg_paths[i].empty();
+    } else {
+      ok = std::abs(matrix.distance(i, i + 1) - leg_distances[i]) < 1e-9 && !leg_paths[i].empty() &&
+           leg_paths[i].front() == queries[i] && leg_paths[i].back() == queries[i + 1];
+    }
+  }
+
+  std::cout << (ok ? "success" : "failure") << std::endl;
+  std::cout << "benchmark " << NUM_QUERIES << "x" << NUM_QUERIES << " paths, " << graph->num_nodes() << " nodes"
+            << std::endl;
+  std::cout << "  A* per pair: " << pairs_ms << " ms" << std::endl;
+  std::cout << "  batched, 1 thread: " << batch_ms[0] << " ms (" << pairs_ms / batch_ms[0] << "x)" << std::endl;
+  std::cout << "  batched, 4 threads: " << batch_ms[1] << " ms (" << pairs_ms / batch_ms[1] << "x)" << std::endl;
+  std::cout << "  consecutive legs, 4 threads: " << legs_ms << " ms" << std::endl;
+}
+
+// Incremental solver vs. A* from scratch, nodes move a little between queries, as if the map is being refined
+void benchmark_incremental()
+{
+  using astar::Edge;
+
+  constexpr int NUM_NODES = 1000;
+  constexpr double MAX_DISTANCE = 7;
+  constexpr int NUM_ITERATIONS = 50;
+  constexpr int NUM_MOVES = 3;
+
+  // Node 0 is the start, node NUM_NODES - 1 is the destination
+  std::mt19937 gen{11};
+  std::uniform_real_distribution<double> coord{0, 100};
+  std::vector<astar::XY> xy;
+  for (int i = 0; i < NUM_NODES; ++i) {
+    xy.push_back(astar::XY{coord(gen), coord(gen)});
+  }
+  xy.front() = astar::XY{1, 1};
+  xy.back() = astar::XY{99, 99};
+
+  auto distance = [&xy](int a, int b)
+  { return std::hypot(xy[a].x - xy[b].x, xy[a].y - xy[b].y); };
+
+  auto all_edges = [&]()
+  {
+    std::vector<Edge> edges;
+    for (int i = 0; i < NUM_NODES; ++i) {
+      for (int j = i + 1; j < NUM_NODES; ++j) {
+        if (distance(i, j) < MAX_DISTANCE) {
+          edges.emplace_back(i, j, distance(i, j));
+        }
+      }
+    }
+    return edges;
+  };
+
+  auto path_length = [&distance](const std::vector<int> &path)
+  {
+    double length = 0;
+    for (size_t k = 1; k < path.size(); ++k) {
+      length += distance(path[k - 1], path[k]);
+    }
+    return length;
+  };
+
+  // Node ids are dense, so xy is indexed by dense index
+  astar::IncrementalSolver<astar::EuclideanXY> incremental{std::make_shared<const astar::Graph>(all_edges()),
+                                                          astar::EuclideanXY{xy.data()}, 0, NUM_NODES - 1};
+
+  std::normal_distribution<double> nudge{0, 0.3};
+  std::uniform_int_distribution<int> pick{1, NUM_NODES - 2};
+  std::vector<int> path;
+
+  // The first search isn't incremental
+  incremental.find_shortest_path(path);
+
+  double incremental_ms = 0, scratch_ms = 0;
+  bool ok = true;
+
+  for (int iteration = 0; iteration < NUM_ITERATIONS; ++iteration) {
+    // Move a few nodes, the old edges come from the old positions
+    std::vector<int> moves;
+    for (int m = 0; m < NUM_MOVES; ++m) {
+      moves.push_back(pick(gen));
+    }
+
+    auto old_xy = xy;
+    for (auto move : moves) {
+      xy[move].x += nudge(gen);
+      xy[move].y += nudge(gen);
+    }
+
+    // From scratch: rebuild the graph (not timed) and run A*
+    auto graph = std::make_shared<const astar::Graph>(all_edges());
+    auto start = std::chrono::steady_clock::now();
+    astar::Solver<astar::EuclideanXY> solver{graph, astar::EuclideanXY{xy.data()}};
+    bool scratch_ok = solver.find_shortest_path(0, NUM_NODES - 1, path);
+    double scratch_length = path_length(path);
+    auto stop = std::chrono::steady_clock::now();
+    scratch_ms += std::chrono::duration<double, std::milli>(stop - start).count();
+
+    // Find the edges around the moved nodes (not timed)
+    std::vector<Edge> changes;
+    for (auto move : moves) {
+      for (int i = 0; i < NUM_NODES; ++i) {
+        if (i == move) {
+          continue;
+        }
+        double was = std::hypot(old_xy[i].x - old_xy[move].x, old_xy[i].y - old_xy[move].y);
+        double is = distance(i, move);
+        if (is < MAX_DISTANCE) {
+          changes.emplace_back(i, move, is);
+        } else if (was < MAX_DISTANCE) {
+          changes.emplace_back(i, move, std::numeric_limits<double>::infinity());
+        }
+      }
+    }
+
+    // Incremental: update the edges and repair the search tree
+    start = std::chrono::steady_clock::now();
+    for (auto move : moves) {
+      incremental.node_moved(move);
+    }
+    for (const auto &change : changes) {
+      incremental.set_edge(change.a, change.b, change.distance);
+    }
+    bool incremental_ok = incremental.find_shortest_path(path);
+    stop = std::chrono::steady_clock::now();
+    incremental_ms += std::chrono::duration<double, std::milli>(stop - start).count();
+
+    if (scratch_ok != incremental_ok || (scratch_ok && std::abs(scratch_length - path_length(path)) > 1e-9)) {
+      ok = false;
+    }
+  }
+
+  std::cout << (ok ? "success" : "failure") << std::endl;
+  std::cout << "benchmark " << NUM_ITERATIONS << " replans, " << NUM_MOVES << " nodes move each time" << std::endl;
+  std::cout << "  A* from scratch: " << scratch_ms << " ms" << std::endl;
+  std::cout << "  incremental: " << incremental_ms << " ms (" << scratch_ms / incremental_ms << "x)" << std::endl;
+}
+
+// Tour through many targets, distances are shortest paths through the graph
+void benchmark_tour()
+{
+  using astar::Edge;
+
+  constexpr int NUM_NODES = 4000;
+  constexpr double MAX_DISTANCE = 5;
+  constexpr int NUM_TARGETS = 2000;
+  constexpr double BUDGET = 1;
+
+  std::mt19937 gen{13};
+  std::uniform_real_distribution<double> coord{0, 100};
+  std::vector<astar::XY> xy;
+  for (int i = 0; i < NUM_NODES; ++i) {
+    xy.push_back(astar::XY{coord(gen), coord(gen)});
+  }
+
+  std::vector<Edge> edges;
+  for (int i = 0; i < NUM_NODES; ++i) {
+    for (int j = i + 1; j < NUM_NODES; ++j) {
+      double d = std::hypot(xy[i].x - xy[j].x, xy[i].y - xy[j].y);
+      if (d < MAX_DISTANCE) {
+        edges.emplace_back(i, j, d);
+      }
+    }
+  }
+
+  astar::Graph graph{edges};
+
+  // Targets in map order, i.e., random
+  std::vector<astar::node_type> targets(NUM_NODES);
+  std::iota(targets.begin(), targets.end(), 0);
+  std::shuffle(targets.begin(), targets.end(), gen);
+  targets.resize(NUM_TARGETS);
+
+  auto start = std::chrono::steady_clock::now();
+  astar::PathMatrix matrix;
+  astar::find_all_shortest_paths(graph, targets, 4, matrix, false);
+  auto stop = std::chrono::steady_clock::now();
+  double matrix_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+  std::vector<int> map_order(NUM_TARGETS);
+  std::iota(map_order.begin(), map_order.end(), 0);
+  double map_length = astar::tour_length(matrix.distances, NUM_TARGETS, map_order);
+
+  start = std::chrono::steady_clock::now();
+  auto nn_tour = astar::optimize_tour(matrix.distances, NUM_TARGETS, 0);
+  stop = std::chrono::steady_clock::now();
+  double nn_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+  double nn_length = astar::tour_length(matrix.distances, NUM_TARGETS, nn_tour);
+
+  start = std::chrono::steady_clock::now();
+  auto tour = astar::optimize_tour(matrix.distances, NUM_TARGETS, BUDGET);
+  stop = std::chrono::steady_clock::now();
+  double tour_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+  double tour_length = astar::tour_length(matrix.distances, NUM_TARGETS, tour);
+
+  std::vector<int> sorted = tour;
+  std::sort(sorted.begin(), sorted.end());
+  bool ok = sorted == map_order && tour_length <= nn_length && tour_ms < BUDGET * 1000 + 100;
+
+  std::cout << (ok ? "success" : "failure") << std::endl;
+  std::cout << "benchmark tour through " << NUM_TARGETS << " targets, " << graph.num_nodes() << " nodes" << std::endl;
+  std::cout << "  distance matrix: " << matrix_ms << " ms" << std::endl;
+  std::cout << "  map order: " << map_length << std::endl;
+  std::cout << "  nearest neighbor: " << nn_length << ", " << nn_ms << " ms" << std::endl;
+  std::cout << "  2-opt + Or-opt: " << tour_length << ", " << tour_ms << " ms (" << map_length / tour_length
+            << "x shorter than map order)" << std::endl;
+}
+
 int main(int argc, char **argv)
 {
   test1();
+  test2();
+  test_anytime();
+  test_landmarks();
+  test_replace_edges();
+  benchmark();
+  benchmark_landmarks();
+  benchmark_all_pairs();
+  benchmark_incremental();
+  test_tour();
+  benchmark_tour();
 }
\ No newline at end of file
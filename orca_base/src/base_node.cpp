@@ -27,7 +27,7 @@ namespace orca_base
   // BaseNode
   //=============================================================================
 
-  BaseNode::BaseNode() : Node{"base_node"}, map_{get_logger(), cxt_}
+  BaseNode::BaseNode() : Node{"base_node"}, map_{get_logger(), cxt_}, control_thread_{get_logger()}
   {
     // Suppress IDE warnings
     (void) baro_sub_;
@@ -37,16 +37,22 @@ namespace orca_base
     (void) map_sub_;
     (void) odom_sub_;
     (void) spin_timer_;
+    (void) rviz_timer_;
 
     // Get parameters
 #undef CXT_MACRO_MEMBER
 #define CXT_MACRO_MEMBER(n, t, d) CXT_MACRO_LOAD_PARAMETER((*this), cxt_, n, t, d)
     CXT_MACRO_INIT_PARAMETERS(BASE_NODE_ALL_PARAMS, validate_parameters)
 
-    // Register parameters
+    // Register parameters, changes are staged in new_cxt_ and copied to cxt_ under state_mutex_
+    new_cxt_ = cxt_;
 #undef CXT_MACRO_MEMBER
-#define CXT_MACRO_MEMBER(n, t, d) CXT_MACRO_PARAMETER_CHANGED(cxt_, n, t)
-    CXT_MACRO_REGISTER_PARAMETERS_CHANGED((*this), BASE_NODE_ALL_PARAMS, validate_parameters)
+#define CXT_MACRO_MEMBER(n, t, d) CXT_MACRO_PARAMETER_CHANGED(new_cxt_, n, t)
+    CXT_MACRO_REGISTER_PARAMETERS_CHANGED((*this), BASE_NODE_ALL_PARAMS, parameters_changed)
+
+    // Allocate messages
+    thrusters_.to_msg(control_msg_);
+    thrusters_.init_markers(thrust_markers_msg_);
 
     // ROV PID controller
     pressure_hold_pid_ = std::make_shared<pid::Controller>(false, cxt_.rov_pressure_pid_kp_, cxt_.rov_pressure_pid_ki_,
@@ -55,31 +61,71 @@ namespace orca_base
     // Publications
     control_pub_ = create_publisher<orca_msgs::msg::Control>("control", 1);
     thrust_marker_pub_ = create_publisher<visualization_msgs::msg::MarkerArray>("thrust_markers", 1);
-    planned_path_pub_ = create_publisher<nav_msgs::msg::Path>("planned_path", 1);
+    planned_path_pub_ = create_publisher<nav_msgs::msg::Path>("planned_path", rclcpp::QoS(1).transient_local());
     filtered_path_pub_ = create_publisher<nav_msgs::msg::Path>("filtered_path", 1);
 
+    // Callback groups: sensor input and control in one group, everything else in another
+    // With a multi-threaded executor the groups run on different threads, but callbacks that touch the node state
+    // still take turns holding state_mutex_. What runs in parallel is the slow work that is done without it:
+    // map rebuilds (map_mutex_), planning (start_mission) and copying the recorded path (path_mutex_).
+    control_group_ = create_callback_group(rclcpp::callback_group::CallbackGroupType::MutuallyExclusive);
+    housekeeping_group_ = create_callback_group(rclcpp::callback_group::CallbackGroupType::MutuallyExclusive);
+    rclcpp::SubscriptionOptions control_options;
+    control_options.callback_group = control_group_;
+    rclcpp::SubscriptionOptions housekeeping_options;
+    housekeeping_options.callback_group = housekeeping_group_;
+
     // Monotonic subscriptions
     baro_sub_ = create_subscription<orca_msgs::msg::Barometer>(
       "barometer", 1, [this](const orca_msgs::msg::Barometer::SharedPtr msg) -> void
-      { this->baro_cb_.call(msg); });
+      {
+        std::lock_guard<PiMutex> lock{state_mutex_};
+        this->baro_cb_.call(msg);
+      }, control_options);
     joy_sub_ = create_subscription<sensor_msgs::msg::Joy>(
       "joy", 1, [this](const sensor_msgs::msg::Joy::SharedPtr msg) -> void
-      { this->joy_cb_.call(msg); });
+      {
+        uint8_t pending_mode;
+        {
+          std::lock_guard<PiMutex> lock{state_mutex_};
+          this->joy_cb_.call(msg);
+          pending_mode = pending_mode_;
+          pending_mode_ = orca_msgs::msg::Control::DISARMED;
+        }
+
+        // Planning takes a while, start AUV missions after the lock is released
+        if (is_auv_mode(pending_mode)) {
+          start_mission(msg->header.stamp, pending_mode);
+        }
+        release_retired_mission();
+      }, control_options);
     map_sub_ = create_subscription<fiducial_vlam_msgs::msg::Map>(
       "fiducial_map", 1, [this](const fiducial_vlam_msgs::msg::Map::SharedPtr msg) -> void
-      { this->map_cb_.call(msg); });
+      {
+        // Only this callback uses map_cb_ and map_, map_callback takes the locks it needs
+        this->map_cb_.call(msg);
+      }, housekeeping_options);
     odom_sub_ = create_subscription<nav_msgs::msg::Odometry>(
       "odom", 1, [this](const nav_msgs::msg::Odometry::SharedPtr msg) -> void
-      { this->odom_cb_.call(msg); });
+      {
+        if (cxt_.control_thread_) {
+          // The control thread will pick this up
+          odom_slot_.write(*msg);
+        } else {
+          std::lock_guard<PiMutex> lock{state_mutex_};
+          this->odom_cb_.call(msg);
+        }
+      }, control_options);
 
     // Other subscriptions
     using namespace std::placeholders;
     auto battery_cb = std::bind(&BaseNode::battery_callback, this, _1);
-    battery_sub_ = create_subscription<orca_msgs::msg::Battery>("battery", 1, battery_cb);
+    battery_sub_ = create_subscription<orca_msgs::msg::Battery>("battery", 1, battery_cb, housekeeping_options);
     auto goal_cb = std::bind(&BaseNode::goal_callback, this, _1);
-    goal_sub_ = create_subscription<geometry_msgs::msg::PoseStamped>("/move_base_simple/goal", 1, goal_cb);
+    goal_sub_ = create_subscription<geometry_msgs::msg::PoseStamped>("/move_base_simple/goal", 1, goal_cb,
+                                                                     housekeeping_options);
     auto leak_cb = std::bind(&BaseNode::leak_callback, this, _1);
-    leak_sub_ = create_subscription<orca_msgs::msg::Leak>("leak", 1, leak_cb);
+    leak_sub_ = create_subscription<orca_msgs::msg::Leak>("leak", 1, leak_cb, housekeeping_options);
 
     // Action server
     mission_server_ = rclcpp_action::create_server<orca_msgs::action::Mission>(
@@ -90,14 +136,37 @@ namespace orca_base
       "mission",
       std::bind(&BaseNode::mission_goal, this, _1, _2),
       std::bind(&BaseNode::mission_cancel, this, _1),
-      std::bind(&BaseNode::mission_accepted, this, _1));
+      std::bind(&BaseNode::mission_accepted, this, _1),
+      rcl_action_server_get_default_options(),
+      housekeeping_group_);
 
     // Loop will run at ~constant wall speed, switch to ros_timer when it exists
-    spin_timer_ = create_wall_timer(SPIN_PERIOD, std::bind(&BaseNode::spin_once, this));
+    spin_timer_ = create_wall_timer(SPIN_PERIOD, std::bind(&BaseNode::spin_once, this), housekeeping_group_);
+
+    // Publish rviz markers and paths at a low rate, outside of the control loop
+    rviz_timer_ = create_wall_timer(std::chrono::milliseconds(cxt_.rviz_period_ms_),
+                                    std::bind(&BaseNode::publish_rviz, this), housekeeping_group_);
+
+    // Optionally run AUV missions on a dedicated thread, so slow callbacks don't delay thrust output
+    if (cxt_.control_thread_) {
+      control_thread_.start(std::chrono::milliseconds(cxt_.control_period_ms_), cxt_.control_priority_,
+                            cxt_.control_cpu_, std::bind(&BaseNode::control_tick, this, _1, _2));
+    }
 
     RCLCPP_INFO(get_logger(), "base_node ready");
   }
 
+  BaseNode::~BaseNode()
+  {
+    // The control thread uses the node, stop it first
+    control_thread_.stop();
+
+    monotonic::log_stats(get_logger(), "baro", baro_cb_.stats());
+    monotonic::log_stats(get_logger(), "joy", joy_cb_.stats());
+    monotonic::log_stats(get_logger(), "map", map_cb_.stats());
+    monotonic::log_stats(get_logger(), "odom", odom_cb_.stats());
+  }
+
   void BaseNode::validate_parameters()
   {
 #undef CXT_MACRO_MEMBER
@@ -105,7 +174,15 @@ namespace orca_base
     BASE_NODE_ALL_PARAMS
 
     // Update model from new parameters
-    cxt_.model_.fluid_density_ = cxt_.param_fluid_density_;
+    cxt_.model_.set_fluid_density(cxt_.param_fluid_density_);
+  }
+
+  void BaseNode::parameters_changed()
+  {
+    // The control thread and the other callbacks read cxt_
+    std::lock_guard<PiMutex> lock{state_mutex_};
+    cxt_ = new_cxt_;
+    validate_parameters();
   }
 
   // New barometer reading
@@ -120,19 +197,29 @@ namespace orca_base
   void BaseNode::battery_callback(const orca_msgs::msg::Battery::SharedPtr msg)
   {
     if (msg->low_battery) {
-      RCLCPP_ERROR(get_logger(), "low battery (%g volts), disarming", msg->voltage);
-      disarm(msg->header.stamp);
+      {
+        std::lock_guard<PiMutex> lock{state_mutex_};
+        RCLCPP_ERROR(get_logger(), "low battery (%g volts), disarming", msg->voltage);
+        disarm(msg->header.stamp);
+      }
+      release_retired_mission();
     }
   }
 
   // Start a mission to move to a particular goal
   void BaseNode::goal_callback(geometry_msgs::msg::PoseStamped::SharedPtr msg)
   {
-    if (disarmed()) {
+    bool ok;
+    {
+      std::lock_guard<PiMutex> lock{state_mutex_};
+      ok = disarmed();
+    }
+
+    if (ok) {
       Pose goal;
       goal.from_msg(msg->pose);
       goal.z = cxt_.auv_z_target_;
-      set_mode(msg->header.stamp, orca_msgs::msg::Control::AUV_GOAL, goal);
+      start_mission(msg->header.stamp, orca_msgs::msg::Control::AUV_GOAL, goal);
     } else {
       RCLCPP_ERROR(get_logger(), "must be disarmed to start mission");
     }
@@ -168,20 +255,20 @@ namespace orca_base
           RCLCPP_ERROR(get_logger(), "barometer not ready, cannot hold pressure");
         }
       } else if (button_down(msg, joy_msg_, joy_button_auv_keep_origin_)) {
-        if (odom_ok(msg->header.stamp) && map_.ok()) {
-          set_mode(msg->header.stamp, orca_msgs::msg::Control::AUV_KEEP_ORIGIN);
+        if (odom_ok(msg->header.stamp) && map_ok()) {
+          pending_mode_ = orca_msgs::msg::Control::AUV_KEEP_ORIGIN;
         } else {
           RCLCPP_ERROR(get_logger(), "no odometry | no map | invalid filter, cannot keep origin");
         }
       } else if (button_down(msg, joy_msg_, joy_button_auv_keep_station_)) {
-        if (odom_ok(msg->header.stamp) && map_.ok()) {
-          set_mode(msg->header.stamp, orca_msgs::msg::Control::AUV_KEEP_STATION);
+        if (odom_ok(msg->header.stamp) && map_ok()) {
+          pending_mode_ = orca_msgs::msg::Control::AUV_KEEP_STATION;
         } else {
           RCLCPP_ERROR(get_logger(), "no odometry | no map | invalid filter, cannot keep station");
         }
       } else if (button_down(msg, joy_msg_, joy_button_auv_random_)) {
-        if (odom_ok(msg->header.stamp) && map_.ok()) {
-          set_mode(msg->header.stamp, orca_msgs::msg::Control::AUV_RANDOM);
+        if (odom_ok(msg->header.stamp) && map_ok()) {
+          pending_mode_ = orca_msgs::msg::Control::AUV_RANDOM;
         } else {
           RCLCPP_ERROR(get_logger(), "no odometry | no map | invalid filter, cannot start random mission");
         }
@@ -226,18 +313,46 @@ namespace orca_base
   void BaseNode::leak_callback(const orca_msgs::msg::Leak::SharedPtr msg)
   {
     if (msg->leak_detected) {
-      RCLCPP_ERROR(get_logger(), "leak detected, disarming");
-      disarm(msg->header.stamp);
+      {
+        std::lock_guard<PiMutex> lock{state_mutex_};
+        RCLCPP_ERROR(get_logger(), "leak detected, disarming");
+        disarm(msg->header.stamp);
+      }
+      release_retired_mission();
     }
   }
 
   // New map available
   void BaseNode::map_callback(const fiducial_vlam_msgs::msg::Map::SharedPtr msg)
   {
+    // Rebuilding the marker graph can take a while, don't hold any locks
     map_.set_vlam_map(msg);
+
+    // Swap in a copy for everyone else, release the old copy outside of the lock
+    auto map = std::make_shared<const Map>(map_);
+    {
+      std::lock_guard<std::mutex> lock{map_mutex_};
+      std::swap(latest_map_, map);
+    }
+
+    // The mission has a copy of the map, the planner updates it on its worker thread
+    std::shared_ptr<Mission> mission;
+    {
+      std::lock_guard<PiMutex> lock{state_mutex_};
+      mission = mission_;
+    }
+    if (mission) {
+      mission->set_vlam_map(msg);
+    }
+  }
+
+  std::shared_ptr<const Map> BaseNode::latest_map()
+  {
+    std::lock_guard<std::mutex> lock{map_mutex_};
+    return latest_map_;
   }
 
-  // New odometry available
+  // New odometry available, called by the executor or the control thread
   void BaseNode::odom_callback(const nav_msgs::msg::Odometry::SharedPtr msg, bool first)
   {
     // Save the pose
@@ -249,18 +364,53 @@ namespace orca_base
     get_rpy(msg->pose.pose.orientation, roll, pitch, yaw);
     stability_ = std::min(clamp(std::cos(roll), 0.0, 1.0), clamp(std::cos(pitch), 0.0, 1.0));
 
-    // Continue the mission
-    if (auv_mode()) {
+    // Record actual path, publish_rviz() publishes it
+    // Don't wait for publish_rviz(), the path is just for visualization, so it's fine to drop a pose
+    if (auv_mode() && full_pose(filtered_odom_)) {
+      std::unique_lock<std::mutex> lock{path_mutex_, std::try_to_lock};
+      if (lock.owns_lock()) {
+        filtered_poses_.push(filtered_pose_);
+      }
+    }
+
+    // Continue the mission, the control thread does this at a fixed rate
+    if (auv_mode() && !cxt_.control_thread_) {
       auv_advance(odom_cb_.dt());
     }
   }
 
+  // Called by the control thread at a fixed rate
+  void BaseNode::control_tick(double dt, const LoopStats &stats)
+  {
+    std::lock_guard<PiMutex> lock{state_mutex_};
+
+    control_msg_.loop_jitter = stats.jitter;
+    control_msg_.loop_jitter_max = stats.jitter_max;
+    control_msg_.loop_overruns = stats.overruns;
+
+    // Pick up the newest odometry, if any
+    if (odom_slot_.read(*odom_msg_)) {
+      odom_cb_.call(odom_msg_);
+    }
+
+    // Continue the mission, using the most recent odometry
+    if (auv_mode()) {
+      auv_advance(dt);
+    }
+  }
+
   rclcpp_action::GoalResponse BaseNode::mission_goal(
     const rclcpp_action::GoalUUID &uuid,
     std::shared_ptr<const orca_msgs::action::Mission::Goal> goal)
   {
+    bool ok;
+    {
+      std::lock_guard<PiMutex> lock{state_mutex_};
+      ok = disarmed() && odom_ok(now());
+    }
+
     // Accept a mission if the sub is disarmed, we have odometry and we have a map
-    if (disarmed() && odom_ok(now()) && map_.ok()) {
+    if (ok && map_ok()) {
       RCLCPP_INFO(get_logger(), "mission %d accepted", goal->mode);
       return rclcpp_action::GoalResponse::ACCEPT_AND_EXECUTE;
     } else {
@@ -282,7 +432,7 @@ namespace orca_base
   {
     // Start the mission
     RCLCPP_INFO(get_logger(), "execute mission %d", goal_handle->get_goal()->mode);
-    set_mode(now(), goal_handle->get_goal()->mode, Pose{}, goal_handle);
+    start_mission(now(), goal_handle->get_goal()->mode, Pose{}, goal_handle);
   }
 
   void BaseNode::rov_advance(const rclcpp::Time &stamp)
@@ -307,20 +457,12 @@ namespace orca_base
 
   void BaseNode::auv_advance(double dt)
   {
-    // Publish planned path for rviz
-    if (count_subscribers(planned_path_pub_->get_topic_name()) > 0) {
+    // Publish planned path for rviz, but only when it changes, the publisher is latched for late subscribers
+    if (mission_->planned_path_seq() != planned_path_seq_) {
+      planned_path_seq_ = mission_->planned_path_seq();
       planned_path_pub_->publish(mission_->planned_path());
     }
 
-    // Publish actual path for rviz
-    if (full_pose(filtered_odom_) && count_subscribers(filtered_path_pub_->get_topic_name()) > 0) {
-      if (filtered_path_.poses.size() > cxt_.keep_poses_) {
-        filtered_path_.poses.clear();
-      }
-      filtered_pose_.add_to_path(filtered_path_);
-      filtered_path_pub_->publish(filtered_path_);
-    }
-
     // Advance plan and compute feedforward
     Pose plan;
     Acceleration u_bar;
@@ -338,8 +480,8 @@ namespace orca_base
 
       publish_control(filtered_odom_.header.stamp, error, efforts);
     } else {
-      // Mission is over, clean up
-      mission_ = nullptr;
+      // Mission is over, clean up, the mission is destroyed later, outside of the control loop
+      retired_mission_ = std::move(mission_);
       disarm(filtered_odom_.header.stamp);
     }
   }
@@ -353,70 +495,26 @@ namespace orca_base
 
   void BaseNode::publish_control(const rclcpp::Time &msg_time, const Pose &error, const Efforts &efforts)
   {
-    // Combine joystick efforts to get thruster efforts.
-    std::vector<double> thruster_efforts = {};
-    for (const auto &i : THRUSTERS) {
-      // Clamp forward + strafe to xy_gain_
-      double xy_effort = clamp(
-        efforts.forward() * i.forward_factor + efforts.strafe() * i.strafe_factor,
-        -cxt_.xy_gain_, cxt_.xy_gain_);
-
-      // Clamp total thrust
-      thruster_efforts.push_back(
-        clamp(xy_effort + efforts.yaw() * i.yaw_factor + efforts.vertical() * i.vertical_factor,
-              THRUST_FULL_REV, THRUST_FULL_FWD));
-    }
+    // Combine joystick efforts to get thruster efforts, limit forward + strafe to xy_gain_
+    // Control is expressed in the base frame
+    thrusters_.update_control(efforts, cxt_.xy_gain_, cxt_.thrust_allocator_, msg_time, cxt_.base_frame_, error,
+                              control_msg_);
 
     // Publish control message
-    orca_msgs::msg::Control control_msg;
-    control_msg.header.stamp = msg_time;
-    control_msg.header.frame_id = cxt_.base_frame_; // Control is expressed in the base frame
-    error.to_msg(control_msg.error);
-    efforts.to_msg(control_msg.efforts);
-    control_msg.mode = mode_;
-    control_msg.camera_tilt_pwm = tilt_to_pwm(tilt_);
-    control_msg.brightness_pwm = brightness_to_pwm(brightness_);
-    for (double thruster_effort : thruster_efforts) {
-      control_msg.thruster_pwm.push_back(effort_to_pwm(thruster_effort));
-    }
-    control_msg.stability = stability_;
-    control_msg.odom_lag = (now() - odom_cb_.curr()).seconds();
-    control_pub_->publish(control_msg);
-
-    // Publish rviz thrust markers
-    if (count_subscribers(thrust_marker_pub_->get_topic_name()) > 0) {
-      visualization_msgs::msg::MarkerArray markers_msg;
-      for (unsigned long i = 0; i < thruster_efforts.size(); ++i) {
-        int32_t action =
-          thruster_efforts[i] == 0.0 ? visualization_msgs::msg::Marker::DELETE : visualization_msgs::msg::Marker::ADD;
-        double scale = (THRUSTERS[i].ccw ? -thruster_efforts[i] : thruster_efforts[i]) / 5.0;
-        double offset = scale > 0 ? -0.1 : 0.1;
-
-        visualization_msgs::msg::Marker marker;
-        marker.header.frame_id = THRUSTERS[i].frame_id;
-        marker.header.stamp = msg_time;
-        marker.ns = "thruster";
-        marker.id = i;
-        marker.type = visualization_msgs::msg::Marker::ARROW;
-        marker.action = action;
-        marker.pose.position.x = 0;
-        marker.pose.position.y = 0;
-        marker.pose.position.z = offset;
-        marker.pose.orientation.x = 0.0;
-        marker.pose.orientation.y = 0.7071068;
-        marker.pose.orientation.z = 0.0;
-        marker.pose.orientation.w = 0.7071068;
-        marker.scale.x = scale;
-        marker.scale.y = 0.01;
-        marker.scale.z = 0.01;
-        marker.color.a = 1.0;
-        marker.color.r = 0.0;
-        marker.color.g = 1.0;
-        marker.color.b = 0.0;
-        markers_msg.markers.push_back(marker);
-      }
-      thrust_marker_pub_->publish(markers_msg);
+    control_msg_.mode = mode_;
+    control_msg_.camera_tilt_pwm = tilt_to_pwm(tilt_);
+    control_msg_.brightness_pwm = brightness_to_pwm(brightness_);
+    control_msg_.stability = stability_;
+    control_msg_.odom_lag = (now() - rclcpp::Time(filtered_odom_.header.stamp)).seconds();
+    if (mission_) {
+      auto diagnostics = mission_->planner_diagnostics();
+      control_msg_.plan_latency = diagnostics.last_latency;
+      control_msg_.plan_swaps = diagnostics.plans_swapped;
+    } else {
+      control_msg_.plan_latency = 0;
+      control_msg_.plan_swaps = 0;
     }
+    control_pub_->publish(control_msg_);
   }
 
   void BaseNode::disarm(const rclcpp::Time &msg_time)
@@ -425,10 +523,10 @@ namespace orca_base
       // Stop all thrusters
       all_stop(msg_time);
 
-      // Abort an active mission
+      // Abort an active mission, destroying it joins the planner thread, so that's done later without the lock
       if (mission_) {
         mission_->abort();
-        mission_ = nullptr;
+        retired_mission_ = std::move(mission_);
       }
 
       // Set mode
@@ -436,55 +534,137 @@ namespace orca_base
     }
   }
 
-  // Change operation mode
-  void BaseNode::set_mode(const rclcpp::Time &msg_time, uint8_t new_mode, const Pose &goal,
-                          const std::shared_ptr<rclcpp_action::ServerGoalHandle<orca_msgs::action::Mission>> &goal_handle)
+  // Change to a disarmed or ROV mode
+  void BaseNode::set_mode(const rclcpp::Time &msg_time, uint8_t new_mode)
   {
-    using orca_msgs::msg::Control;
+    assert(!is_auv_mode(new_mode));
 
     // Stop, clean up old state, etc.
     disarm(msg_time);
 
     if (is_hold_pressure_mode(new_mode)) {
-
       RCLCPP_INFO(get_logger(), "hold pressure at %g", pressure_);
       pressure_hold_pid_->set_target(pressure_);
+    }
 
-    } else if (is_auv_mode(new_mode)) {
+    // Set the new mode
+    mode_ = new_mode;
+  }
 
-      std::shared_ptr<PlannerBase> planner;
-      switch (new_mode) {
-        case Control::AUV_KEEP_ORIGIN: {
-          Pose origin;
-          origin.z = cxt_.auv_z_target_;
-          planner = std::make_shared<TargetPlanner>(get_logger(), cxt_, map_, origin, true);
-          break;
-        }
-        case Control::AUV_SEQUENCE:
-          planner = std::make_shared<DownSequencePlanner>(get_logger(), cxt_, map_, false);
-          break;
-        case Control::AUV_RANDOM:
-          planner = std::make_shared<DownSequencePlanner>(get_logger(), cxt_, map_, true);
-          break;
-        case Control::AUV_GOAL:
-          planner = std::make_shared<TargetPlanner>(get_logger(), cxt_, map_, goal, false);
-          break;
-        case Control::AUV_KEEP_STATION:
-        default:
-          planner = std::make_shared<TargetPlanner>(get_logger(), cxt_, map_, filtered_pose_.pose, true);
-          break;
+  // Start an AUV mission: build the planner without the lock, this may take a while (e.g., finding a tour), then
+  // swap the mission in
+  void BaseNode::start_mission(const rclcpp::Time &msg_time, uint8_t new_mode, const Pose &goal,
+                               const std::shared_ptr<rclcpp_action::ServerGoalHandle<orca_msgs::action::Mission>> &goal_handle)
+  {
+    using orca_msgs::msg::Control;
+
+    auto map = latest_map();
+    if (!map || !map->ok()) {
+      RCLCPP_ERROR(get_logger(), "no map, cannot start mission %d", new_mode);
+      if (goal_handle) {
+        goal_handle->abort(std::make_shared<orca_msgs::action::Mission::Result>());
       }
+      return;
+    }
 
-      mission_ = std::make_shared<Mission>(get_logger(), cxt_, goal_handle, planner, filtered_pose_);
+    PoseStamped start;
+    {
+      std::lock_guard<PiMutex> lock{state_mutex_};
+      start = filtered_pose_;
+    }
 
-      // Init filtered_path
-      filtered_path_.header.stamp = joy_cb_.curr();
-      filtered_path_.header.frame_id = cxt_.map_frame_;
-      filtered_path_.poses.clear();
+    std::shared_ptr<PlannerBase> planner;
+    switch (new_mode) {
+      case Control::AUV_KEEP_ORIGIN: {
+        Pose origin;
+        origin.z = cxt_.auv_z_target_;
+        planner = std::make_shared<TargetPlanner>(get_logger(), cxt_, *map, origin, true);
+        break;
+      }
+      case Control::AUV_SEQUENCE:
+        planner = std::make_shared<DownSequencePlanner>(get_logger(), cxt_, *map, false);
+        break;
+      case Control::AUV_RANDOM:
+        planner = std::make_shared<DownSequencePlanner>(get_logger(), cxt_, *map, true);
+        break;
+      case Control::AUV_GOAL:
+        planner = std::make_shared<TargetPlanner>(get_logger(), cxt_, *map, goal, false);
+        break;
+      case Control::AUV_KEEP_STATION:
+      default:
+        planner = std::make_shared<TargetPlanner>(get_logger(), cxt_, *map, start.pose, true);
+        break;
     }
 
-    // Set the new mode
-    mode_ = new_mode;
+    auto mission = std::make_shared<Mission>(get_logger(), goal_handle, planner, start);
+
+    {
+      std::lock_guard<PiMutex> lock{state_mutex_};
+
+      // Stop, clean up old state, etc.
+      disarm(msg_time);
+
+      mission_ = std::move(mission);
+
+      // Init planned_path and filtered_path
+      planned_path_seq_ = -1;
+      {
+        std::lock_guard<std::mutex> path_lock{path_mutex_};
+        filtered_poses_.reset(cxt_.keep_poses_);
+      }
+
+      // Set the new mode
+      mode_ = new_mode;
+    }
+
+    release_retired_mission();
+  }
+
+  void BaseNode::release_retired_mission()
+  {
+    std::shared_ptr<Mission> mission;
+    {
+      std::lock_guard<PiMutex> lock{state_mutex_};
+      mission.swap(retired_mission_);
+    }
+
+    // The mission is destroyed here, if this was the last reference
+  }
+
+  void BaseNode::publish_rviz()
+  {
+    // The messages are only used here, so they can be published after the lock is released
+    bool publish_markers = thrust_marker_pub_->get_subscription_count() > 0;
+    bool publish_path = filtered_path_pub_->get_subscription_count() > 0;
+
+    // Thrust markers for the most recent control message
+    if (publish_markers) {
+      std::lock_guard<PiMutex> lock{state_mutex_};
+      thrusters_.update_markers(control_msg_.header.stamp, thrust_markers_msg_);
+    }
+
+    // Actual path, this is O(keep_poses), so it's kept out of the control loop and out of state_mutex_
+    if (publish_path) {
+      std::lock_guard<std::mutex> lock{path_mutex_};
+      publish_path = !filtered_poses_.empty();
+      if (publish_path) {
+        filtered_path_.header.frame_id = cxt_.map_frame_;
+        filtered_path_.header.stamp = filtered_poses_[filtered_poses_.size() - 1].t;
+        filtered_path_.poses.resize(filtered_poses_.size());
+        for (size_t i = 0; i < filtered_poses_.size(); ++i) {
+          filtered_poses_[i].to_msg(filtered_path_.poses[i]);
+          filtered_path_.poses[i].header.frame_id = filtered_path_.header.frame_id;
+        }
+      }
+    }
+
+    if (publish_markers) {
+      thrust_marker_pub_->publish(thrust_markers_msg_);
+    }
+
+    if (publish_path) {
+      filtered_path_pub_->publish(filtered_path_);
+    }
   }
 
   void BaseNode::spin_once()
@@ -495,32 +675,42 @@ namespace orca_base
       return;
     }
 
-    // Various timeouts
-    if (rov_mode() && !joy_ok(spin_time)) {
-      RCLCPP_ERROR(get_logger(), "lost joystick during ROV operation, disarming");
-      disarm(spin_time);
-    }
+    bool auto_start;
+    {
+      std::lock_guard<PiMutex> lock{state_mutex_};
 
-    if (auv_mode() && !odom_ok(spin_time)) {
-      RCLCPP_ERROR(get_logger(), "lost odometry during AUV operation, disarming");
-      disarm(spin_time);
-    }
+      // Various timeouts
+      if (rov_mode() && !joy_ok(spin_time)) {
+        RCLCPP_ERROR(get_logger(), "lost joystick during ROV operation, disarming");
+        disarm(spin_time);
+      }
 
-    if (auv_mode() && stability_ < 0.4) {
-      RCLCPP_ERROR(get_logger(), "excessive tilt during AUV operation, disarming");
-      disarm(spin_time);
-    }
+      if (auv_mode() && !odom_ok(spin_time)) {
+        RCLCPP_ERROR(get_logger(), "lost odometry during AUV operation, disarming");
+        disarm(spin_time);
+      }
 
-    if (holding_pressure() && !baro_ok(spin_time)) {
-      RCLCPP_ERROR(get_logger(), "lost barometer while holding pressure, disarming");
-      disarm(spin_time);
+      if (auv_mode() && stability_ < 0.4) {
+        RCLCPP_ERROR(get_logger(), "excessive tilt during AUV operation, disarming");
+        disarm(spin_time);
+      }
+
+      if (holding_pressure() && !baro_ok(spin_time)) {
+        RCLCPP_ERROR(get_logger(), "lost barometer while holding pressure, disarming");
+        disarm(spin_time);
+      }
+
+      auto_start = !auv_mode() && is_auv_mode(cxt_.auto_start_) && !joy_ok(spin_time) && odom_ok(spin_time);
     }
 
     // Auto-start mission
-    if (!auv_mode() && is_auv_mode(cxt_.auto_start_) && !joy_ok(spin_time) && odom_ok(spin_time)) {
+    if (auto_start) {
       RCLCPP_INFO(get_logger(), "auto-starting mission %d", cxt_.auto_start_);
-      set_mode(spin_time, cxt_.auto_start_);
+      start_mission(spin_time, cxt_.auto_start_);
     }
+
+    // Missions that ended on the control thread are destroyed here
+    release_retired_mission();
   }
 
 } // namespace orca_base
@@ -544,7 +734,15 @@ int main(int argc, char **argv)
   auto result = rcutils_logging_set_logger_level(node->get_logger().get_name(), RCUTILS_LOG_SEVERITY_INFO);
 
   // Spin node
-  rclcpp::spin(node);
+  if (node->executor_threads() == 1) {
+    rclcpp::spin(node);
+  } else {
+    // 0 threads: one per cpu
+    rclcpp::executors::MultiThreadedExecutor executor{rclcpp::executor::create_default_executor_arguments(),
+                                                      static_cast<size_t>(node->executor_threads())};
+    executor.add_node(node);
+    executor.spin();
+  }
 
   // Shut down ROS
   rclcpp::shutdown();
@@ -0,0 +1,96 @@
+#include "orca_base/control_thread.hpp"
+
+#include <sched.h>
+
+#include <cstring>
+
+namespace orca_base
+{
+
+  PiMutex::PiMutex()
+  {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&mutex_, &attr);
+    pthread_mutexattr_destroy(&attr);
+  }
+
+  PiMutex::~PiMutex()
+  {
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  void ControlThread::start(std::chrono::nanoseconds period, int priority, int cpu, Tick tick)
+  {
+    stop();
+
+    period_ = period;
+    priority_ = priority;
+    cpu_ = cpu;
+    tick_ = std::move(tick);
+    stats_ = LoopStats{};
+
+    running_ = true;
+    thread_ = std::thread(&ControlThread::run, this);
+  }
+
+  void ControlThread::stop()
+  {
+    if (!thread_.joinable()) {
+      return;
+    }
+
+    running_ = false;
+    thread_.join();
+
+    RCLCPP_INFO(logger_, "control thread: %u ticks, jitter mean %g max %g seconds, %u overruns",
+                stats_.ticks, stats_.jitter_mean, stats_.jitter_max, stats_.overruns);
+  }
+
+  void ControlThread::run()
+  {
+    if (cpu_ >= 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(cpu_, &cpus);
+      int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      if (rc) {
+        RCLCPP_WARN(logger_, "can't pin control thread to cpu %d: %s", cpu_, strerror(rc));
+      }
+    }
+
+    if (priority_ > 0) {
+      sched_param param{};
+      param.sched_priority = priority_;
+      int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+      if (rc) {
+        RCLCPP_WARN(logger_, "can't set control thread to SCHED_FIFO priority %d: %s", priority_, strerror(rc));
+      }
+    }
+
+    RCLCPP_INFO(logger_, "control thread running every %g seconds",
+                std::chrono::duration<double>(period_).count());
+
+    auto next = std::chrono::steady_clock::now();
+    auto prev = next;
+
+    while (running_) {
+      next += period_;
+      std::this_thread::sleep_until(next);
+
+      auto start = std::chrono::steady_clock::now();
+      bool overrun = start - next > period_;
+      stats_.add(std::chrono::duration<double>(start - next).count(), overrun);
+
+      // Skip the missed ticks
+      if (overrun) {
+        next = start;
+      }
+
+      tick_(std::chrono::duration<double>(start - prev).count(), stats_);
+      prev = start;
+    }
+  }
+
+} // namespace orca_base
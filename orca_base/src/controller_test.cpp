@@ -0,0 +1,353 @@
+#include "orca_base/controller.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+
+using namespace orca;
+using namespace orca_base;
+
+//=====================================================================================
+// Reference: the virtual controllers that the policy-based controllers replaced
+//=====================================================================================
+
+class RefControllerBase
+{
+protected:
+
+  pid::Controller x_controller_;
+  pid::Controller y_controller_;
+  pid::Controller z_controller_;
+  pid::Controller yaw_controller_;
+
+public:
+
+  explicit RefControllerBase(const BaseContext &cxt) :
+    x_controller_{false, cxt.auv_x_pid_ku_, cxt.auv_x_pid_tu_},
+    y_controller_{false, cxt.auv_y_pid_ku_, cxt.auv_y_pid_tu_},
+    z_controller_{false, cxt.auv_z_pid_ku_, cxt.auv_z_pid_tu_},
+    yaw_controller_{true, cxt.auv_yaw_pid_ku_, cxt.auv_yaw_pid_tu_}
+  {}
+
+  virtual ~RefControllerBase() = default;
+
+  virtual void calc(const BaseContext &cxt, double dt, const Pose &plan, const nav_msgs::msg::Odometry &estimate,
+                    const Acceleration &ff, Acceleration &u_bar) = 0;
+};
+
+class RefSimpleController : public RefControllerBase
+{
+public:
+
+  explicit RefSimpleController(const BaseContext &cxt) : RefControllerBase{cxt}
+  {}
+
+  void calc(const BaseContext &cxt, double dt, const Pose &plan, const nav_msgs::msg::Odometry &estimate,
+            const Acceleration &ff, Acceleration &u_bar) override
+  {
+    u_bar = ff;
+
+    if (estimate.pose.covariance[0 * 7] < 1e4) {
+      x_controller_.set_target(plan.x);
+      u_bar.x = x_controller_.calc(estimate.pose.pose.position.x, dt) + ff.x;
+    }
+
+    if (estimate.pose.covariance[1 * 7] < 1e4) {
+      y_controller_.set_target(plan.y);
+      u_bar.y = y_controller_.calc(estimate.pose.pose.position.y, dt) + ff.y;
+    }
+
+    if (estimate.pose.covariance[2 * 7] < 1e4) {
+      z_controller_.set_target(plan.z);
+      u_bar.z = z_controller_.calc(estimate.pose.pose.position.z, dt) + ff.z;
+    }
+
+    if (estimate.pose.covariance[5 * 7] < 1e4) {
+      yaw_controller_.set_target(plan.yaw);
+      u_bar.yaw = yaw_controller_.calc(get_yaw(estimate.pose.pose.orientation), dt) + ff.yaw;
+    }
+  }
+};
+
+double ref_limit(const double previous, const double next, const double dt, const double rate)
+{
+  double diff = std::min(std::abs(next - previous), dt * rate);
+  return next - previous < 0 ? previous - diff : previous + diff;
+}
+
+class RefBestController : public RefControllerBase
+{
+  Acceleration prev_u_bar_;
+
+public:
+
+  explicit RefBestController(const BaseContext &cxt) : RefControllerBase{cxt}
+  {}
+
+  void calc(const BaseContext &cxt, double dt, const Pose &plan, const nav_msgs::msg::Odometry &estimate,
+            const Acceleration &ff, Acceleration &u_bar) override
+  {
+    x_controller_.set_target(plan.x);
+    y_controller_.set_target(plan.y);
+    z_controller_.set_target(plan.z);
+    yaw_controller_.set_target(plan.yaw);
+
+    if (plan.distance_xy(estimate) > cxt.auv_epsilon_xy_) {
+      u_bar.x = x_controller_.calc(estimate.pose.pose.position.x, dt);
+      u_bar.y = y_controller_.calc(estimate.pose.pose.position.y, dt);
+    } else {
+      u_bar.x = 0;
+      u_bar.y = 0;
+    }
+
+    if (plan.distance_z(estimate) > cxt.auv_epsilon_z_) {
+      u_bar.z = z_controller_.calc(estimate.pose.pose.position.z, dt);
+    } else {
+      u_bar.z = 0;
+    }
+
+    if (plan.distance_yaw(estimate) > cxt.auv_epsilon_yaw_) {
+      u_bar.yaw = yaw_controller_.calc(get_yaw(estimate.pose.pose.orientation), dt);
+    } else {
+      u_bar.yaw = 0;
+    }
+
+    u_bar.x = ref_limit(prev_u_bar_.x, u_bar.x, dt, cxt.auv_jerk_xy_);
+    u_bar.y = ref_limit(prev_u_bar_.y, u_bar.y, dt, cxt.auv_jerk_xy_);
+    u_bar.z = ref_limit(prev_u_bar_.z, u_bar.z, dt, cxt.auv_jerk_z_);
+    u_bar.yaw = ref_limit(prev_u_bar_.yaw, u_bar.yaw, dt, cxt.auv_jerk_yaw_);
+
+    prev_u_bar_ = u_bar;
+
+    u_bar.add(ff);
+  }
+};
+
+class RefDepthController : public RefControllerBase
+{
+public:
+
+  explicit RefDepthController(const BaseContext &cxt) : RefControllerBase{cxt}
+  {}
+
+  void calc(const BaseContext &cxt, double dt, const Pose &plan, const nav_msgs::msg::Odometry &estimate,
+            const Acceleration &ff, Acceleration &u_bar) override
+  {
+    u_bar = ff;
+
+    z_controller_.set_target(plan.z);
+    u_bar.z = z_controller_.calc(estimate.pose.pose.position.z, dt) + ff.z;
+  }
+};
+
+//=====================================================================================
+// Inputs
+//=====================================================================================
+
+struct Input
+{
+  double dt;
+  Pose plan;
+  nav_msgs::msg::Odometry estimate;
+  Pose pose;                            // From estimate, PlannerBase::advance has this before calling the controller
+  Acceleration ff;
+};
+
+// A plan that moves slowly, with jumps, and an estimate that is close to the plan, but sometimes uncertain
+std::vector<Input> make_inputs(int n)
+{
+  std::mt19937 gen{1};
+  std::uniform_real_distribution<double> noise{-0.3, 0.3};
+  std::uniform_real_distribution<double> uniform{0, 1};
+
+  std::vector<Input> inputs(n);
+  Pose plan;
+  for (auto &input : inputs) {
+    if (uniform(gen) < 0.01) {
+      plan.x += 5 * noise(gen);
+      plan.yaw += 10 * noise(gen);
+      pid::norm_angle(plan.yaw);
+    }
+    plan.x += 0.01;
+    plan.z = -0.5 + noise(gen) * 0.1;
+    plan.yaw += 0.005;
+    pid::norm_angle(plan.yaw);
+
+    input.dt = 0.02 + 0.01 * uniform(gen);
+    input.plan = plan;
+
+    Pose pose;
+    pose.x = plan.x + noise(gen);
+    pose.y = plan.y + noise(gen);
+    pose.z = plan.z + noise(gen) * 0.5;
+    pose.yaw = plan.yaw + noise(gen);
+    pose.to_msg(input.estimate.pose.pose);
+    input.pose.from_msg(input.estimate.pose.pose);
+    for (int i = 0; i < 6; ++i) {
+      input.estimate.pose.covariance[i * 7] = uniform(gen) < 0.1 ? 1e6 : 0.01;
+    }
+
+    input.ff = Acceleration{noise(gen), noise(gen), noise(gen), noise(gen)};
+  }
+
+  return inputs;
+}
+
+bool same(const Acceleration &a, const Acceleration &b)
+{
+  constexpr double EPSILON = 1e-9;
+  return std::abs(a.x - b.x) < EPSILON && std::abs(a.y - b.y) < EPSILON && std::abs(a.z - b.z) < EPSILON &&
+         std::abs(a.yaw - b.yaw) < EPSILON;
+}
+
+//=====================================================================================
+// Tests
+//=====================================================================================
+
+// PidLanes should match 4 pid::Controllers, including the integral and derivative terms
+void test_pid_lanes(const std::vector<Input> &inputs)
+{
+  Lanes kp{{0.5, 0.6, 0.7, 0.8}};
+  Lanes ki{{0.1, 0.2, 0.3, 0.4}};
+  Lanes kd{{0.05, 0.06, 0.07, 0.08}};
+  Lanes all{{1, 1, 1, 1}};
+
+  PidLanes lanes{kp, ki, kd};
+  std::vector<pid::Controller> refs;
+  for (int i = 0; i < NUM_LANES; ++i) {
+    refs.emplace_back(i == LANE_YAW, kp[i], ki[i], kd[i]);
+  }
+
+  bool ok = true;
+  for (const auto &input : inputs) {
+    ControllerEstimate estimate;
+    estimate.from_msg(input.estimate);
+
+    Lanes target{{input.plan.x, input.plan.y, input.plan.z, input.plan.yaw}};
+    Lanes state{{estimate.pose.x, estimate.pose.y, estimate.pose.z, estimate.pose.yaw}};
+    Lanes u;
+    lanes.set_target(target, all);
+    lanes.calc(state, all, input.dt, u);
+
+    for (int i = 0; i < NUM_LANES; ++i) {
+      refs[i].set_target(target[i]);
+      ok = ok && std::abs(refs[i].calc(state[i], input.dt) - u[i]) < 1e-9;
+    }
+  }
+
+  std::cout << (ok ? "success" : "failure") << std::endl;
+}
+
+template<typename Controller, typename RefController>
+bool test_controller(const BaseContext &cxt, const std::vector<Input> &inputs)
+{
+  Controller controller{cxt};
+  RefController ref{cxt};
+
+  for (const auto &input : inputs) {
+    ControllerEstimate estimate;
+    estimate.from_msg(input.estimate);
+
+    Acceleration u_bar, ref_u_bar;
+    controller.calc(cxt, input.dt, input.plan, estimate, input.ff, u_bar);
+    ref.calc(cxt, input.dt, input.plan, input.estimate, input.ff, ref_u_bar);
+
+    if (!same(u_bar, ref_u_bar)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void test_controllers(const std::vector<Input> &inputs)
+{
+  BaseContext cxt;
+
+  std::cout << (test_controller<SimpleController, RefSimpleController>(cxt, inputs) &&
+                test_controller<BestController, RefBestController>(cxt, inputs) &&
+                test_controller<DepthController, RefDepthController>(cxt, inputs) ?
+                "success" : "failure") << std::endl;
+}
+
+//=====================================================================================
+// Benchmark: 1 controller, called once per control cycle, including extracting the estimate
+//
+// from_odom: extract the pose from the odometry message, this includes get_yaw()
+// !from_odom: start from the pose, this is what PlannerBase::advance does
+//
+// The virtual controllers always call get_yaw(). Report the fastest of several runs, the
+// machine is noisy.
+//=====================================================================================
+
+template<typename Controller>
+double time_policy(const BaseContext &cxt, const std::vector<Input> &inputs, int reps, bool from_odom, double &sum)
+{
+  Controller controller{cxt};
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < reps; ++r) {
+    for (const auto &input : inputs) {
+      ControllerEstimate estimate;
+      if (from_odom) {
+        estimate.from_msg(input.estimate);
+      } else {
+        estimate = ControllerEstimate{input.pose, input.estimate.pose.covariance};
+      }
+      Acceleration u_bar;
+      controller.calc(cxt, input.dt, input.plan, estimate, input.ff, u_bar);
+      sum += u_bar.x + u_bar.yaw;
+    }
+  }
+  return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+template<typename RefController>
+double time_ref(const BaseContext &cxt, const std::vector<Input> &inputs, int reps, double &sum)
+{
+  std::unique_ptr<RefControllerBase> controller = std::make_unique<RefController>(cxt);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < reps; ++r) {
+    for (const auto &input : inputs) {
+      Acceleration u_bar;
+      controller->calc(cxt, input.dt, input.plan, input.estimate, input.ff, u_bar);
+      sum += u_bar.x + u_bar.yaw;
+    }
+  }
+  return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+template<typename Controller, typename RefController>
+void benchmark(const char *name, const std::vector<Input> &inputs)
+{
+  constexpr int RUNS = 10;
+  constexpr int REPS = 100;
+  BaseContext cxt;
+  double sum_ref = 0, sum_odom = 0, sum_pose = 0;
+  double n = static_cast<double>(inputs.size()) * REPS;
+
+  double ref_time = std::numeric_limits<double>::max();
+  double odom_time = std::numeric_limits<double>::max();
+  double pose_time = std::numeric_limits<double>::max();
+  for (int run = 0; run < RUNS; ++run) {
+    ref_time = std::min(ref_time, time_ref<RefController>(cxt, inputs, REPS, sum_ref));
+    odom_time = std::min(odom_time, time_policy<Controller>(cxt, inputs, REPS, true, sum_odom));
+    pose_time = std::min(pose_time, time_policy<Controller>(cxt, inputs, REPS, false, sum_pose));
+  }
+
+  std::cout << name << ": virtual " << ref_time / n * 1e9 << "ns, policy from odom " << odom_time / n * 1e9
+            << "ns, policy from pose " << pose_time / n * 1e9 << "ns per call (" << sum_ref << ", " << sum_odom
+            << ", " << sum_pose << ")" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  auto inputs = make_inputs(10000);
+  test_pid_lanes(inputs);
+  test_controllers(inputs);
+  benchmark<SimpleController, RefSimpleController>("simple", inputs);
+  benchmark<BestController, RefBestController>("best", inputs);
+}
@@ -0,0 +1,215 @@
+#include "orca_shared/model.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+using orca::Model;
+
+// Reference: the numerical integrator that Model::glide_distance_* replaced, with a variable time step
+constexpr double NUM_DT = 0.1;        // Time step used by the integrator
+constexpr double FINE_DT = 0.0001;    // Time step for an accurate integration
+constexpr double MAX_TIME = 10;       // Give up after this many seconds
+constexpr double END_VELO = 0.1;      // When velo is < this, end the simulation
+
+void rotate_frame(const double x, const double y, const double theta, double &x_r, double &y_r)
+{
+  x_r = x * cos(theta) + y * sin(theta);
+  y_r = y * cos(theta) - x * sin(theta);
+}
+
+double integrate_z(const Model &model, double velo_z, double dt)
+{
+  double z = 0;
+
+  for (int ticks = 0; ticks < MAX_TIME / dt; ++ticks) {
+    velo_z -= Model::force_to_accel(-model.drag_force_z(velo_z)) * dt;
+    z += velo_z * dt;
+
+    if (std::abs(velo_z) < END_VELO) {
+      return std::abs(z);
+    }
+  }
+
+  return 0;
+}
+
+double integrate_yaw(const Model &model, double velo_yaw, double dt)
+{
+  double yaw = 0;
+
+  for (int ticks = 0; ticks < MAX_TIME / dt; ++ticks) {
+    velo_yaw -= Model::torque_to_accel_yaw(-model.drag_torque_yaw(velo_yaw)) * dt;
+    yaw += velo_yaw * dt;
+
+    if (std::abs(velo_yaw) < END_VELO) {
+      return std::abs(yaw);
+    }
+  }
+
+  return 0;
+}
+
+// Velocity is in the world frame, drag is computed in the body frame
+double integrate_xy(const Model &model, double yaw, double velo_x, double velo_y, double dt)
+{
+  double x = 0;
+  double y = 0;
+
+  for (int ticks = 0; ticks < MAX_TIME / dt; ++ticks) {
+    double forward_v, strafe_v;
+    rotate_frame(velo_x, velo_y, yaw, forward_v, strafe_v);
+
+    double forward_a = Model::force_to_accel(-model.drag_force_x(forward_v));
+    double strafe_a = Model::force_to_accel(-model.drag_force_y(strafe_v));
+
+    double accel_drag_x, accel_drag_y;
+    rotate_frame(forward_a, strafe_a, -yaw, accel_drag_x, accel_drag_y);
+
+    velo_x -= accel_drag_x * dt;
+    velo_y -= accel_drag_y * dt;
+    x += velo_x * dt;
+    y += velo_y * dt;
+
+    if (std::hypot(velo_x, velo_y) < END_VELO) {
+      return std::hypot(x, y);
+    }
+  }
+
+  return 0;
+}
+
+double closed_form_xy(const Model &model, double yaw, double velo_x, double velo_y)
+{
+  double forward_v, strafe_v;
+  rotate_frame(velo_x, velo_y, yaw, forward_v, strafe_v);
+  return model.glide_distance_xy(forward_v, strafe_v, END_VELO);
+}
+
+// Compare the closed form to the integrator for speeds up to max_velo
+bool test_glide(const Model &model, double dt, double max_velo, double tolerance)
+{
+  bool ok = true;
+
+  auto close_enough = [tolerance](double reference, double closed_form, double velo)
+  {
+    // The integrator may stop up to 1 step early or late
+    return std::abs(reference - closed_form) < tolerance * reference + std::abs(velo) * NUM_DT;
+  };
+
+  for (double velo = -max_velo; velo <= max_velo; velo += max_velo / 20) {
+    double ref = integrate_z(model, velo, dt);
+    double cf = model.glide_distance_z(velo, END_VELO);
+    if (!close_enough(ref, cf, velo)) {
+      std::cout << "z: velo " << velo << ", integrator " << ref << ", closed form " << cf << std::endl;
+      ok = false;
+    }
+
+    ref = integrate_yaw(model, velo, dt);
+    cf = model.glide_distance_yaw(velo, END_VELO);
+    if (!close_enough(ref, cf, velo)) {
+      std::cout << "yaw: velo " << velo << ", integrator " << ref << ", closed form " << cf << std::endl;
+      ok = false;
+    }
+  }
+
+  for (double speed = max_velo / 20; speed <= max_velo; speed += max_velo / 20) {
+    for (double angle = -M_PI; angle < M_PI; angle += M_PI / 12) {
+      double yaw = 0.3;
+      double velo_x = speed * cos(angle);
+      double velo_y = speed * sin(angle);
+      double ref = integrate_xy(model, yaw, velo_x, velo_y, dt);
+      double cf = closed_form_xy(model, yaw, velo_x, velo_y);
+      if (!close_enough(ref, cf, speed)) {
+        std::cout << "xy: velo (" << velo_x << ", " << velo_y << "), integrator " << ref << ", closed form " << cf
+                  << std::endl;
+        ok = false;
+      }
+    }
+  }
+
+  return ok;
+}
+
+void test_glide()
+{
+  const Model &freshwater = orca::FRESHWATER_MODEL;
+  const Model &seawater = orca::SEAWATER_MODEL;
+
+  // The closed form is exact, compare to an accurate integration over a wide range of speeds
+  std::cout << (test_glide(freshwater, FINE_DT, 2, 0.01) && test_glide(seawater, FINE_DT, 2, 0.01) ?
+                "success" : "failure") << std::endl;
+
+  // Euler steps of 0.1s under-estimate the glide at high speeds, compare at typical AUV speeds
+  std::cout << (test_glide(freshwater, NUM_DT, 0.5, 0.1) && test_glide(seawater, NUM_DT, 0.5, 0.1) ?
+                "success" : "failure") << std::endl;
+}
+
+// The standard models are compile-time constants
+static_assert(orca::FRESHWATER_MODEL.hover_accel_z() > orca::SEAWATER_MODEL.hover_accel_z(), "sinks faster in freshwater");
+
+// The cached coefficients should match the formulas they replaced
+bool test_model(const Model &model, double density)
+{
+  auto same = [](double a, double b) { return std::abs(a - b) <= 1e-12 * std::max(1.0, std::abs(b)); };
+
+  double linear_drag_x = 0.5 * density * Model::ROV_AREA_X * Model::DRAG_COEFFICIENT_X;
+  double linear_drag_y = 0.5 * density * Model::ROV_AREA_Y * Model::DRAG_COEFFICIENT_Y;
+  double linear_drag_z = 0.5 * density * Model::ROV_AREA_Z * Model::DRAG_COEFFICIENT_Z;
+  double angular_drag_yaw = 0.02 * (linear_drag_x + linear_drag_y);
+  double weight_in_water = Model::GRAVITY * (Model::MASS - Model::VOLUME * density);
+  double velo = -0.7;
+  double pressure = 110000;
+
+  return same(model.fluid_density(), density) &&
+         same(model.displaced_mass(), Model::VOLUME * density) &&
+         same(model.weight_in_water(), weight_in_water) &&
+         same(model.hover_accel_z(), weight_in_water / Model::MASS) &&
+         same(model.tether_drag(), 0.5 * density * Model::TETHER_DIAM * Model::TETHER_DRAG_COEFFICIENT) &&
+         same(model.pressure_to_z(pressure), -(pressure - Model::ATMOSPHERIC_PRESSURE) / (density * Model::GRAVITY)) &&
+         same(model.z_to_pressure(-2), density * Model::GRAVITY * 2 + Model::ATMOSPHERIC_PRESSURE) &&
+         same(model.drag_accel_x(velo), Model::force_to_accel(velo * std::abs(velo) * -linear_drag_x)) &&
+         same(model.drag_accel_y(velo), Model::force_to_accel(velo * std::abs(velo) * -linear_drag_y)) &&
+         same(model.drag_accel_z(velo), Model::force_to_accel(velo * std::abs(velo) * -linear_drag_z)) &&
+         same(model.drag_accel_yaw(velo), Model::torque_to_accel_yaw(velo * std::abs(velo) * -angular_drag_yaw));
+}
+
+void test_model()
+{
+  Model model;
+  model.set_fluid_density(1010);
+
+  std::cout << (test_model(orca::FRESHWATER_MODEL, 997) && test_model(orca::SEAWATER_MODEL, 1029) &&
+                test_model(model, 1010) ? "success" : "failure") << std::endl;
+}
+
+void benchmark()
+{
+  Model model;
+  constexpr int N = 100000;
+  double sum_ref = 0, sum_cf = 0;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < N; ++i) {
+    sum_ref += integrate_xy(model, 0.3, 0.5 * i / N, 0.01, NUM_DT);
+  }
+  auto ref_time = std::chrono::high_resolution_clock::now() - start;
+
+  start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < N; ++i) {
+    sum_cf += closed_form_xy(model, 0.3, 0.5 * i / N, 0.01);
+  }
+  auto cf_time = std::chrono::high_resolution_clock::now() - start;
+
+  std::cout << "xy integrator " << std::chrono::duration<double>(ref_time).count() << "s, closed form "
+            << std::chrono::duration<double>(cf_time).count() << "s (" << sum_ref << ", " << sum_cf << ")"
+            << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  test_model();
+  test_glide();
+  benchmark();
+}
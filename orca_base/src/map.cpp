@@ -12,53 +12,379 @@ namespace orca_base
   constexpr astar::node_type START_ID = -1;
   constexpr astar::node_type DESTINATION_ID = -2;
 
-  bool Map::get_waypoints(const Pose &start_pose, const Pose &destination_pose, std::vector<Pose> &waypoints) const
+  // Pseudo marker IDs for get_waypoint_matrix and get_leg_waypoints are FIRST_POSE_ID, FIRST_POSE_ID - 1, ...
+  constexpr astar::node_type FIRST_POSE_ID = -3;
+
+  // True if both maps have the same marker ids
+  bool same_ids(const fiducial_vlam_msgs::msg::Map &a, const fiducial_vlam_msgs::msg::Map &b)
   {
-    waypoints.clear();
+    return a.ids == b.ids && a.poses.size() == b.poses.size();
+  }
 
-    // Create a map of marker ids to poses, including the start and destination pose
-    std::map<astar::node_type, Pose> poses;
+  // Return the markers whose xy positions are different, both maps must have the same marker ids
+  std::vector<astar::node_type> moved_markers(const fiducial_vlam_msgs::msg::Map &a,
+                                              const fiducial_vlam_msgs::msg::Map &b)
+  {
+    std::vector<astar::node_type> moved;
 
-    // Add start pose to map
-    auto start_z_target = start_pose;
-    start_z_target.z = cxt_.auv_z_target_;
-    poses[START_ID] = start_z_target;
+    for (size_t i = 0; i < a.poses.size(); ++i) {
+      if (a.poses[i].pose.position.x != b.poses[i].pose.position.x ||
+          a.poses[i].pose.position.y != b.poses[i].pose.position.y) {
+        moved.push_back(a.ids[i]);
+      }
+    }
 
-    // Add destination pose to map
-    auto destination_z_target = destination_pose;
-    destination_z_target.z = cxt_.auv_z_target_;
-    poses[DESTINATION_ID] = destination_z_target;
+    return moved;
+  }
 
-    // Add all of the markers to the map
-    for (size_t i = 0; i < vlam_map_->ids.size(); ++i) {
+  std::shared_ptr<const MarkerGraph> build_marker_graph(const fiducial_vlam_msgs::msg::Map &vlam_map, int num_landmarks)
+  {
+    auto marker_graph = std::make_shared<MarkerGraph>(num_landmarks);
+
+    // Create a map of marker ids to poses
+    std::vector<astar::node_type> nodes{START_ID, DESTINATION_ID};
+    std::vector<GridItem> items;
+    for (size_t i = 0; i < vlam_map.ids.size(); ++i) {
       Pose pose;
-      pose.from_msg(vlam_map_->poses[i].pose);
-      pose.z = cxt_.auv_z_target_;
-      poses[vlam_map_->ids[i]] = pose;
+      pose.from_msg(vlam_map.poses[i].pose);
+      marker_graph->poses[vlam_map.ids[i]] = pose;
+      nodes.push_back(vlam_map.ids[i]);
+      items.emplace_back(vlam_map.ids[i], pose.x, pose.y);
     }
 
+    // Index the markers so that we only need to test nearby markers
+    marker_graph->grid = SpatialGrid{items, MAX_DEAD_RECKONING_DISTANCE};
+
     // Enumerate all edges between markers that are < MAX_DEAD_RECKONING_DISTANCE
     std::vector<astar::Edge> short_paths;
-    for (auto i = poses.begin(); i != poses.end(); ++i) {
-      for (auto j = std::next(i); j != poses.end(); ++j) {
-        auto distance = i->second.distance_xy(j->second);
-        if (distance < MAX_DEAD_RECKONING_DISTANCE) {
-          short_paths.emplace_back(i->first, j->first, distance);
+    for (const auto &item : items) {
+      marker_graph->grid.for_each_within(item.x, item.y, MAX_DEAD_RECKONING_DISTANCE,
+                                         [&item, &short_paths](int id, double distance)
+                                         {
+                                           // Add each edge once
+                                           if (item.id < id) {
+                                             short_paths.emplace_back(item.id, id, distance);
+                                           }
+                                         });
+    }
+
+    // Include the start and destination pseudo markers, these are connected at query time
+    marker_graph->graph = std::make_shared<const astar::Graph>(short_paths, nodes);
+
+    // Lay out the xy positions by dense index, the start and destination are filled in at query time
+    marker_graph->xy.assign(marker_graph->graph->num_nodes(), astar::XY{0, 0});
+    for (const auto &item : items) {
+      marker_graph->xy[marker_graph->graph->index(item.id)] = astar::XY{item.x, item.y};
+    }
+
+    return marker_graph;
+  }
+
+  // Some markers moved: recompute the edges of the moved markers, keep the rest of the graph
+  std::shared_ptr<const MarkerGraph> update_marker_graph(const MarkerGraph &old_graph,
+                                                         const fiducial_vlam_msgs::msg::Map &vlam_map,
+                                                         std::vector<astar::node_type> moved)
+  {
+    auto marker_graph = std::make_shared<MarkerGraph>(old_graph.num_landmarks);
+    marker_graph->poses = old_graph.poses;
+    marker_graph->xy = old_graph.xy;
+
+    // Refresh the poses, the grid is cheap to rebuild and may need new bounds
+    std::vector<GridItem> items;
+    for (size_t i = 0; i < vlam_map.ids.size(); ++i) {
+      Pose pose;
+      pose.from_msg(vlam_map.poses[i].pose);
+      marker_graph->poses[vlam_map.ids[i]] = pose;
+      items.emplace_back(vlam_map.ids[i], pose.x, pose.y);
+    }
+    marker_graph->grid = SpatialGrid{items, MAX_DEAD_RECKONING_DISTANCE};
+
+    // Find the new edges of the moved markers
+    std::sort(moved.begin(), moved.end());
+    std::vector<astar::Edge> short_paths;
+    for (auto id : moved) {
+      const auto &pose = marker_graph->poses.at(id);
+      marker_graph->xy[old_graph.graph->index(id)] = astar::XY{pose.x, pose.y};
+      marker_graph->grid.for_each_within(pose.x, pose.y, MAX_DEAD_RECKONING_DISTANCE,
+                                         [id, &moved, &short_paths](int neighbor, double distance)
+                                         {
+                                           // Add edges between moved markers once
+                                           if (id < neighbor ||
+                                               (neighbor < id && !std::binary_search(moved.begin(), moved.end(),
+                                                                                     neighbor))) {
+                                             short_paths.emplace_back(id, neighbor, distance);
+                                           }
+                                         });
+    }
+
+    marker_graph->graph = std::make_shared<const astar::Graph>(*old_graph.graph, moved, short_paths);
+
+    return marker_graph;
+  }
+
+  const std::shared_ptr<const astar::Landmarks> &MarkerGraph::landmarks() const
+  {
+    // Copies of Map on other threads may get here at the same time
+    std::call_once(landmarks_flag_, [this]()
+    { landmarks_ = std::make_shared<const astar::Landmarks>(*graph, num_landmarks); });
+    return landmarks_;
+  }
+
+  const Pose &Map::Query::pose(astar::node_type node) const
+  {
+    if (node == START_ID) {
+      return start;
+    } else if (node == DESTINATION_ID) {
+      return destination;
+    } else {
+      return marker_graph->poses.at(node);
+    }
+  }
+
+  const Pose &Map::Replan::pose(astar::node_type node) const
+  {
+    if (node == START_ID) {
+      return start;
+    } else if (node == DESTINATION_ID) {
+      return destination;
+    } else {
+      return marker_graph->poses.at(node);
+    }
+  }
+
+  bool Map::set_vlam_map(fiducial_vlam_msgs::msg::Map::SharedPtr map)
+  {
+    bool changed = false;
+
+    // The map is published over and over, only rebuild the graph if the markers changed
+    if (map) {
+      if (!vlam_map_ || !marker_graph_ || marker_graph_->num_landmarks != cxt_.auv_landmarks_ ||
+          !same_ids(*vlam_map_, *map)) {
+        RCLCPP_INFO(logger_, "build marker graph with %zu markers, %d landmarks", map->ids.size(), cxt_.auv_landmarks_);
+        marker_graph_ = build_marker_graph(*map, cxt_.auv_landmarks_);
+        replan_.reset();
+        changed = true;
+      } else {
+        // Same markers, maybe in new positions
+        auto moved = moved_markers(*vlam_map_, *map);
+        if (!moved.empty()) {
+          RCLCPP_INFO(logger_, "%zu of %zu markers moved, update marker graph", moved.size(), map->ids.size());
+          marker_graph_ = update_marker_graph(*marker_graph_, *map, moved);
+          update_replan(moved);
+          changed = true;
         }
       }
     }
 
+    vlam_map_ = std::move(map);
+    return changed;
+  }
+
+  void Map::update_replan(const std::vector<astar::node_type> &moved)
+  {
+    if (!replan_) {
+      return;
+    }
+
+    constexpr double INF = std::numeric_limits<double>::infinity();
+    auto &solver = *replan_->solver;
+    const auto &graph = *marker_graph_->graph;
+    auto old_marker_graph = replan_->marker_graph;
+    replan_->marker_graph = marker_graph_;
+
+    // Move the markers
+    for (auto id : moved) {
+      const auto &pose = marker_graph_->poses.at(id);
+      replan_->xy[graph.index(id)] = astar::XY{pose.x, pose.y};
+      solver.node_moved(id);
+    }
+
+    // Update the edges around the markers
+    for (auto id : moved) {
+      const auto &old_pose = old_marker_graph->poses.at(id);
+      const auto &pose = marker_graph_->poses.at(id);
+
+      // Old edges, these may be too long now
+      old_marker_graph->grid.for_each_within(old_pose.x, old_pose.y, MAX_DEAD_RECKONING_DISTANCE,
+                                             [&](int neighbor, double)
+                                             {
+                                               if (neighbor != id) {
+                                                 auto d = pose.distance_xy(marker_graph_->poses.at(neighbor));
+                                                 solver.set_edge(id, neighbor,
+                                                                 d < MAX_DEAD_RECKONING_DISTANCE ? d : INF);
+                                               }
+                                             });
+
+      // New edges
+      marker_graph_->grid.for_each_within(pose.x, pose.y, MAX_DEAD_RECKONING_DISTANCE,
+                                          [&](int neighbor, double d)
+                                          {
+                                            if (neighbor != id) {
+                                              solver.set_edge(id, neighbor, d);
+                                            }
+                                          });
+
+      // The destination doesn't move, the start is reconnected on the next replan
+      auto d = pose.distance_xy(replan_->destination);
+      solver.set_edge(DESTINATION_ID, id, d < MAX_DEAD_RECKONING_DISTANCE ? d : INF);
+    }
+  }
+
+  bool Map::replan_waypoints(const Pose &start_pose, const Pose &destination_pose, std::vector<Pose> &waypoints,
+                             double budget, bool &timed_out) const
+  {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+    const auto &graph = *marker_graph_->graph;
+
+    if (!replan_ || replan_->destination.x != destination_pose.x || replan_->destination.y != destination_pose.y) {
+      // New destination, start a new search tree
+      replan_ = std::make_unique<Replan>();
+      replan_->marker_graph = marker_graph_;
+      replan_->destination = destination_pose;
+      replan_->xy = marker_graph_->xy;
+      replan_->xy[graph.index(START_ID)] = astar::XY{start_pose.x, start_pose.y};
+      replan_->xy[graph.index(DESTINATION_ID)] = astar::XY{destination_pose.x, destination_pose.y};
+      replan_->solver = std::make_unique<astar::IncrementalSolver<astar::EuclideanXY>>(
+        marker_graph_->graph, astar::EuclideanXY{replan_->xy.data()}, START_ID, DESTINATION_ID);
+
+      auto &solver = *replan_->solver;
+      marker_graph_->grid.for_each_within(destination_pose.x, destination_pose.y, MAX_DEAD_RECKONING_DISTANCE,
+                                          [&solver](int id, double distance)
+                                          { solver.set_edge(DESTINATION_ID, id, distance); });
+    } else {
+      // The start moved
+      replan_->solver->start_moved(start_pose.distance_xy(replan_->start));
+      replan_->xy[graph.index(START_ID)] = astar::XY{start_pose.x, start_pose.y};
+    }
+
+    replan_->start = start_pose;
+    replan_->destination = destination_pose;
+    auto &solver = *replan_->solver;
+
+    // Reconnect the start
+    std::vector<astar::node_type> start_neighbors;
+    marker_graph_->grid.for_each_within(start_pose.x, start_pose.y, MAX_DEAD_RECKONING_DISTANCE,
+                                        [&solver, &start_neighbors](int id, double distance)
+                                        {
+                                          solver.set_edge(START_ID, id, distance);
+                                          start_neighbors.push_back(id);
+                                        });
+
+    auto distance = start_pose.distance_xy(destination_pose);
+    solver.set_edge(START_ID, DESTINATION_ID, distance < MAX_DEAD_RECKONING_DISTANCE ? distance : INF);
+
+    for (auto id : replan_->start_neighbors) {
+      if (std::find(start_neighbors.begin(), start_neighbors.end(), id) == start_neighbors.end()) {
+        solver.set_edge(START_ID, id, INF);
+      }
+    }
+    replan_->start_neighbors = std::move(start_neighbors);
+
+    // Repair the search tree and find the shortest path
+    std::vector<astar::node_type> path;
+    timed_out = false;
+    if (budget > 0 ? solver.find_shortest_path(path, budget, timed_out) : solver.find_shortest_path(path)) {
+      for (auto marker : path) {
+        Pose waypoint = replan_->pose(marker);
+        waypoint.z = cxt_.auv_z_target_;
+        waypoints.push_back(waypoint);
+      }
+      return true;
+    } else {
+      if (!timed_out) {
+        RCLCPP_ERROR(logger_, "D* Lite failed to find a path through the markers");
+      }
+      return false;
+    }
+  }
+
+  bool Map::nearest_marker(const Pose &pose, int &id, Pose &marker_pose) const
+  {
+    double distance;
+    if (marker_graph_ && marker_graph_->grid.nearest(pose.x, pose.y, id, distance)) {
+      marker_pose = marker_graph_->poses.at(id);
+      return true;
+    }
+
+    return false;
+  }
+
+  void Map::set_query(const Pose &start_pose, const Pose &destination_pose) const
+  {
     // Create an A* solver that we can use to navigate between markers that are further away
-    auto solver = std::make_shared<astar::Solver>(short_paths, [&](astar::node_type a, astar::node_type b) -> double
-    {
-      return poses[a].distance_xy(poses[b]);
-    });
+    if (!query_ || query_->marker_graph != marker_graph_) {
+      query_ = std::make_unique<Query>();
+      query_->marker_graph = marker_graph_;
+
+      query_->xy = marker_graph_->xy;
+      query_->solver = std::make_unique<astar::Solver<astar::LandmarkHeuristic<astar::EuclideanXY>>>(
+        marker_graph_->graph,
+        astar::LandmarkHeuristic<astar::EuclideanXY>{astar::EuclideanXY{query_->xy.data()}, marker_graph_->landmarks()});
+    }
+
+    query_->start = start_pose;
+    query_->destination = destination_pose;
+
+    const auto &graph = *marker_graph_->graph;
+    query_->xy[graph.index(START_ID)] = astar::XY{start_pose.x, start_pose.y};
+    query_->xy[graph.index(DESTINATION_ID)] = astar::XY{destination_pose.x, destination_pose.y};
+
+    // Connect the start and destination poses to the graph
+    auto &edges = query_->edges;
+    edges.clear();
+
+    auto distance = start_pose.distance_xy(destination_pose);
+    if (distance < MAX_DEAD_RECKONING_DISTANCE) {
+      edges.emplace_back(START_ID, DESTINATION_ID, distance);
+    }
+
+    marker_graph_->grid.for_each_within(start_pose.x, start_pose.y, MAX_DEAD_RECKONING_DISTANCE,
+                                        [&edges](int id, double distance)
+                                        { edges.emplace_back(START_ID, id, distance); });
+
+    auto &entries = query_->entries;
+    entries.clear();
+    marker_graph_->grid.for_each_within(destination_pose.x, destination_pose.y, MAX_DEAD_RECKONING_DISTANCE,
+                                        [&edges, &entries, &graph](int id, double distance)
+                                        {
+                                          edges.emplace_back(DESTINATION_ID, id, distance);
+                                          entries.emplace_back(graph.index(id), distance);
+                                        });
+
+    // The start to destination edge isn't an entry: the shortest path never returns to the start
+    query_->solver->heuristic().set_destination(graph.index(DESTINATION_ID), entries);
+  }
+
+  bool Map::same_destination(const Pose &destination_pose) const
+  {
+    return (replan_ && replan_->destination.x == destination_pose.x && replan_->destination.y == destination_pose.y) ||
+           (query_ && query_->destination.x == destination_pose.x && query_->destination.y == destination_pose.y);
+  }
+
+  bool Map::get_waypoints(const Pose &start_pose, const Pose &destination_pose, std::vector<Pose> &waypoints) const
+  {
+    waypoints.clear();
+
+    if (!marker_graph_) {
+      RCLCPP_ERROR(logger_, "no marker graph");
+      return false;
+    }
+
+    // Replan to the same destination, e.g., because the AUV drifted or the markers moved
+    if (same_destination(destination_pose)) {
+      bool timed_out;
+      return replan_waypoints(start_pose, destination_pose, waypoints, 0, timed_out);
+    }
+
+    set_query(start_pose, destination_pose);
 
     // Find the shortest path from the start pose to the destination pose through markers
     std::vector<astar::node_type> path;
-    if (solver->find_shortest_path(START_ID, DESTINATION_ID, path)) {
+    if (query_->solver->find_shortest_path(START_ID, DESTINATION_ID, path, query_->edges)) {
       for (auto marker : path) {
-        waypoints.push_back(poses[marker]);
+        Pose waypoint = query_->pose(marker);
+        waypoint.z = cxt_.auv_z_target_;
+        waypoints.push_back(waypoint);
       }
       return true;
     } else {
@@ -67,4 +393,161 @@ namespace orca_base
     }
   }
 
+  bool Map::get_waypoints(const Pose &start_pose, const Pose &destination_pose, std::vector<Pose> &waypoints,
+                          double budget, bool &optimal) const
+  {
+    waypoints.clear();
+    optimal = false;
+
+    if (!marker_graph_) {
+      RCLCPP_ERROR(logger_, "no marker graph");
+      return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(budget);
+
+    // Replans to the same destination only repair the search tree, this is usually much faster than anytime A*
+    // Building the tree for a new destination costs about as much as A*, so give D* Lite half of the budget,
+    // and fall back to anytime A* if it runs over. The next replan resumes the interrupted repair.
+    if (same_destination(destination_pose)) {
+      bool timed_out;
+      if (replan_waypoints(start_pose, destination_pose, waypoints, budget / 2, timed_out)) {
+        // D* Lite ran to completion
+        optimal = true;
+        return true;
+      }
+
+      if (!timed_out) {
+        return false;
+      }
+
+      budget = std::max(0.0, std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count());
+      RCLCPP_INFO(logger_, "D* Lite ran over budget, anytime A* gets the remaining %g seconds", budget);
+    }
+
+    set_query(start_pose, destination_pose);
+
+    // Find the best path we can in the time available
+    std::vector<astar::node_type> path;
+    if (query_->solver->find_path_anytime(START_ID, DESTINATION_ID, path, budget, optimal, query_->edges)) {
+      for (auto marker : path) {
+        Pose waypoint = query_->pose(marker);
+        waypoint.z = cxt_.auv_z_target_;
+        waypoints.push_back(waypoint);
+      }
+      return true;
+    } else {
+      RCLCPP_ERROR(logger_, "anytime A* failed to find a path through the markers in %g seconds", budget);
+      return false;
+    }
+  }
+
+  // Give each pose a pseudo marker id, and connect the poses to each other and to the markers
+  void connect_poses(const MarkerGraph &marker_graph, const std::vector<Pose> &poses,
+                     std::vector<astar::node_type> &ids, std::vector<astar::Edge> &edges)
+  {
+    std::vector<GridItem> items;
+    for (size_t i = 0; i < poses.size(); ++i) {
+      ids.push_back(FIRST_POSE_ID - static_cast<astar::node_type>(i));
+      items.emplace_back(static_cast<int>(i), poses[i].x, poses[i].y);
+    }
+
+    // Index the poses so that we only need to test nearby poses
+    SpatialGrid pose_grid{items, MAX_DEAD_RECKONING_DISTANCE};
+
+    for (size_t i = 0; i < poses.size(); ++i) {
+      auto id = ids[i];
+
+      pose_grid.for_each_within(poses[i].x, poses[i].y, MAX_DEAD_RECKONING_DISTANCE,
+                                [&edges, &ids, i](int j, double distance)
+                                {
+                                  // Add each edge once
+                                  if (static_cast<size_t>(j) < i) {
+                                    edges.emplace_back(ids[i], ids[j], distance);
+                                  }
+                                });
+
+      marker_graph.grid.for_each_within(poses[i].x, poses[i].y, MAX_DEAD_RECKONING_DISTANCE,
+                                        [&edges, id](int marker, double distance)
+                                        { edges.emplace_back(id, marker, distance); });
+    }
+  }
+
+  // Turn a path through the pose graph into waypoints
+  void path_to_waypoints(const MarkerGraph &marker_graph, const std::vector<Pose> &poses, double z,
+                         const std::vector<astar::node_type> &path, std::vector<Pose> &waypoints)
+  {
+    for (auto node : path) {
+      Pose waypoint = node <= FIRST_POSE_ID ? poses[FIRST_POSE_ID - node] : marker_graph.poses.at(node);
+      waypoint.z = z;
+      waypoints.push_back(waypoint);
+    }
+  }
+
+  bool Map::get_waypoint_matrix(const std::vector<Pose> &poses, WaypointMatrix &matrix, bool with_waypoints) const
+  {
+    matrix.size = poses.size();
+    matrix.distances.assign(poses.size() * poses.size(), std::numeric_limits<double>::infinity());
+    matrix.waypoints.assign(with_waypoints ? poses.size() * poses.size() : 0, std::vector<Pose>{});
+
+    if (!marker_graph_) {
+      RCLCPP_ERROR(logger_, "no marker graph");
+      return false;
+    }
+
+    std::vector<astar::node_type> ids;
+    std::vector<astar::Edge> edges;
+    connect_poses(*marker_graph_, poses, ids, edges);
+    astar::Graph graph{*marker_graph_->graph, edges, ids};
+
+    // Dijkstra from each pose
+    astar::PathMatrix paths;
+    astar::find_all_shortest_paths(graph, ids, cxt_.auv_planning_threads_, paths, with_waypoints);
+
+    // Turn the paths into waypoints
+    for (size_t i = 0; i < poses.size(); ++i) {
+      for (size_t j = 0; j < poses.size(); ++j) {
+        if (i == j) {
+          matrix.distances[i * matrix.size + j] = 0;
+          continue;
+        }
+
+        matrix.distances[i * matrix.size + j] = paths.distance(i, j);
+
+        if (with_waypoints) {
+          path_to_waypoints(*marker_graph_, poses, cxt_.auv_z_target_, paths.path(i, j),
+                            matrix.waypoints[i * matrix.size + j]);
+        }
+      }
+    }
+
+    return true;
+  }
+
+  bool Map::get_leg_waypoints(const std::vector<Pose> &poses, std::vector<std::vector<Pose>> &legs) const
+  {
+    legs.assign(poses.empty() ? 0 : poses.size() - 1, std::vector<Pose>{});
+
+    if (!marker_graph_) {
+      RCLCPP_ERROR(logger_, "no marker graph");
+      return false;
+    }
+
+    std::vector<astar::node_type> ids;
+    std::vector<astar::Edge> edges;
+    connect_poses(*marker_graph_, poses, ids, edges);
+    astar::Graph graph{*marker_graph_->graph, edges, ids};
+
+    // Dijkstra from each pose to the next pose
+    std::vector<double> distances;
+    std::vector<std::vector<astar::node_type>> paths;
+    astar::find_consecutive_shortest_paths(graph, ids, cxt_.auv_planning_threads_, distances, paths);
+
+    for (size_t i = 0; i < legs.size(); ++i) {
+      path_to_waypoints(*marker_graph_, poses, cxt_.auv_z_target_, paths[i], legs[i]);
+    }
+
+    return true;
+  }
+
 } // namespace orca_base
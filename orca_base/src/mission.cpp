@@ -5,16 +5,17 @@ using namespace orca;
 namespace orca_base
 {
 
-  Mission::Mission(const rclcpp::Logger &logger, const BaseContext &cxt,
+  Mission::Mission(const rclcpp::Logger &logger,
                    std::shared_ptr<rclcpp_action::ServerGoalHandle<orca_msgs::action::Mission>> goal_handle,
                    std::shared_ptr<PlannerBase> planner, const PoseStamped &start) :
     logger_{logger},
-    cxt_{cxt},
-    goal_handle_{std::move(goal_handle)},
-    planner_{std::move(planner)}
+    cxt_{planner->cxt()},
+    planner_{std::move(planner)},
+    goal_handle_{std::move(goal_handle)}
   {
     // Create path
     RCLCPP_INFO(logger_, "mission has %d targets(s), target 1", planner_->targets().size());
+    planner_->start();
 
     // Init feedback
     if (goal_handle_) {
@@ -46,9 +47,9 @@ namespace orca_base
     int num_steps = 1;
     constexpr double MAX_STEP = 0.1;
 
-    if (dt > MAX_STEP) {
+    if (dt > MAX_STEP && !cxt_.auv_sample_segments_) {
       // The numerical approximation gets wonky if dt > 0.1. This might happen if the filter times out and restarts.
-      // Break a large dt into a number of smaller steps.
+      // Break a large dt into a number of smaller steps. Sampled segments don't need this.
       num_steps = std::ceil(dt / MAX_STEP);
       RCLCPP_DEBUG(logger_, "break dt %g into %d steps", dt, num_steps);
       dt /= num_steps;
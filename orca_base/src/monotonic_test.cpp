@@ -0,0 +1,146 @@
+#include "orca_shared/monotonic.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "nav_msgs/msg/odometry.hpp"
+
+using Msg = nav_msgs::msg::Odometry::SharedPtr;
+
+// Record what the wrappers pass through
+struct Recorder
+{
+  std::vector<int64_t> stamps;
+  std::vector<bool> firsts;
+  double sum{0};
+
+  void process(Msg msg, bool first)
+  {
+    stamps.push_back(monotonic::to_nanoseconds(msg->header.stamp));
+    firsts.push_back(first);
+  }
+
+  void process_valid(Msg msg)
+  {
+    stamps.push_back(monotonic::to_nanoseconds(msg->header.stamp));
+  }
+
+  void count(Msg msg, bool first)
+  {
+    sum += msg->pose.pose.position.x;
+  }
+};
+
+// Messages with stamps that are sometimes 0, repeated or out of order
+std::vector<Msg> make_msgs(int n, int &zero, int &out_of_order)
+{
+  std::mt19937 gen{1};
+  std::uniform_int_distribution<int> event{0, 9};
+  std::uniform_int_distribution<int64_t> step{1, 50000000};
+
+  std::vector<Msg> msgs;
+  int64_t t = 1000000000;
+  int64_t max_t = 0;
+  zero = 0;
+  out_of_order = 0;
+
+  for (int i = 0; i < n; ++i) {
+    auto msg = std::make_shared<nav_msgs::msg::Odometry>();
+    int e = event(gen);
+    int64_t stamp;
+    if (e == 0) {
+      stamp = 0;
+      ++zero;
+    } else if (e == 1) {
+      stamp = t - step(gen);
+    } else if (e == 2) {
+      stamp = t;
+    } else {
+      t += step(gen);
+      stamp = t;
+    }
+
+    if (stamp > 0 && stamp <= max_t) {
+      ++out_of_order;
+    }
+    max_t = std::max(max_t, stamp);
+
+    msg->header.stamp.sec = static_cast<int32_t>(stamp / 1000000000);
+    msg->header.stamp.nanosec = static_cast<uint32_t>(stamp % 1000000000);
+    msg->pose.pose.position.x = i;
+    msgs.push_back(msg);
+  }
+
+  return msgs;
+}
+
+// MonotonicMember and ValidMember should pass the same messages as Monotonic and Valid, and count the drops
+void test_wrappers(const std::vector<Msg> &msgs, int zero, int out_of_order)
+{
+  Recorder ref, rec, ref_valid, rec_valid;
+  std::vector<double> ref_dt, rec_dt;
+
+  monotonic::Monotonic<Recorder *, Msg> ref_cb{&ref, &Recorder::process};
+  monotonic::MonotonicMember<Recorder, Msg, &Recorder::process> rec_cb{&rec};
+  monotonic::Valid<Recorder *, Msg> ref_valid_cb{&ref_valid, &Recorder::process_valid};
+  monotonic::ValidMember<Recorder, Msg, &Recorder::process_valid> rec_valid_cb{&rec_valid};
+
+  for (const auto &msg : msgs) {
+    ref_cb.call(msg);
+    rec_cb.call(msg);
+    ref_valid_cb.call(msg);
+    rec_valid_cb.call(msg);
+    ref_dt.push_back(ref_cb.dt());
+    rec_dt.push_back(rec_cb.dt());
+  }
+
+  bool ok = ref.stamps == rec.stamps && ref.firsts == rec.firsts && ref_valid.stamps == rec_valid.stamps;
+  for (size_t i = 0; i < ref_dt.size(); ++i) {
+    ok = ok && std::abs(ref_dt[i] - rec_dt[i]) < 1e-9;
+  }
+
+  const auto &stats = rec_cb.stats();
+  ok = ok && stats.processed == rec.stamps.size() && stats.zero_stamp == static_cast<uint64_t>(zero) &&
+       stats.out_of_order == static_cast<uint64_t>(out_of_order) &&
+       rec_valid_cb.stats().zero_stamp == static_cast<uint64_t>(zero) &&
+       rec_valid_cb.stats().processed == msgs.size() - zero;
+
+  std::cout << (ok ? "success" : "failure") << std::endl;
+}
+
+void benchmark(const std::vector<Msg> &msgs)
+{
+  constexpr int REPS = 100;
+  Recorder ref, rec;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < REPS; ++r) {
+    monotonic::Monotonic<Recorder *, Msg> ref_cb{&ref, &Recorder::count};
+    for (const auto &msg : msgs) {
+      ref_cb.call(msg);
+    }
+  }
+  auto ref_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < REPS; ++r) {
+    monotonic::MonotonicMember<Recorder, Msg, &Recorder::count> rec_cb{&rec};
+    for (const auto &msg : msgs) {
+      rec_cb.call(msg);
+    }
+  }
+  auto rec_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  double n = static_cast<double>(msgs.size()) * REPS;
+  std::cout << "std::function " << ref_time / n * 1e9 << "ns, member " << rec_time / n * 1e9 << "ns per message ("
+            << ref.sum << ", " << rec.sum << ")" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  int zero, out_of_order;
+  auto msgs = make_msgs(100000, zero, out_of_order);
+  test_wrappers(msgs, zero, out_of_order);
+  benchmark(msgs);
+}
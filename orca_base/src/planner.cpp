@@ -1,13 +1,18 @@
 #include "orca_base/planner.hpp"
 
+#include <numeric>
 #include <random>
 
+#include "orca_base/tour.hpp"
+
 using namespace orca;
 
 namespace orca_base
 {
 
-  constexpr double MAX_POSE_ERROR = 0.6;
+  constexpr double MAX_POSE_ERROR = 0.6;       // Replan if the error is > this
+  constexpr double MAX_SPLICE_ERROR = 2;      // Splice if the error is < this, otherwise run A*
+  constexpr double PATH_DT = 0.5;              // Time between spline poses in the rviz path
 
   //=====================================================================================
   // Utilities
@@ -30,135 +35,569 @@ namespace orca_base
     return marker_f_world;
   }
 
+  //=====================================================================================
+  // Plan
+  //=====================================================================================
+
+  void Plan::clear()
+  {
+    pauses_.clear();
+    vertical_segments_.clear();
+    rotate_segments_.clear();
+    line_segments_.clear();
+    spline_segments_.clear();
+    order_.clear();
+    samples_.clear();
+    spline_legs_.clear();
+    controllers.clear();
+    path.poses.clear();
+  }
+
+  SegmentBase &Plan::segment(size_t i)
+  {
+    const Entry &entry = order_[i];
+    switch (entry.type) {
+      case Type::PAUSE:
+        return pauses_[entry.index];
+      case Type::VERTICAL:
+        return vertical_segments_[entry.index];
+      case Type::ROTATE:
+        return rotate_segments_[entry.index];
+      case Type::LINE:
+        return line_segments_[entry.index];
+      default:
+        return spline_segments_[entry.index];
+    }
+  }
+
+  void Plan::move_back(size_t n, size_t i)
+  {
+    assert(n <= size() && i <= size() - n);
+    std::rotate(order_.begin() + i, order_.end() - n, order_.end());
+    std::rotate(controllers.begin() + i, controllers.end() - n, controllers.end());
+  }
+
+  void Plan::erase(size_t i, size_t n)
+  {
+    order_.erase(order_.begin() + i, order_.begin() + i + n);
+    controllers.erase(controllers.begin() + i, controllers.begin() + i + n);
+  }
+
+  void Plan::compact()
+  {
+    size_t num_segments = pauses_.size() + vertical_segments_.size() + rotate_segments_.size() +
+                          line_segments_.size() + spline_segments_.size();
+    size_t num_samples = 0;
+    size_t num_legs = 0;
+    for (size_t i = 0; i < size(); ++i) {
+      num_samples += segment(i).num_samples();
+      if (order_[i].type == Type::SPLINE) {
+        num_legs += spline_segments_[order_[i].index].num_legs();
+      }
+    }
+
+    if (num_segments <= 2 * size() && samples_.size() <= 2 * num_samples && spline_legs_.size() <= 2 * num_legs) {
+      return;
+    }
+
+    compact_segments(pauses_, spare_pauses_, Type::PAUSE);
+    compact_segments(vertical_segments_, spare_vertical_segments_, Type::VERTICAL);
+    compact_segments(rotate_segments_, spare_rotate_segments_, Type::ROTATE);
+    compact_segments(line_segments_, spare_line_segments_, Type::LINE);
+    compact_segments(spline_segments_, spare_spline_segments_, Type::SPLINE);
+
+    // Segments point to the buffers, so copy the live contents back instead of swapping
+    spare_samples_.clear();
+    spare_spline_legs_.clear();
+    for (size_t i = 0; i < size(); ++i) {
+      segment(i).compact_samples(spare_samples_);
+      if (order_[i].type == Type::SPLINE) {
+        spline_segments_[order_[i].index].compact_legs(spare_spline_legs_);
+      }
+    }
+    samples_.assign(spare_samples_.begin(), spare_samples_.end());
+    spline_legs_.assign(spare_spline_legs_.begin(), spare_spline_legs_.end());
+  }
+
+  void Plan::add_pause(const rclcpp::Logger &logger, const BaseContext &cxt, const Pose &start, double seconds)
+  {
+    pauses_.emplace_back(logger, cxt, start, seconds);
+    push(pauses_, Type::PAUSE, cxt, false);
+  }
+
+  void Plan::add_vertical_segment(const rclcpp::Logger &logger, const BaseContext &cxt, const Pose &start,
+                                  const Pose &goal)
+  {
+    vertical_segments_.emplace_back(logger, cxt, start, goal);
+    push(vertical_segments_, Type::VERTICAL, cxt, cxt.auv_sample_segments_);
+  }
+
+  void Plan::add_rotate_segment(const rclcpp::Logger &logger, const BaseContext &cxt, const Pose &start,
+                                const Pose &goal)
+  {
+    rotate_segments_.emplace_back(logger, cxt, start, goal);
+    push(rotate_segments_, Type::ROTATE, cxt, cxt.auv_sample_segments_);
+  }
+
+  void Plan::add_line_segment(const rclcpp::Logger &logger, const BaseContext &cxt, const Pose &start,
+                              const Pose &goal)
+  {
+    line_segments_.emplace_back(logger, cxt, start, goal);
+    push(line_segments_, Type::LINE, cxt, cxt.auv_sample_segments_);
+  }
+
+  void Plan::add_spline_segment(const rclcpp::Logger &logger, const BaseContext &cxt, const Pose &start,
+                                const std::vector<Pose> &waypoints, const Pose &goal)
+  {
+    spline_segments_.emplace_back(logger, cxt, start, waypoints, goal, spline_legs_);
+    push(spline_segments_, Type::SPLINE, cxt, false);
+  }
+
   //=====================================================================================
   // PlannerBase
   //=====================================================================================
 
-  void PlannerBase::add_keep_station_segment(Pose &plan, double seconds)
+  PlannerBase::PlannerBase(const rclcpp::Logger &logger, const BaseContext &cxt, Map map, bool keep_station) :
+    logger_{logger}, cxt_{cxt}, map_{map, cxt_}, keep_station_{keep_station}, target_idx_{0}, segment_idx_{0},
+    splice_end_{0}, waiting_{false}, replanning_{false}, holding_{false}, path_seq_{0}, stop_{false}, request_pending_{false},
+    legs_pending_{false}, next_plan_ready_{false},
+    plan_{std::make_unique<Plan>()}, next_plan_{std::make_unique<Plan>()}, building_{std::make_unique<Plan>()}
+  {
+  }
+
+  PlannerBase::~PlannerBase()
+  {
+    {
+      std::lock_guard<PiMutex> lock{mutex_};
+      stop_ = true;
+    }
+    cv_.notify_one();
+    if (worker_.joinable()) {
+      worker_.join();
+    }
+  }
+
+  void PlannerBase::start()
+  {
+    // The worker reads targets_, so it can't start until the derived constructor is done
+    assert(!worker_.joinable());
+    worker_ = std::thread(&PlannerBase::run_worker, this);
+  }
+
+  void PlannerBase::add_keep_station_segment(Plan &plan, Pose &pose, double seconds)
   {
-    segments_.push_back(std::make_shared<Pause>(logger_, cxt_, plan, seconds));
-    controllers_.push_back(std::make_shared<SimpleController>(cxt_));
+    plan.add_pause(logger_, cxt_, pose, seconds);
   }
 
-  void PlannerBase::add_vertical_segment(Pose &plan, double z)
+  void PlannerBase::add_vertical_segment(Plan &plan, Pose &pose, double z)
   {
-    Pose goal = plan;
+    Pose goal = pose;
     goal.z = z;
-    if (plan.distance_z(goal) > EPSILON_PLAN_XYZ) {
-      segments_.push_back(std::make_shared<VerticalSegment>(logger_, cxt_, plan, goal));
-      controllers_.push_back(std::make_shared<SimpleController>(cxt_));
+    if (pose.distance_z(goal) > EPSILON_PLAN_XYZ) {
+      plan.add_vertical_segment(logger_, cxt_, pose, goal);
     } else {
       RCLCPP_INFO(logger_, "skip vertical");
     }
-    plan = goal;
+    pose = goal;
   }
 
-  void PlannerBase::add_rotate_segment(Pose &plan, double yaw)
+  void PlannerBase::add_rotate_segment(Plan &plan, Pose &pose, double yaw)
   {
-    Pose goal = plan;
+    Pose goal = pose;
     goal.yaw = yaw;
-    if (plan.distance_yaw(goal) > EPSILON_PLAN_YAW) {
-      segments_.push_back(std::make_shared<RotateSegment>(logger_, cxt_, plan, goal));
-      controllers_.push_back(std::make_shared<SimpleController>(cxt_));
+    if (pose.distance_yaw(goal) > EPSILON_PLAN_YAW) {
+      plan.add_rotate_segment(logger_, cxt_, pose, goal);
     } else {
       RCLCPP_INFO(logger_, "skip rotate");
     }
-    plan = goal;
+    pose = goal;
   }
 
-  void PlannerBase::add_line_segment(Pose &plan, double x, double y)
+  void PlannerBase::add_line_segment(Plan &plan, Pose &pose, double x, double y)
   {
-    Pose goal = plan;
+    Pose goal = pose;
     goal.x = x;
     goal.y = y;
-    if (plan.distance_xy(goal) > EPSILON_PLAN_XYZ) {
-      segments_.push_back(std::make_shared<LineSegment>(logger_, cxt_, plan, goal));
-      controllers_.push_back(std::make_shared<SimpleController>(cxt_));
+    if (pose.distance_xy(goal) > EPSILON_PLAN_XYZ) {
+      plan.add_line_segment(logger_, cxt_, pose, goal);
     } else {
       RCLCPP_INFO(logger_, "skip line");
     }
-    plan = goal;
+    pose = goal;
   }
 
-  void PlannerBase::plan_trajectory(const PoseStamped &start)
+  void PlannerBase::add_travel_segments(Plan &plan, Pose &pose, const Pose &waypoint)
   {
-    RCLCPP_INFO(logger_, "plan trajectory to (%g, %g, %g), %g",
-                targets_[target_idx_].x, targets_[target_idx_].y, targets_[target_idx_].z, targets_[target_idx_].yaw);
+    // Ascend/descend to target z
+    add_vertical_segment(plan, pose, waypoint.z);
 
-    // Generate a series of waypoints to minimize dead reckoning
-    std::vector<Pose> waypoints;
-    if (!map_.get_waypoints(start.pose, targets_[target_idx_], waypoints)) {
-      RCLCPP_ERROR(logger_, "feeling lucky");
-      waypoints.push_back(targets_[target_idx_]);
+    if (pose.distance_xy(waypoint.x, waypoint.y) > EPSILON_PLAN_XYZ) {
+      // Point in the direction of travel
+      add_rotate_segment(plan, pose, atan2(waypoint.y - pose.y, waypoint.x - pose.x));
+
+      // Travel
+      add_line_segment(plan, pose, waypoint.x, waypoint.y);
+    } else {
+      RCLCPP_DEBUG(logger_, "skip travel");
     }
+  }
 
-    // Plan trajectory through the waypoints
-    plan_trajectory(waypoints, start);
+  void PlannerBase::set_path(Plan &plan, const rclcpp::Time &t)
+  {
+    plan.path.header.stamp = t;
+    plan.path.header.frame_id = cxt_.map_frame_;
+    plan.path.poses.clear();
+
+    geometry_msgs::msg::PoseStamped pose_msg;
+    pose_msg.header.stamp = t;
+
+    for (size_t i = 0; i < plan.size(); ++i) {
+      if (plan.is_spline(i)) {
+        // A spline curves through the waypoints, draw the curve
+        plan.spline_segment(i).for_each_pose(PATH_DT, [&plan, &pose_msg](const Pose &pose)
+        {
+          pose.to_msg(pose_msg.pose);
+          plan.path.poses.push_back(pose_msg);
+        });
+      } else {
+        plan.segment(i).plan().to_msg(pose_msg.pose);
+        plan.path.poses.push_back(pose_msg);
+      }
+    }
+
+    // Add last goal pose
+    plan.back().goal().to_msg(pose_msg.pose);
+    plan.path.poses.push_back(pose_msg);
   }
 
-  void PlannerBase::plan_trajectory(const std::vector<Pose> &waypoints, const PoseStamped &start)
+  bool PlannerBase::splice(const Pose &pose)
   {
-    RCLCPP_INFO(logger_, "plan trajectory through %d waypoint(s):", waypoints.size() - 1);
-    for (auto waypoint : waypoints) {
-      RCLCPP_INFO_STREAM(logger_, waypoint);
+    Plan &plan = *plan_;
+    SegmentBase &segment = plan.segment(segment_idx_);
+
+    // If the current segment is a line, and z and yaw are still good, restart it from pose
+    if (segment.extend(pose, segment.goal())) {
+      RCLCPP_INFO(logger_, "splice: restart segment %d", segment_idx_ + 1);
+      plan.compact();
+      return true;
+    }
+
+    // If we're still in the segments from a previous splice, replace all of them
+    int end = std::max(splice_end_, segment_idx_ + 1);
+    Pose goal = plan.segment(end - 1).goal();
+
+    // Build new segments from pose to goal, the distance is short so rotate once and strafe if needed
+    size_t n = plan.size();
+    Pose p = pose;
+    add_vertical_segment(plan, p, goal.z);
+    add_rotate_segment(plan, p, goal.yaw);
+    add_line_segment(plan, p, goal.x, goal.y);
+    n = plan.size() - n;
+
+    if (n == 0) {
+      return false;
+    }
+
+    // Carry controller state across the splice
+    for (size_t i = plan.size() - n; i < plan.size(); ++i) {
+      plan.controllers[i] = plan.controllers[segment_idx_];
+    }
+
+    // The new segments replace the old segments, but a pause still needs to run
+    if (!plan.is_pause(segment_idx_)) {
+      plan.erase(segment_idx_, end - segment_idx_);
+    }
+    plan.move_back(n, segment_idx_);
+    plan.compact();
+    splice_end_ = segment_idx_ + n;
+
+    RCLCPP_INFO(logger_, "splice: %d new segment(s), segment %d of %d", n, segment_idx_ + 1, plan.size());
+    plan.segment(segment_idx_).log_info();
+    return true;
+  }
+
+  void PlannerBase::order_targets(bool random)
+  {
+    if (random) {
+      // Shuffle targets
+      std::random_device rd;
+      std::mt19937 g(rd());
+      std::shuffle(targets_.begin(), targets_.end(), g);
+      return;
+    }
+
+    if (cxt_.auv_tour_budget_ <= 0 || targets_.size() < 3) {
+      return;
+    }
+
+    // Find a short tour using the path lengths through the marker graph, not straight lines
+    WaypointMatrix matrix;
+    if (!map_.get_waypoint_matrix(targets_, matrix, false)) {
+      return;
+    }
+
+    auto tour = astar::optimize_tour(matrix.distances, matrix.size, cxt_.auv_tour_budget_);
+
+    std::vector<int> map_order(targets_.size());
+    std::iota(map_order.begin(), map_order.end(), 0);
+    RCLCPP_INFO(logger_, "tour length %g, was %g in map order",
+                astar::tour_length(matrix.distances, matrix.size, tour),
+                astar::tour_length(matrix.distances, matrix.size, map_order));
+
+    std::vector<Pose> targets;
+    for (auto i : tour) {
+      targets.push_back(targets_[i]);
+    }
+    targets_ = std::move(targets);
+  }
+
+  void PlannerBase::plan_legs()
+  {
+    {
+      std::lock_guard<PiMutex> lock{mutex_};
+      legs_pending_ = true;
+    }
+    cv_.notify_one();
+  }
+
+  void PlannerBase::plan_legs_now()
+  {
+    if (targets_.size() > 1 && map_.get_leg_waypoints(targets_, legs_)) {
+      RCLCPP_INFO(logger_, "planned %zu legs between targets", legs_.size());
+    }
+  }
+
+  void PlannerBase::set_vlam_map(fiducial_vlam_msgs::msg::Map::SharedPtr map)
+  {
+    {
+      std::lock_guard<PiMutex> lock{mutex_};
+      map_pending_ = std::move(map);
+    }
+    cv_.notify_one();
+  }
+
+  PlannerDiagnostics PlannerBase::diagnostics()
+  {
+    std::lock_guard<PiMutex> lock{mutex_};
+    return diagnostics_;
+  }
+
+  void PlannerBase::request_plan(const PoseStamped &start, double budget)
+  {
+    {
+      std::lock_guard<PiMutex> lock{mutex_};
+      request_ = Request{start, target_idx_, budget, std::chrono::steady_clock::now()};
+      request_pending_ = true;
+      diagnostics_.plans_requested++;
+    }
+    cv_.notify_one();
+    waiting_ = true;
+    replanning_ = budget > 0;
+  }
+
+  void PlannerBase::swap_plan()
+  {
+    std::lock_guard<PiMutex> lock{mutex_};
+    std::swap(plan_, next_plan_);
+    next_plan_ready_ = false;
+    diagnostics_.plans_swapped++;
+
+    // A replan starts where the AUV was a moment ago, don't reset the controller
+    if (replanning_ && !next_plan_->empty() && !plan_->empty()) {
+      plan_->controllers.front() = next_plan_->controllers[segment_idx_];
     }
 
-    // Clear existing segments
-    segments_.clear();
-    controllers_.clear();
     segment_idx_ = 0;
+    splice_end_ = 0;
+    waiting_ = false;
+    replanning_ = false;
+    holding_ = false;
+    path_seq_++;
+
+    RCLCPP_INFO(logger_, "swap in plan for target %d, latency %g seconds, segment 1 of %d",
+                plan_->target_idx + 1, diagnostics_.last_latency, plan_->size());
+    plan_->segment(0).log_info();
+  }
 
-    // Start pose
-    Pose plan = start.pose;
+  void PlannerBase::run_worker()
+  {
+    std::unique_lock<PiMutex> lock{mutex_};
+
+    while (true) {
+      cv_.wait(lock, [this] { return stop_ || map_pending_ || legs_pending_ || request_pending_; });
+
+      if (stop_) {
+        return;
+      }
+
+      if (map_pending_) {
+        // Update the map before planning anything else
+        auto map = std::move(map_pending_);
+        map_pending_ = nullptr;
+        lock.unlock();
+
+        // Pre-planned legs refer to the old marker poses
+        bool replan_legs = map_.set_vlam_map(std::move(map)) && !legs_.empty();
 
-    // Travel to each waypoint, breaking down z, yaw and xy phases
-    for (auto &waypoint : waypoints) {
-      // Ascend/descend to target z
-      add_vertical_segment(plan, waypoint.z);
+        lock.lock();
+        legs_pending_ = legs_pending_ || replan_legs;
+        continue;
+      }
 
-      if (plan.distance_xy(waypoint.x, waypoint.y) > EPSILON_PLAN_XYZ) {
-        // Point in the direction of travel
-        add_rotate_segment(plan, atan2(waypoint.y - plan.y, waypoint.x - plan.x));
+      if (request_pending_) {
+        // Plan requests come before legs, the control thread is waiting
+        Request request = request_;
+        request_pending_ = false;
+        lock.unlock();
+
+        building_->clear();
+        plan_trajectory(request, *building_);
+
+        lock.lock();
+        if (request_pending_) {
+          // Superseded by a newer request while planning, drop it
+          RCLCPP_INFO(logger_, "drop stale plan for target %d", request.target_idx + 1);
+          continue;
+        }
+
+        double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - request.requested).count();
+        diagnostics_.last_latency = latency;
+        diagnostics_.max_latency = std::max(diagnostics_.max_latency, latency);
+
+        std::swap(next_plan_, building_);
+        next_plan_ready_ = true;
+        continue;
+      }
 
-        // Travel
-        add_line_segment(plan, waypoint.x, waypoint.y);
+      if (legs_pending_) {
+        legs_pending_ = false;
+        lock.unlock();
+        plan_legs_now();
+        lock.lock();
+      }
+    }
+  }
+
+  void PlannerBase::plan_trajectory(const Request &request, Plan &plan)
+  {
+    const int target_idx = request.target_idx;
+    const PoseStamped &start = request.start;
+
+    RCLCPP_INFO(logger_, "plan trajectory to (%g, %g, %g), %g",
+                targets_[target_idx].x, targets_[target_idx].y, targets_[target_idx].z, targets_[target_idx].yaw);
+
+    waypoints_.clear();
+
+    // If we're at the previous target, use the pre-planned leg
+    if (target_idx > 0 && legs_.size() + 1 == targets_.size() &&
+        start.pose.distance_xy(targets_[target_idx - 1]) < MAX_POSE_ERROR &&
+        !legs_[target_idx - 1].empty()) {
+      waypoints_ = legs_[target_idx - 1];
+      waypoints_.front() = start.pose;
+      waypoints_.front().z = cxt_.auv_z_target_;
+    }
+
+    // Generate a series of waypoints to minimize dead reckoning
+    if (waypoints_.empty()) {
+      bool ok, optimal = true;
+      if (request.budget > 0) {
+        ok = map_.get_waypoints(start.pose, targets_[target_idx], waypoints_, request.budget, optimal);
       } else {
-        RCLCPP_DEBUG(logger_, "skip travel");
+        ok = map_.get_waypoints(start.pose, targets_[target_idx], waypoints_);
+      }
+
+      if (!ok && rejoin_prev_waypoints(start.pose, target_idx)) {
+        RCLCPP_WARN(logger_, "no path found, rejoin the current path");
+      } else if (!ok) {
+        RCLCPP_ERROR(logger_, "feeling lucky");
+        waypoints_.clear();
+        waypoints_.push_back(targets_[target_idx]);
+      } else if (!optimal) {
+        RCLCPP_WARN(logger_, "ran out of time, path may not be optimal");
       }
     }
 
-    // Always rotate to the target yaw
-    add_rotate_segment(plan, targets_[target_idx_].yaw);
+    // Plan trajectory through the waypoints
+    plan.target_idx = target_idx;
+    plan_trajectory(waypoints_, start, plan);
+
+    // Keep the waypoints, the next replan may need them
+    std::swap(prev_waypoints_, waypoints_);
+    prev_target_idx_ = target_idx;
+  }
 
-    // Keep station at the last target
-    if (keep_station_ && target_idx_ == targets_.size() - 1) {
-      add_keep_station_segment(plan, 1e6);
+  bool PlannerBase::rejoin_prev_waypoints(const Pose &start, int target_idx)
+  {
+    if (prev_target_idx_ != target_idx || prev_waypoints_.size() < 2) {
+      return false;
     }
 
-    // Create a path for diagnostics
-    if (!segments_.empty()) {
-      planned_path_.header.stamp = start.t;
-      planned_path_.header.frame_id = cxt_.map_frame_;
+    // Find the leg closest to start
+    size_t next = 1;
+    double closest = std::numeric_limits<double>::max();
+    for (size_t i = 1; i < prev_waypoints_.size(); ++i) {
+      const Pose &a = prev_waypoints_[i - 1];
+      const Pose &b = prev_waypoints_[i];
+      double dx = b.x - a.x;
+      double dy = b.y - a.y;
+      double length2 = dx * dx + dy * dy;
+      double t = length2 > 0 ? std::min(std::max(((start.x - a.x) * dx + (start.y - a.y) * dy) / length2, 0.), 1.) : 0;
+      double distance = start.distance_xy(a.x + t * dx, a.y + t * dy);
+      if (distance < closest) {
+        closest = distance;
+        next = i;
+      }
+    }
 
-      planned_path_.poses.clear();
+    // Travel from start to the end of that leg, then follow the rest of the waypoints
+    waypoints_.clear();
+    waypoints_.push_back(start);
+    waypoints_.back().z = cxt_.auv_z_target_;
+    waypoints_.insert(waypoints_.end(), prev_waypoints_.begin() + next, prev_waypoints_.end());
+    return true;
+  }
 
-      geometry_msgs::msg::PoseStamped pose_msg;
-      pose_msg.header.stamp = start.t;
+  void PlannerBase::plan_trajectory(const std::vector<Pose> &waypoints, const PoseStamped &start, Plan &plan)
+  {
+    RCLCPP_INFO(logger_, "plan trajectory through %d waypoint(s):", waypoints.size() - 1);
+    for (auto waypoint : waypoints) {
+      RCLCPP_INFO_STREAM(logger_, waypoint);
+    }
 
-      for (auto &i : segments_) {
-        planned_path_.header.frame_id = cxt_.map_frame_;
-        i->plan().to_msg(pose_msg.pose);
-        planned_path_.poses.push_back(pose_msg);
+    // Start pose
+    Pose pose = start.pose;
+
+    if (cxt_.auv_spline_trajectory_) {
+      // Travel smoothly through all waypoints, rotating to the target yaw on the way
+      Pose goal = waypoints.back();
+      goal.yaw = targets_[plan.target_idx].yaw;
+      if (pose.distance_xy(goal) > EPSILON_PLAN_XYZ || pose.distance_z(goal) > EPSILON_PLAN_XYZ ||
+          pose.distance_yaw(goal) > EPSILON_PLAN_YAW) {
+        plan.add_spline_segment(logger_, cxt_, pose, waypoints, goal);
+        pose = goal;
       }
+    } else {
+      // Travel to each waypoint, breaking down z, yaw and xy phases
+      for (auto &waypoint : waypoints) {
+        add_travel_segments(plan, pose, waypoint);
+      }
+
+      // Always rotate to the target yaw
+      add_rotate_segment(plan, pose, targets_[plan.target_idx].yaw);
+    }
+
+    // Keep station at the last target
+    if (keep_station_ && plan.target_idx == targets_.size() - 1) {
+      add_keep_station_segment(plan, pose, 1e6);
+    }
 
-      // Add last goal pose
-      segments_.back()->goal().to_msg(pose_msg.pose);
-      planned_path_.poses.push_back(pose_msg);
+    // Already at the target, keep station briefly so the plan isn't empty
+    if (plan.empty()) {
+      add_keep_station_segment(plan, pose, 0);
     }
 
-    assert(!segments_.empty());
-    RCLCPP_INFO(logger_, "segment 1 of %d", segments_.size());
-    segments_[0]->log_info();
+    // Create a path for diagnostics
+    set_path(plan, start.t);
   }
 
   int PlannerBase::advance(double dt, Pose &plan, const nav_msgs::msg::Odometry &estimate, Acceleration &u_bar,
@@ -167,42 +606,65 @@ namespace orca_base
     PoseStamped current_pose;
     current_pose.from_msg(estimate);
 
-    if (segments_.empty()) {
+    if (plan_->empty() && !waiting_) {
       if (full_pose(estimate)) {
         // Generate a trajectory to the first target
         RCLCPP_INFO(logger_, "bootstrap plan");
-        plan_trajectory(current_pose);
+        request_plan(current_pose);
       } else {
         RCLCPP_ERROR(logger_, "unknown pose, can't bootstrap");
         return AdvanceRC::FAILURE;
       }
     }
 
+    // Swap in the next plan at a segment boundary: the current plan is empty or done, and we're keeping station
+    // at the end of it. The exception is an off-course replan: the AUV is already far from the current segment,
+    // and the new plan starts from where the AUV is, so swap as soon as it's ready.
+    if (next_plan_ready_ && (plan_->empty() || replanning_ || holding_)) {
+      swap_plan();
+    }
+
+    if (plan_->empty()) {
+      // Waiting for the first plan, hover in place
+      plan = current_pose.pose;
+      u_bar = Acceleration{0, 0, cxt_.model_.hover_accel_z(), 0};
+      return AdvanceRC::CONTINUE;
+    }
+
     Acceleration ff;
 
-    if (segments_[segment_idx_]->advance(dt)) {
+    if (plan_->segment(segment_idx_).advance(dt)) {
 
       // Advance the current motion segment
-      plan = segments_[segment_idx_]->plan();
-      ff = segments_[segment_idx_]->ff();
+      plan = plan_->segment(segment_idx_).plan();
+      ff = plan_->segment(segment_idx_).ff();
 
-    } else if (++segment_idx_ < segments_.size()) {
+    } else if (segment_idx_ + 1 < plan_->size()) {
 
       // The segment is done, move to the next segment
-      RCLCPP_INFO(logger_, "segment %d of %d", segment_idx_ + 1, segments_.size());
-      segments_[segment_idx_]->log_info();
-      plan = segments_[segment_idx_]->plan();
-      ff = segments_[segment_idx_]->ff();
+      ++segment_idx_;
+      RCLCPP_INFO(logger_, "segment %d of %d", segment_idx_ + 1, plan_->size());
+      plan_->segment(segment_idx_).log_info();
+      plan = plan_->segment(segment_idx_).plan();
+      ff = plan_->segment(segment_idx_).ff();
 
-    } else if (++target_idx_ < targets_.size()) {
+    } else if (waiting_) {
+
+      // Current trajectory complete, keep station at the end until the next plan is ready
+      holding_ = true;
+      plan = plan_->segment(segment_idx_).goal();
+      ff = Acceleration{0, 0, cxt_.model_.hover_accel_z(), 0};
+
+    } else if (target_idx_ + 1 < targets_.size()) {
 
       // Current trajectory complete, move to the next target
+      ++target_idx_;
       RCLCPP_INFO(logger_, "target %d of %d", target_idx_ + 1, targets_.size());
       send_feedback(target_idx_, targets_.size());
 
       if (full_pose(estimate)) {
         // Start from known location
-        plan_trajectory(current_pose);
+        request_plan(current_pose);
         RCLCPP_INFO(logger_, "planning for next target from known pose");
       } else {
         // Plan a trajectory as if the AUV is at the previous target (it probably isn't)
@@ -211,23 +673,34 @@ namespace orca_base
         PoseStamped plan_stamped;
         plan_stamped.pose = targets_[target_idx_ - 1];
         plan_stamped.t = estimate.header.stamp;
-        plan_trajectory(plan_stamped);
+        request_plan(plan_stamped);
       }
 
-      plan = segments_[segment_idx_]->plan();
-      ff = segments_[segment_idx_]->ff();
+      // Keep station at the end of the current trajectory until the next plan is ready
+      holding_ = true;
+      plan = plan_->segment(segment_idx_).goal();
+      ff = Acceleration{0, 0, cxt_.model_.hover_accel_z(), 0};
 
     } else {
       return AdvanceRC::SUCCESS;
     }
 
     // Compute acceleration
-    controllers_[segment_idx_]->calc(cxt_, dt, plan, estimate, ff, u_bar);
-
-    // If error is > MAX_POSE_ERROR, then replan
-    if (full_pose(estimate) && current_pose.pose.distance_xy(plan) > MAX_POSE_ERROR) {
-      RCLCPP_WARN(logger_, "off by %g meters, replan to existing target", current_pose.pose.distance_xy(plan));
-      plan_trajectory(current_pose);
+    ControllerEstimate controller_estimate{current_pose.pose, estimate.pose.covariance};
+    plan_->controllers[segment_idx_].calc(cxt_, dt, plan, controller_estimate, ff, u_bar);
+
+    // If error is > MAX_POSE_ERROR, then replan, unless we're already waiting for a plan
+    if (!waiting_ && full_pose(estimate) && current_pose.pose.distance_xy(plan) > MAX_POSE_ERROR) {
+      double error = current_pose.pose.distance_xy(plan);
+      if (error < MAX_SPLICE_ERROR && splice(current_pose.pose)) {
+        // Cheap: the rest of the plan is still good, no need for A*
+        RCLCPP_WARN(logger_, "off by %g meters, spliced current segment", error);
+        set_path(*plan_, current_pose.t);
+        path_seq_++;
+      } else {
+        RCLCPP_WARN(logger_, "off by %g meters, replan to existing target", error);
+        request_plan(current_pose, cxt_.auv_replan_budget_);
+      }
     }
 
     return AdvanceRC::CONTINUE;
@@ -249,12 +722,8 @@ namespace orca_base
       targets_.push_back(target);
     }
 
-    if (random) {
-      // Shuffle targets
-      std::random_device rd;
-      std::mt19937 g(rd());
-      std::shuffle(targets_.begin(), targets_.end(), g);
-    }
+    order_targets(random);
+    plan_legs();
   }
 
   //=====================================================================================
@@ -276,12 +745,8 @@ namespace orca_base
       targets_.push_back(target);
     }
 
-    if (random) {
-      // Shuffle targets
-      std::random_device rd;
-      std::mt19937 g(rd());
-      std::shuffle(targets_.begin(), targets_.end(), g);
-    }
+    order_targets(random);
+    plan_legs();
   }
 
 } // namespace orca_base
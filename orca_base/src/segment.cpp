@@ -5,18 +5,37 @@ using namespace orca;
 namespace orca_base
 {
 
-  // Run some numerical approximations
-  constexpr int NUM_MAX_TICKS = 100;    // Max number of ticks
-  constexpr double NUM_DT = 0.1;        // Time step for each tick
-  constexpr double END_VELO_XY = 0.1;   // When xy velo is < this, end the simulation
-  constexpr double END_VELO_Z = 0.1;    // When z velo is < this, end the simulation
-  constexpr double END_VELO_YAW = 0.1;  // When yaw velo is < this, end the simulation
+  // Glide distances are computed by the model, see Model::glide_distance
+  constexpr double END_VELO_XY = 0.1;   // When xy velo is < this, end the glide
+  constexpr double END_VELO_Z = 0.1;    // When z velo is < this, end the glide
+  constexpr double END_VELO_YAW = 0.1;  // When yaw velo is < this, end the glide
+
+  // Sampled trajectories
+  constexpr double SAMPLE_DT = 0.1;         // Time between samples
+  constexpr int STEPS_PER_SAMPLE = 10;      // Integration steps between samples
+  constexpr size_t MAX_SAMPLES = 10000;     // If the trajectory is longer than this, integrate on the fly
+
+  // Interpolate between a and b, f is in [0, 1]
+  double interpolate(double a, double b, double f)
+  {
+    return a + (b - a) * f;
+  }
+
+  double interpolate_angle(double a, double b, double f)
+  {
+    return norm_angle(a + norm_angle(b - a) * f);
+  }
 
   //=====================================================================================
   // SegmentBase
   //=====================================================================================
 
   SegmentBase::SegmentBase(const rclcpp::Logger &logger, const BaseContext &cxt, const Pose &start, const Pose &goal) :
+    samples_{nullptr},
+    first_sample_{0},
+    num_samples_{0},
+    duration_{0},
+    elapsed_{0},
     logger_{logger},
     cxt_{cxt},
     plan_{start},
@@ -34,6 +53,102 @@ namespace orca_base
     twist_ = Twist{};
   }
 
+  void SegmentBase::resample()
+  {
+    if (samples_) {
+      // The old samples are left in the buffer
+      sample(*samples_);
+    }
+  }
+
+  void SegmentBase::sample(std::vector<SegmentSample> &samples)
+  {
+    samples_ = &samples;
+    first_sample_ = samples.size();
+    num_samples_ = 0;
+    duration_ = elapsed_ = 0;
+
+    // Integrate from the current state to the goal, then restore the current state
+    Pose plan = plan_;
+    Twist twist = twist_;
+    Acceleration ff = ff_;
+
+    constexpr double dt = SAMPLE_DT / STEPS_PER_SAMPLE;
+    samples.push_back(SegmentSample{plan_, twist_, ff_});
+
+    for (int steps = 1; step(dt); ++steps) {
+      duration_ += dt;
+
+      if (steps % STEPS_PER_SAMPLE == 0) {
+        if (samples.size() - first_sample_ >= MAX_SAMPLES) {
+          RCLCPP_WARN(logger_, "trajectory is longer than %g seconds, don't sample", MAX_SAMPLES * SAMPLE_DT);
+          samples.resize(first_sample_);
+          samples_ = nullptr;
+          duration_ = 0;
+          break;
+        }
+
+        samples.push_back(SegmentSample{plan_, twist_, ff_});
+      }
+    }
+
+    if (samples_) {
+      // step() called finish()
+      samples.push_back(SegmentSample{plan_, twist_, ff_});
+      num_samples_ = samples.size() - first_sample_;
+    }
+
+    plan_ = plan;
+    twist_ = twist;
+    ff_ = ff;
+  }
+
+  void SegmentBase::compact_samples(std::vector<SegmentSample> &compacted)
+  {
+    if (samples_) {
+      auto first = samples_->begin() + first_sample_;
+      first_sample_ = compacted.size();
+      compacted.insert(compacted.end(), first, first + num_samples_);
+    }
+  }
+
+  bool SegmentBase::advance(double dt)
+  {
+    if (!samples_) {
+      return step(dt);
+    }
+
+    elapsed_ += dt;
+    if (elapsed_ >= duration_) {
+      finish();
+      return false;
+    }
+
+    // Interpolate between the samples on either side of elapsed_
+    auto i = static_cast<size_t>(elapsed_ / SAMPLE_DT);
+    double t0 = i * SAMPLE_DT;
+    double t1 = std::min(t0 + SAMPLE_DT, duration_);
+    double f = (elapsed_ - t0) / (t1 - t0);
+    assert(i + 1 < num_samples_);
+    const SegmentSample &a = (*samples_)[first_sample_ + i];
+    const SegmentSample &b = (*samples_)[first_sample_ + i + 1];
+
+    plan_.x = interpolate(a.plan.x, b.plan.x, f);
+    plan_.y = interpolate(a.plan.y, b.plan.y, f);
+    plan_.z = interpolate(a.plan.z, b.plan.z, f);
+    plan_.yaw = interpolate_angle(a.plan.yaw, b.plan.yaw, f);
+
+    twist_.x = interpolate(a.twist.x, b.twist.x, f);
+    twist_.y = interpolate(a.twist.y, b.twist.y, f);
+    twist_.z = interpolate(a.twist.z, b.twist.z, f);
+    twist_.yaw = interpolate(a.twist.yaw, b.twist.yaw, f);
+
+    // Feedforward switches between constant values, don't smooth the switch
+    ff_ = a.ff;
+
+    return true;
+  }
+
   //=====================================================================================
   // Pause
   //=====================================================================================
@@ -48,7 +163,7 @@ namespace orca_base
     RCLCPP_INFO(logger_, "pause for %g seconds", seconds_);
   }
 
-  bool Pause::advance(double dt)
+  bool Pause::step(double dt)
   {
     seconds_ -= dt;
 
@@ -62,26 +177,7 @@ namespace orca_base
   // Compute the deceleration (glide) distance
   double deceleration_distance_z(const BaseContext &cxt, double velo_z)
   {
-    double z = 0;
-
-    for (int ticks = 0; ticks < NUM_MAX_TICKS; ++ticks) {
-      // Compute drag force
-      double accel_drag_z = Model::force_to_accel(-cxt.model_.drag_force_z(velo_z));
-
-      // Update velocity
-      velo_z -= accel_drag_z * NUM_DT;
-
-      // Update distance
-      z += velo_z * NUM_DT;
-
-      if (std::abs(velo_z) < END_VELO_Z) {
-        // Close enough
-        return std::abs(z);
-      }
-    }
-
-    std::cout << "deceleration_distance_z failed" << std::endl;
-    return 0;
+    return cxt.model_.glide_distance_z(velo_z, END_VELO_Z);
   }
 
   VerticalSegment::VerticalSegment(const rclcpp::Logger &logger, const BaseContext &cxt, const Pose &start,
@@ -102,7 +198,7 @@ namespace orca_base
     RCLCPP_INFO(logger_, "vertical: start %g, goal %g, ff %g", plan_.z, goal_.z, ff_.z);
   }
 
-  bool VerticalSegment::advance(double dt)
+  bool VerticalSegment::step(double dt)
   {
     double distance_remaining = plan_.distance_z(goal_);
     if (distance_remaining > EPSILON_PLAN_XYZ) {
@@ -134,26 +230,7 @@ namespace orca_base
   // Compute the deceleration (glide) distance
   double deceleration_distance_yaw(const BaseContext &cxt, double velo_yaw)
   {
-    double yaw = 0;
-
-    for (int ticks = 0; ticks < NUM_MAX_TICKS; ++ticks) {
-      // Compute drag force
-      double accel_drag_yaw = Model::torque_to_accel_yaw(-cxt.model_.drag_torque_yaw(velo_yaw));
-
-      // Update velocity
-      velo_yaw -= accel_drag_yaw * NUM_DT;
-
-      // Update distance
-      yaw = norm_angle(yaw + velo_yaw * NUM_DT);
-
-      if (std::abs(velo_yaw) < END_VELO_YAW) {
-        // Close enough
-        return std::abs(yaw);
-      }
-    }
-
-    std::cout << "deceleration_distance_yaw failed" << std::endl;
-    return 0;
+    return cxt.model_.glide_distance_yaw(velo_yaw, END_VELO_YAW);
   }
 
   RotateSegment::RotateSegment(const rclcpp::Logger &logger, const BaseContext &cxt,
@@ -173,7 +250,7 @@ namespace orca_base
     RCLCPP_INFO(logger_, "rotate: start %g, goal %g, ff %g", plan_.yaw, goal_.yaw, ff_.yaw);
   }
 
-  bool RotateSegment::advance(double dt)
+  bool RotateSegment::step(double dt)
   {
     double distance_remaining = plan_.distance_yaw(goal_);
     if (distance_remaining > EPSILON_PLAN_YAW) {
@@ -221,30 +298,11 @@ namespace orca_base
   // Compute the deceleration (glide) distance
   double deceleration_distance_xy(const BaseContext &cxt, const double yaw, double velo_x, double velo_y)
   {
-    double x = 0;
-    double y = 0;
-
-    for (int ticks = 0; ticks < NUM_MAX_TICKS; ++ticks) {
-      // Compute drag force
-      double accel_drag_x, accel_drag_y;
-      drag_force_to_accel_xy(cxt, yaw, velo_x, velo_y, accel_drag_x, accel_drag_y);
-
-      // Update velocity
-      velo_x -= accel_drag_x * NUM_DT;
-      velo_y -= accel_drag_y * NUM_DT;
-
-      // Update distance
-      x += velo_x * NUM_DT;
-      y += velo_y * NUM_DT;
-
-      if (std::hypot(velo_x, velo_y) < END_VELO_XY) {
-        // Close enough
-        return std::hypot(x, y);
-      }
-    }
+    // Rotate velocity into the body frame
+    double forward_v, strafe_v;
+    rotate_frame(velo_x, velo_y, yaw, forward_v, strafe_v);
 
-    std::cout << "deceleration_distance_xy failed" << std::endl;
-    return 0;
+    return cxt.model_.glide_distance_xy(forward_v, strafe_v, END_VELO_XY);
   }
 
   LineSegment::LineSegment(const rclcpp::Logger &logger, const BaseContext &cxt, const Pose &start, const Pose &goal) :
@@ -260,10 +318,14 @@ namespace orca_base
     if (start.distance_yaw(goal) < EPSILON_PLAN_YAW &&
         start.distance_z(goal) < EPSILON_PLAN_XYZ) {
 
-      // Change the goal and re-init
+      // Move to start, change the goal and re-init, hold z and yaw at the goal values
+      plan_.x = start.x;
+      plan_.y = start.y;
       goal_ = goal;
       init();
 
+      resample();
+
       return true;
     } else {
       return false;
@@ -286,7 +348,7 @@ namespace orca_base
                 plan_.x, plan_.y, goal_.x, goal_.y, ff_.x, ff_.y);
   }
 
-  bool LineSegment::advance(double dt)
+  bool LineSegment::step(double dt)
   {
     double distance_remaining = plan_.distance_xy(goal_);
     if (distance_remaining > EPSILON_PLAN_XYZ) {
@@ -314,4 +376,253 @@ namespace orca_base
     }
   }
 
+  //=====================================================================================
+  // SplineSegment
+  //=====================================================================================
+
+  constexpr double MIN_LEG_DURATION = 0.5;  // Shortest leg, seconds
+  constexpr int FIT_ITERATIONS = 30;        // Max attempts to fit a leg within the speed limits
+  constexpr int FIT_SAMPLES = 16;           // Check the speed limits at this many points
+  constexpr double FIT_TOLERANCE = 1.05;    // Allow a bit of overspeed
+  constexpr double FIT_STRETCH = 1.1;       // Stretch the leg by this much if it's too fast
+
+  // Quintic from p0 to p1 in time t, acceleration is 0 at both ends
+  void quintic(double p0, double v0, double p1, double v1, double t, double c[6])
+  {
+    double d = p1 - p0;
+    double t2 = t * t;
+    double t3 = t2 * t;
+
+    c[0] = p0;
+    c[1] = v0;
+    c[2] = 0;
+    c[3] = (20 * d - (8 * v1 + 12 * v0) * t) / (2 * t3);
+    c[4] = (-30 * d + (14 * v1 + 16 * v0) * t) / (2 * t3 * t);
+    c[5] = (12 * d - 6 * (v1 + v0) * t) / (2 * t3 * t2);
+  }
+
+  // Evaluate a quintic at time t
+  void evaluate(const double c[6], double t, double &p, double &v, double &a)
+  {
+    p = c[0] + t * (c[1] + t * (c[2] + t * (c[3] + t * (c[4] + t * c[5]))));
+    v = c[1] + t * (2 * c[2] + t * (3 * c[3] + t * (4 * c[4] + t * 5 * c[5])));
+    a = 2 * c[2] + t * (6 * c[3] + t * (12 * c[4] + t * 20 * c[5]));
+  }
+
+  // Fit a leg from p0 to p1, stretch the leg until it's within the speed limits
+  SplineLeg fit_leg(const BaseContext &cxt, const double p0[3], const double v0[3],
+                    const double p1[3], const double v1[3])
+  {
+    SplineLeg leg{};
+    leg.duration = std::max(std::max(std::hypot(p1[0] - p0[0], p1[1] - p0[1]) / cxt.auv_xy_speed_,
+                                     std::abs(p1[2] - p0[2]) / cxt.auv_z_speed_), MIN_LEG_DURATION);
+
+    for (int i = 0; i < FIT_ITERATIONS; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        quintic(p0[j], v0[j], p1[j], v1[j], leg.duration, leg.c[j]);
+      }
+
+      double max_xy = 0, max_z = 0;
+      for (int k = 1; k < FIT_SAMPLES; ++k) {
+        double p, v[3], a;
+        for (int j = 0; j < 3; ++j) {
+          evaluate(leg.c[j], leg.duration * k / FIT_SAMPLES, p, v[j], a);
+        }
+        max_xy = std::max(max_xy, std::hypot(v[0], v[1]));
+        max_z = std::max(max_z, std::abs(v[2]));
+      }
+
+      if (max_xy < cxt.auv_xy_speed_ * FIT_TOLERANCE && max_z < cxt.auv_z_speed_ * FIT_TOLERANCE) {
+        break;
+      }
+
+      leg.duration *= FIT_STRETCH;
+    }
+
+    return leg;
+  }
+
+  SplineSegment::SplineSegment(const rclcpp::Logger &logger, const BaseContext &cxt, const Pose &start,
+                               const std::vector<Pose> &waypoints, const Pose &goal, std::vector<SplineLeg> &legs) :
+    SegmentBase(logger, cxt, start, goal),
+    legs_{&legs},
+    first_leg_{0},
+    num_legs_{0},
+    leg_{0},
+    leg_time_{0},
+    yaw_start_{0},
+    yaw_delta_{0},
+    yaw_duration_{0},
+    time_{0}
+  {
+    init([&waypoints](size_t i) { return waypoints[i]; }, waypoints.size());
+  }
+
+  template<typename Points>
+  void SplineSegment::init(const Points &points, size_t n)
+  {
+    first_leg_ = legs_->size();
+    num_legs_ = 0;
+    leg_ = 0;
+    leg_time_ = 0;
+    time_ = 0;
+
+    auto close = [](const Pose &a, const Pose &b)
+    {
+      return a.distance_xy(b) < EPSILON_PLAN_XYZ && a.distance_z(b) < EPSILON_PLAN_XYZ;
+    };
+
+    // Find the next waypoint after i, skipping waypoints that are close to the previous waypoint or the goal
+    auto next = [&](size_t i, const Pose &prev) -> size_t
+    {
+      while (i < n && (close(points(i), prev) || close(points(i), goal_))) {
+        ++i;
+      }
+      return i;
+    };
+
+    auto point = [&](size_t i)
+    {
+      return i < n ? points(i) : goal_;
+    };
+
+    double p0[3] = {plan_.x, plan_.y, plan_.z};
+    double v0[3] = {twist_.x, twist_.y, twist_.z};
+    double legs_duration = 0;
+
+    for (size_t i = next(0, plan_); i <= n; i = next(i + 1, point(i))) {
+      Pose p = point(i);
+      double p1[3] = {p.x, p.y, p.z};
+      double v1[3] = {0, 0, 0};
+
+      if (i < n) {
+        // Point toward the next waypoint, slow down for sharp turns
+        Pose q = point(next(i + 1, p));
+        double in[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        double out[3] = {q.x - p1[0], q.y - p1[1], q.z - p1[2]};
+        double dir[3] = {q.x - p0[0], q.y - p0[1], q.z - p0[2]};
+        double len_in = std::sqrt(in[0] * in[0] + in[1] * in[1] + in[2] * in[2]);
+        double len_out = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+        double len_dir = std::sqrt(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+
+        if (len_in > 0 && len_out > 0 && len_dir > 0) {
+          double cos_turn = (in[0] * out[0] + in[1] * out[1] + in[2] * out[2]) / (len_in * len_out);
+          double dir_xy = std::hypot(dir[0], dir[1]) / len_dir;
+          double dir_z = std::abs(dir[2]) / len_dir;
+          double speed = std::min(dir_xy > 0 ? cxt_.auv_xy_speed_ / dir_xy : cxt_.auv_z_speed_,
+                                  dir_z > 0 ? cxt_.auv_z_speed_ / dir_z : cxt_.auv_xy_speed_);
+          speed *= (1 + cos_turn) / 2;
+
+          for (int j = 0; j < 3; ++j) {
+            v1[j] = dir[j] / len_dir * speed;
+          }
+        }
+      }
+
+      legs_->push_back(fit_leg(cxt_, p0, v0, p1, v1));
+      legs_duration += legs_->back().duration;
+      ++num_legs_;
+
+      std::copy(p1, p1 + 3, p0);
+      std::copy(v1, v1 + 3, v0);
+    }
+
+    // Rotate from the current yaw to the goal yaw, the peak rate of a minimum-jerk move is 1.875 * average
+    yaw_start_ = plan_.yaw;
+    yaw_delta_ = norm_angle(goal_.yaw - plan_.yaw);
+    yaw_duration_ = std::max(legs_duration, 1.875 * std::abs(yaw_delta_) / cxt_.auv_yaw_speed_);
+  }
+
+  void SplineSegment::log_info()
+  {
+    RCLCPP_INFO(logger_, "spline: start (%g, %g, %g, %g), goal (%g, %g, %g, %g), %zu legs, %g seconds",
+                plan_.x, plan_.y, plan_.z, plan_.yaw, goal_.x, goal_.y, goal_.z, goal_.yaw, num_legs_, yaw_duration_);
+  }
+
+  bool SplineSegment::extend(const Pose &start, const Pose &goal)
+  {
+    if (goal.distance_xy(goal_) > EPSILON_PLAN_XYZ || goal.distance_z(goal_) > EPSILON_PLAN_XYZ) {
+      return false;
+    }
+
+    // The remaining waypoints are at the end of the remaining legs, the last leg ends at the goal
+    auto legs = legs_;
+    size_t first = first_leg_ + leg_;
+    size_t n = leg_ + 1 < num_legs_ ? num_legs_ - leg_ - 1 : 0;
+
+    auto waypoint = [legs, first](size_t i)
+    {
+      const SplineLeg &leg = (*legs)[first + i];
+      Pose p;
+      double v, a;
+      evaluate(leg.c[0], leg.duration, p.x, v, a);
+      evaluate(leg.c[1], leg.duration, p.y, v, a);
+      evaluate(leg.c[2], leg.duration, p.z, v, a);
+      return p;
+    };
+
+    // Restart at start, keep the velocity, the old legs are left in the buffer
+    plan_ = start;
+    goal_.yaw = goal.yaw;
+    init(waypoint, n);
+
+    return true;
+  }
+
+  void SplineSegment::compact_legs(std::vector<SplineLeg> &compacted)
+  {
+    auto first = legs_->begin() + first_leg_;
+    first_leg_ = compacted.size();
+    compacted.insert(compacted.end(), first, first + num_legs_);
+  }
+
+  bool SplineSegment::step(double dt)
+  {
+    time_ += dt;
+    leg_time_ += dt;
+
+    // Move to the next leg
+    while (leg_ < num_legs_ && leg_time_ >= (*legs_)[first_leg_ + leg_].duration) {
+      leg_time_ -= (*legs_)[first_leg_ + leg_].duration;
+      ++leg_;
+    }
+
+    if (leg_ >= num_legs_ && time_ >= yaw_duration_) {
+      finish();
+      return false;
+    }
+
+    Acceleration accel;
+
+    if (leg_ < num_legs_) {
+      const SplineLeg &leg = (*legs_)[first_leg_ + leg_];
+      evaluate(leg.c[0], leg_time_, plan_.x, twist_.x, accel.x);
+      evaluate(leg.c[1], leg_time_, plan_.y, twist_.y, accel.y);
+      evaluate(leg.c[2], leg_time_, plan_.z, twist_.z, accel.z);
+    } else {
+      // Hold position while yaw finishes
+      plan_.x = goal_.x;
+      plan_.y = goal_.y;
+      plan_.z = goal_.z;
+      twist_.x = twist_.y = twist_.z = 0;
+    }
+
+    // Minimum-jerk yaw
+    double tau = std::min(time_ / yaw_duration_, 1.0);
+    double tau2 = tau * tau;
+    plan_.yaw = norm_angle(yaw_start_ + yaw_delta_ * tau2 * tau * (10 - 15 * tau + 6 * tau2));
+    twist_.yaw = yaw_delta_ * 30 * tau2 * (1 - 2 * tau + tau2) / yaw_duration_;
+    accel.yaw = yaw_delta_ * 60 * tau * (1 - 3 * tau + 2 * tau2) / (yaw_duration_ * yaw_duration_);
+
+    // Feedforward is the acceleration plus the acceleration required to counteract drag and buoyancy
+    double accel_drag_x, accel_drag_y;
+    drag_force_to_accel_xy(cxt_, plan_.yaw, twist_.x, twist_.y, accel_drag_x, accel_drag_y);
+    ff_.x = accel.x + accel_drag_x;
+    ff_.y = accel.y + accel_drag_y;
+    ff_.z = accel.z + cxt_.model_.hover_accel_z() + Model::force_to_accel(-cxt_.model_.drag_force_z(twist_.z));
+    ff_.yaw = accel.yaw + Model::torque_to_accel_yaw(-cxt_.model_.drag_torque_yaw(twist_.yaw));
+
+    return true;
+  }
+
 } // namespace orca_base
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "orca_base/spatial_grid.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace orca_base
+{
+
+  SpatialGrid::SpatialGrid(const std::vector<GridItem> &items, double cell_size) : cell_size_{cell_size}
+  {
+    if (items.empty()) {
+      return;
+    }
+
+    // Find the bounding box
+    double max_x = items[0].x;
+    double max_y = items[0].y;
+    min_x_ = items[0].x;
+    min_y_ = items[0].y;
+    for (const auto &item : items) {
+      min_x_ = std::min(min_x_, item.x);
+      min_y_ = std::min(min_y_, item.y);
+      max_x = std::max(max_x, item.x);
+      max_y = std::max(max_y, item.y);
+    }
+
+    cols_ = static_cast<int>(std::floor((max_x - min_x_) / cell_size_)) + 1;
+    rows_ = static_cast<int>(std::floor((max_y - min_y_) / cell_size_)) + 1;
+
+    // Count the items in each cell
+    offsets_.assign(cols_ * rows_ + 1, 0);
+    for (const auto &item : items) {
+      offsets_[row(item.y) * cols_ + col(item.x) + 1]++;
+    }
+
+    // Prefix sum turns counts into offsets
+    for (size_t i = 1; i < offsets_.size(); ++i) {
+      offsets_[i] += offsets_[i - 1];
+    }
+
+    // Fill in the items
+    std::vector<size_t> next{offsets_.begin(), offsets_.end() - 1};
+    items_.assign(items.size(), GridItem{0, 0, 0});
+    for (const auto &item : items) {
+      items_[next[row(item.y) * cols_ + col(item.x)]++] = item;
+    }
+  }
+
+  bool SpatialGrid::nearest(double x, double y, int &id, double &distance) const
+  {
+    if (empty()) {
+      return false;
+    }
+
+    distance = std::numeric_limits<double>::max();
+
+    auto test = [x, y, &id, &distance](const GridItem &item)
+    {
+      double d = std::hypot(item.x - x, item.y - y);
+      if (d < distance) {
+        id = item.id;
+        distance = d;
+      }
+    };
+
+    // Search rings of cells around (x, y)
+    int c0 = col(x);
+    int r0 = row(y);
+    int max_ring = std::max(cols_, rows_);
+    for (int ring = 0; ring < max_ring; ++ring) {
+      for (int r = std::max(r0 - ring, 0); r <= std::min(r0 + ring, rows_ - 1); ++r) {
+        if (r == r0 - ring || r == r0 + ring) {
+          // Top or bottom of the ring, visit every cell in the row
+          for (int c = std::max(c0 - ring, 0); c <= std::min(c0 + ring, cols_ - 1); ++c) {
+            for_each_in_cell(c, r, test);
+          }
+        } else {
+          // Sides of the ring
+          if (c0 - ring >= 0) {
+            for_each_in_cell(c0 - ring, r, test);
+          }
+          if (c0 + ring < cols_) {
+            for_each_in_cell(c0 + ring, r, test);
+          }
+        }
+      }
+
+      // Items in the next ring are at least ring * cell_size_ away
+      if (distance <= ring * cell_size_) {
+        break;
+      }
+    }
+
+    return true;
+  }
+
+} // namespace orca_base
@@ -0,0 +1,153 @@
+#include "orca_base/thrust_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "orca_shared/pwm.hpp"
+
+#include "orca_base/thrusters.hpp"
+
+using namespace orca;
+
+namespace orca_base
+{
+
+  ThrustAllocator::ThrustAllocator(const std::vector<Thruster> &thrusters) :
+    pinv_(thrusters.size()), group_(thrusters.size())
+  {
+    for (const auto &t : thrusters) {
+      b_.push_back(Wrench{t.forward_factor, t.strafe_factor, t.yaw_factor, t.vertical_factor});
+    }
+
+    // pinv = b^T (b b^T)^-1, start with m = b b^T and inv = I
+    double m[WRENCH_SIZE][WRENCH_SIZE]{};
+    double inv[WRENCH_SIZE][WRENCH_SIZE]{};
+    for (int r = 0; r < WRENCH_SIZE; ++r) {
+      for (int c = 0; c < WRENCH_SIZE; ++c) {
+        for (const auto &b : b_) {
+          m[r][c] += b[r] * b[c];
+        }
+      }
+      inv[r][r] = 1;
+    }
+
+    // Gauss-Jordan elimination with partial pivoting
+    for (int c = 0; c < WRENCH_SIZE; ++c) {
+      int pivot = c;
+      for (int r = c + 1; r < WRENCH_SIZE; ++r) {
+        if (std::abs(m[r][c]) > std::abs(m[pivot][c])) {
+          pivot = r;
+        }
+      }
+
+      // The thrusters must be able to push on every axis
+      assert(std::abs(m[pivot][c]) > 1e-9);
+
+      std::swap(m[c], m[pivot]);
+      std::swap(inv[c], inv[pivot]);
+
+      double d = m[c][c];
+      for (int k = 0; k < WRENCH_SIZE; ++k) {
+        m[c][k] /= d;
+        inv[c][k] /= d;
+      }
+
+      for (int r = 0; r < WRENCH_SIZE; ++r) {
+        if (r != c) {
+          double f = m[r][c];
+          for (int k = 0; k < WRENCH_SIZE; ++k) {
+            m[r][k] -= f * m[c][k];
+            inv[r][k] -= f * inv[c][k];
+          }
+        }
+      }
+    }
+
+    for (size_t i = 0; i < b_.size(); ++i) {
+      for (int c = 0; c < WRENCH_SIZE; ++c) {
+        pinv_[i][c] = 0;
+        for (int k = 0; k < WRENCH_SIZE; ++k) {
+          pinv_[i][c] += b_[i][k] * inv[k][c];
+        }
+      }
+    }
+
+    // The largest wrench on each axis is limited by the thruster that works hardest
+    for (int c = 0; c < WRENCH_SIZE; ++c) {
+      double peak = 0;
+      for (const auto &row : pinv_) {
+        peak = std::max(peak, std::abs(row[c]));
+      }
+      max_wrench_[c] = 1 / peak;
+    }
+  }
+
+  Wrench ThrustAllocator::wrench(const std::vector<double> &efforts) const
+  {
+    Wrench w{};
+    for (size_t i = 0; i < b_.size(); ++i) {
+      for (int c = 0; c < WRENCH_SIZE; ++c) {
+        w[c] += b_[i][c] * efforts[i];
+      }
+    }
+    return w;
+  }
+
+  Wrench ThrustAllocator::wrench(const Efforts &efforts) const
+  {
+    return Wrench{efforts.forward() * max_wrench_[WRENCH_FORWARD], efforts.strafe() * max_wrench_[WRENCH_STRAFE],
+                  efforts.yaw() * max_wrench_[WRENCH_YAW], efforts.vertical() * max_wrench_[WRENCH_VERTICAL]};
+  }
+
+  double ThrustAllocator::add_group(std::vector<double> &efforts)
+  {
+    double scale = 1;
+    for (size_t i = 0; i < group_.size(); ++i) {
+      if (group_[i] > 0) {
+        scale = std::min(scale, (THRUST_FULL_FWD - efforts[i]) / group_[i]);
+      } else if (group_[i] < 0) {
+        scale = std::min(scale, (THRUST_FULL_REV - efforts[i]) / group_[i]);
+      }
+    }
+    scale = std::max(scale, 0.0);
+
+    for (size_t i = 0; i < group_.size(); ++i) {
+      efforts[i] += scale * group_[i];
+    }
+
+    return scale;
+  }
+
+  void ThrustAllocator::allocate(const Efforts &efforts, double xy_limit, std::vector<double> &thruster_efforts)
+  {
+    Wrench w = wrench(efforts);
+    std::fill(thruster_efforts.begin(), thruster_efforts.end(), 0.0);
+
+    // Vertical
+    for (size_t i = 0; i < pinv_.size(); ++i) {
+      group_[i] = pinv_[i][WRENCH_VERTICAL] * w[WRENCH_VERTICAL];
+    }
+    add_group(thruster_efforts);
+
+    // Yaw
+    for (size_t i = 0; i < pinv_.size(); ++i) {
+      group_[i] = pinv_[i][WRENCH_YAW] * w[WRENCH_YAW];
+    }
+    add_group(thruster_efforts);
+
+    // Forward + strafe, scale down so no thruster spends more than xy_limit on it
+    double peak = 0;
+    for (size_t i = 0; i < pinv_.size(); ++i) {
+      group_[i] = pinv_[i][WRENCH_FORWARD] * w[WRENCH_FORWARD] + pinv_[i][WRENCH_STRAFE] * w[WRENCH_STRAFE];
+      peak = std::max(peak, std::abs(group_[i]));
+    }
+    if (peak > xy_limit) {
+      for (auto &g : group_) {
+        g *= xy_limit / peak;
+      }
+    }
+    add_group(thruster_efforts);
+  }
+
+} // namespace orca_base
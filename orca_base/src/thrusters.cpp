@@ -0,0 +1,102 @@
+#include "orca_base/thrusters.hpp"
+
+#include "orca_shared/pwm.hpp"
+
+using namespace orca;
+
+namespace orca_base
+{
+
+  Thrusters::Thrusters() :
+    thrusters_{
+      {"t200_link_front_right",    false, 1.0, 1.0,  1.0,  0.0},
+      {"t200_link_front_left",     false, 1.0, -1.0, -1.0, 0.0},
+      {"t200_link_rear_right",     true,  1.0, -1.0, 1.0,  0.0},
+      {"t200_link_rear_left",      true,  1.0, 1.0,  -1.0, 0.0},
+      {"t200_link_vertical_right", false, 0.0, 0.0,  0.0,  1.0},
+      {"t200_link_vertical_left",  true,  0.0, 0.0,  0.0,  -1.0},
+    },
+    efforts_(thrusters_.size()),
+    allocator_{thrusters_}
+  {}
+
+  void Thrusters::mix(const Efforts &efforts, double xy_limit)
+  {
+    for (size_t i = 0; i < thrusters_.size(); ++i) {
+      const Thruster &t = thrusters_[i];
+
+      // Clamp forward + strafe to xy_limit
+      double xy_effort = clamp(efforts.forward() * t.forward_factor + efforts.strafe() * t.strafe_factor,
+                               -xy_limit, xy_limit);
+
+      // Clamp total thrust
+      efforts_[i] = clamp(xy_effort + efforts.yaw() * t.yaw_factor + efforts.vertical() * t.vertical_factor,
+                          THRUST_FULL_REV, THRUST_FULL_FWD);
+    }
+  }
+
+  void Thrusters::to_msg(orca_msgs::msg::Control &msg) const
+  {
+    msg.thruster_pwm.resize(efforts_.size());
+    for (size_t i = 0; i < efforts_.size(); ++i) {
+      msg.thruster_pwm[i] = effort_to_pwm(efforts_[i]);
+    }
+  }
+
+  void Thrusters::update_control(const Efforts &efforts, double xy_limit, bool use_allocator,
+                                 const rclcpp::Time &stamp, const std::string &frame_id, const Pose &error,
+                                 orca_msgs::msg::Control &msg)
+  {
+    if (use_allocator) {
+      allocate(efforts, xy_limit);
+    } else {
+      mix(efforts, xy_limit);
+    }
+
+    msg.header.stamp = stamp;
+    msg.header.frame_id = frame_id;
+    error.to_msg(msg.error);
+    efforts.to_msg(msg.efforts);
+    to_msg(msg);
+  }
+
+  void Thrusters::init_markers(visualization_msgs::msg::MarkerArray &msg) const
+  {
+    msg.markers.clear();
+    for (size_t i = 0; i < thrusters_.size(); ++i) {
+      visualization_msgs::msg::Marker marker;
+      marker.header.frame_id = thrusters_[i].frame_id;
+      marker.ns = "thruster";
+      marker.id = i;
+      marker.type = visualization_msgs::msg::Marker::ARROW;
+      marker.pose.position.x = 0;
+      marker.pose.position.y = 0;
+      marker.pose.orientation.x = 0.0;
+      marker.pose.orientation.y = 0.7071068;
+      marker.pose.orientation.z = 0.0;
+      marker.pose.orientation.w = 0.7071068;
+      marker.scale.y = 0.01;
+      marker.scale.z = 0.01;
+      marker.color.a = 1.0;
+      marker.color.r = 0.0;
+      marker.color.g = 1.0;
+      marker.color.b = 0.0;
+      msg.markers.push_back(marker);
+    }
+  }
+
+  void Thrusters::update_markers(const rclcpp::Time &stamp, visualization_msgs::msg::MarkerArray &msg) const
+  {
+    for (size_t i = 0; i < thrusters_.size() && i < msg.markers.size(); ++i) {
+      double scale = (thrusters_[i].ccw ? -efforts_[i] : efforts_[i]) / 5.0;
+
+      auto &marker = msg.markers[i];
+      marker.header.stamp = stamp;
+      marker.action =
+        efforts_[i] == 0.0 ? visualization_msgs::msg::Marker::DELETE : visualization_msgs::msg::Marker::ADD;
+      marker.pose.position.z = scale > 0 ? -0.1 : 0.1;
+      marker.scale.x = scale;
+    }
+  }
+
+} // namespace orca_base
@@ -0,0 +1,258 @@
+#include "orca_base/thrusters.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+
+#include "orca_shared/pwm.hpp"
+
+using namespace orca;
+
+// Hook the global allocator, count all allocations
+static long allocations = 0;
+
+void *operator new(std::size_t size)
+{
+  ++allocations;
+  if (void *p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{ std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept
+{ std::free(p); }
+
+Efforts random_efforts(std::mt19937 &gen)
+{
+  std::uniform_real_distribution<double> effort{-1, 1};
+  Efforts efforts;
+  efforts.set_forward(effort(gen));
+  efforts.set_strafe(effort(gen));
+  efforts.set_vertical(effort(gen));
+  efforts.set_yaw(effort(gen));
+  return efforts;
+}
+
+// Thrusters::mix should match the mixer that BaseNode::publish_control used to have
+void test_mix()
+{
+  constexpr double XY_GAIN = 0.5;
+
+  orca_base::Thrusters thrusters;
+  orca_msgs::msg::Control msg;
+  std::mt19937 gen{1};
+  bool ok = true;
+
+  for (int i = 0; i < 1000; ++i) {
+    Efforts efforts = random_efforts(gen);
+    thrusters.mix(efforts, XY_GAIN);
+    thrusters.to_msg(msg);
+
+    ok = ok && msg.thruster_pwm.size() == thrusters.thrusters().size();
+    for (size_t t = 0; t < thrusters.thrusters().size(); ++t) {
+      const auto &thruster = thrusters.thrusters()[t];
+      double xy_effort = clamp(efforts.forward() * thruster.forward_factor + efforts.strafe() * thruster.strafe_factor,
+                               -XY_GAIN, XY_GAIN);
+      double expected = clamp(xy_effort + efforts.yaw() * thruster.yaw_factor +
+                              efforts.vertical() * thruster.vertical_factor, THRUST_FULL_REV, THRUST_FULL_FWD);
+      ok = ok && thrusters.efforts()[t] == expected && msg.thruster_pwm[t] == effort_to_pwm(expected);
+    }
+  }
+
+  std::cout << (ok ? "success" : "failure") << std::endl;
+}
+
+// If no thruster saturates ThrustAllocator should match the mixing table
+void test_allocate_unsaturated()
+{
+  constexpr double XY_GAIN = 0.5;
+
+  orca_base::Thrusters thrusters;
+  std::mt19937 gen{3};
+  std::uniform_real_distribution<double> effort{-1, 1};
+  bool ok = true;
+
+  for (int i = 0; i < 1000; ++i) {
+    Efforts efforts;
+    efforts.set_forward(effort(gen) * XY_GAIN / 2);
+    efforts.set_strafe(effort(gen) * XY_GAIN / 2);
+    efforts.set_yaw(effort(gen) * (1 - XY_GAIN));
+    efforts.set_vertical(effort(gen));
+
+    thrusters.mix(efforts, XY_GAIN);
+    auto expected = thrusters.efforts();
+    thrusters.allocate(efforts, XY_GAIN);
+
+    for (size_t t = 0; t < expected.size(); ++t) {
+      ok = ok && std::abs(thrusters.efforts()[t] - expected[t]) < 1e-9;
+    }
+  }
+
+  std::cout << (ok ? "success" : "failure") << std::endl;
+}
+
+// Angle between the requested and delivered forward + strafe, radians
+double xy_direction_error(const orca_base::Wrench &requested, const orca_base::Wrench &delivered)
+{
+  double r = std::atan2(requested[orca_base::WRENCH_STRAFE], requested[orca_base::WRENCH_FORWARD]);
+  double d = std::atan2(delivered[orca_base::WRENCH_STRAFE], delivered[orca_base::WRENCH_FORWARD]);
+  double error = std::abs(r - d);
+  return error > M_PI ? 2 * M_PI - error : error;
+}
+
+// Push hard on all axes and compare the delivered wrench to the mixing table:
+// ThrustAllocator should stay in bounds, deliver all of the vertical and yaw, and keep the forward + strafe direction
+void test_allocate_saturated()
+{
+  constexpr int NUM_EFFORTS = 10000;
+  constexpr double XY_GAIN = 1;
+  constexpr double EPSILON = 1e-9;
+
+  orca_base::Thrusters thrusters;
+  const auto &allocator = thrusters.allocator();
+  std::mt19937 gen{4};
+  bool ok = true;
+
+  double mix_yaw_error = 0, mix_xy_error = 0, mix_xy_norm = 0;
+  double allocate_yaw_error = 0, allocate_xy_error = 0, allocate_xy_norm = 0;
+  int saturated = 0;
+
+  for (int i = 0; i < NUM_EFFORTS; ++i) {
+    Efforts efforts = random_efforts(gen);
+    auto requested = allocator.wrench(efforts);
+    double requested_xy = std::hypot(requested[orca_base::WRENCH_FORWARD], requested[orca_base::WRENCH_STRAFE]);
+
+    thrusters.mix(efforts, XY_GAIN);
+    auto mixed = allocator.wrench(thrusters.efforts());
+    bool clamped = false;
+    for (auto e : thrusters.efforts()) {
+      clamped = clamped || std::abs(e) >= THRUST_FULL_FWD;
+    }
+    if (!clamped) {
+      continue;
+    }
+    ++saturated;
+
+    thrusters.allocate(efforts, XY_GAIN);
+    auto allocated = allocator.wrench(thrusters.efforts());
+
+    for (auto e : thrusters.efforts()) {
+      ok = ok && e >= THRUST_FULL_REV - EPSILON && e <= THRUST_FULL_FWD + EPSILON;
+    }
+    ok = ok && std::abs(allocated[orca_base::WRENCH_VERTICAL] - requested[orca_base::WRENCH_VERTICAL]) < EPSILON;
+    ok = ok && std::abs(allocated[orca_base::WRENCH_YAW] - requested[orca_base::WRENCH_YAW]) < EPSILON;
+
+    mix_yaw_error += std::abs(mixed[orca_base::WRENCH_YAW] - requested[orca_base::WRENCH_YAW]);
+    allocate_yaw_error += std::abs(allocated[orca_base::WRENCH_YAW] - requested[orca_base::WRENCH_YAW]);
+
+    double allocated_xy = std::hypot(allocated[orca_base::WRENCH_FORWARD], allocated[orca_base::WRENCH_STRAFE]);
+    if (requested_xy > 0.1 && allocated_xy > EPSILON) {
+      double error = xy_direction_error(requested, allocated);
+      ok = ok && error < 1e-6;
+      allocate_xy_error += error;
+      mix_xy_error += xy_direction_error(requested, mixed);
+    }
+
+    mix_xy_norm += std::hypot(mixed[orca_base::WRENCH_FORWARD], mixed[orca_base::WRENCH_STRAFE]);
+    allocate_xy_norm += allocated_xy;
+  }
+
+  std::cout << (ok ? "success" : "failure") << std::endl;
+  std::cout << saturated << " saturated efforts, mean yaw error: mix " << mix_yaw_error / saturated << ", allocate "
+            << allocate_yaw_error / saturated << "; mean xy direction error (degrees): mix "
+            << mix_xy_error / saturated * 180 / M_PI << ", allocate " << allocate_xy_error / saturated * 180 / M_PI
+            << "; mean xy force: mix " << mix_xy_norm / saturated << ", allocate " << allocate_xy_norm / saturated
+            << std::endl;
+}
+
+void benchmark()
+{
+  constexpr int NUM_EFFORTS = 1000;
+  constexpr int REPS = 1000;
+
+  orca_base::Thrusters thrusters;
+  std::mt19937 gen{5};
+  std::vector<Efforts> efforts;
+  for (int i = 0; i < NUM_EFFORTS; ++i) {
+    efforts.push_back(random_efforts(gen));
+  }
+
+  double sum = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < REPS; ++r) {
+    for (const auto &e : efforts) {
+      thrusters.mix(e, 0.5);
+      sum += thrusters.efforts()[0];
+    }
+  }
+  auto mix_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < REPS; ++r) {
+    for (const auto &e : efforts) {
+      thrusters.allocate(e, 0.5);
+      sum += thrusters.efforts()[0];
+    }
+  }
+  auto allocate_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  std::cout << "mix " << mix_time / (NUM_EFFORTS * REPS) * 1e9 << "ns, allocate "
+            << allocate_time / (NUM_EFFORTS * REPS) * 1e9 << "ns per call (" << sum << ")" << std::endl;
+}
+
+// Once the messages are allocated a control tick shouldn't allocate
+void test_allocations()
+{
+  constexpr int NUM_TICKS = 10000;
+
+  orca_base::Thrusters thrusters;
+  orca_msgs::msg::Control control_msg;
+  visualization_msgs::msg::MarkerArray markers_msg;
+  std::string base_frame = "base_link";
+  std::mt19937 gen{2};
+
+  thrusters.to_msg(control_msg);
+  thrusters.init_markers(markers_msg);
+
+  // BaseNode::publish_control calls update_control, then sets scalar fields, BaseNode::publish_rviz calls
+  // update_markers. Alternate between the allocator and the mixing table, like a parameter change would.
+  auto tick = [&](int i)
+  {
+    Efforts efforts = random_efforts(gen);
+    Pose error;
+    rclcpp::Time stamp{static_cast<int32_t>(i / 1000), static_cast<uint32_t>(i % 1000 * 1000000)};
+    thrusters.update_control(efforts, 0.5, i % 2 == 0, stamp, base_frame, error, control_msg);
+    thrusters.update_markers(control_msg.header.stamp, markers_msg);
+  };
+
+  // Warm up
+  for (int i = 0; i < 10; ++i) {
+    tick(i);
+  }
+
+  long before = allocations;
+  for (int i = 0; i < NUM_TICKS; ++i) {
+    tick(i);
+  }
+  long per_tick = (allocations - before) / NUM_TICKS;
+
+  std::cout << (allocations == before ? "success" : "failure") << std::endl;
+  std::cout << allocations - before << " allocations in " << NUM_TICKS << " ticks, " << per_tick << " per tick"
+            << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  test_mix();
+  test_allocate_unsaturated();
+  test_allocate_saturated();
+  test_allocations();
+  benchmark();
+}
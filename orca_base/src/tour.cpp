@@ -0,0 +1,316 @@
+#include "orca_base/tour.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace astar
+{
+
+  constexpr size_t NUM_CANDIDATES = 8;     // Moves connect a node to one of its nearest neighbors
+  constexpr int MAX_SEGMENT = 3;           // Or-opt moves runs of 1 to MAX_SEGMENT nodes
+  constexpr double UNREACHABLE = 1e9;      // Stand-in for infinity, keeps the arithmetic finite
+  constexpr double MIN_GAIN = 1e-9;        // Ignore tiny improvements, these might never end
+  constexpr int CHECK_CLOCK = 64;          // Check the clock every CHECK_CLOCK positions
+  constexpr int MAX_FAILED_KICKS = 1000;   // Give up after this many kicks without an improvement
+
+  // Improve an open tour in place
+  class TourImprover
+  {
+    const std::vector<double> &distances_;
+    int n_;
+    std::vector<int> &tour_;               // Nodes in visiting order
+    std::vector<int> pos_;                 // Position of each node in tour_
+    std::vector<int> candidates_;          // Nearest neighbors of node a are [a * k_, (a + 1) * k_)
+    size_t k_;
+
+    double d(int a, int b) const
+    {
+      double distance = distances_[a * n_ + b];
+      return std::isinf(distance) ? UNREACHABLE : distance;
+    }
+
+    // Distance between the nodes at positions i and j, 0 if either position is off the end
+    double dp(int i, int j) const
+    { return i < 0 || j < 0 || i >= n_ || j >= n_ ? 0 : d(tour_[i], tour_[j]); }
+
+    void update_pos(int l, int r)
+    {
+      for (int i = l; i <= r; ++i) {
+        pos_[tour_[i]] = i;
+      }
+    }
+
+    // Change in length if positions [l, r] are reversed
+    double reverse_delta(int l, int r) const
+    { return dp(l - 1, r) + dp(l, r + 1) - dp(l - 1, l) - dp(r, r + 1); }
+
+    void reverse(int l, int r)
+    {
+      std::reverse(tour_.begin() + l, tour_.begin() + r + 1);
+      update_pos(l, r);
+    }
+
+    // Reverse [l, r] if that makes the tour shorter
+    bool try_reverse(int l, int r)
+    {
+      if (l < r && reverse_delta(l, r) < -MIN_GAIN) {
+        reverse(l, r);
+        return true;
+      }
+      return false;
+    }
+
+    // 2-opt: connect the node at position i to a nearby node by reversing part of the tour
+    bool two_opt(int i)
+    {
+      int a = tour_[i];
+
+      // Make a the first or last node
+      if (try_reverse(0, i) || try_reverse(i, n_ - 1)) {
+        return true;
+      }
+
+      for (size_t c_idx = a * k_; c_idx < (a + 1) * k_; ++c_idx) {
+        int c = candidates_[c_idx];
+        int j = pos_[c];
+        bool succ_ok = i + 1 < n_ && d(a, c) < dp(i, i + 1);
+        bool pred_ok = i > 0 && d(a, c) < dp(i - 1, i);
+
+        // Candidates are sorted, so no other candidate will help
+        if (!succ_ok && !pred_ok) {
+          break;
+        }
+
+        if (succ_ok && (j > i ? try_reverse(i + 1, j) : try_reverse(j + 1, i))) {
+          return true;
+        }
+
+        if (pred_ok && (j < i ? try_reverse(j, i - 1) : try_reverse(i, j - 1))) {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    // Or-opt: move the run of nodes at positions [i, i + len) next to a nearby node, possibly reversed
+    bool or_opt(int i, int len)
+    {
+      int last = i + len - 1;
+      if (last >= n_) {
+        return false;
+      }
+
+      // Gain from removing the run and closing the gap
+      double remove_gain = dp(i - 1, i) + dp(last, last + 1) - dp(i - 1, last + 1);
+
+      for (int end = 0; end < 2; ++end) {
+        int x = tour_[end ? last : i];     // End of the run next to the nearby node
+        int y = tour_[end ? i : last];     // Other end of the run
+
+        for (size_t c_idx = x * k_; c_idx < (x + 1) * k_; ++c_idx) {
+          int c = candidates_[c_idx];
+          int j = pos_[c];
+
+          if (d(x, c) >= remove_gain) {
+            break;
+          }
+
+          if (j >= i && j <= last) {
+            continue;
+          }
+
+          // Insert between positions u and u + 1, with x next to c
+          for (int u = j - 1; u <= j; ++u) {
+            if (u >= i - 1 && u <= last) {
+              continue;
+            }
+
+            bool c_left = u == j;
+            int other = c_left ? u + 1 : u;
+            double add = d(c, x) + (other < 0 || other >= n_ ? 0 : d(y, tour_[other])) - dp(u, u + 1);
+            if (add - remove_gain >= -MIN_GAIN) {
+              continue;
+            }
+
+            // Move the run, then flip it if needed
+            int l, r;
+            if (u > last) {
+              std::rotate(tour_.begin() + i, tour_.begin() + last + 1, tour_.begin() + u + 1);
+              update_pos(i, u);
+              l = u + 1 - len;
+            } else {
+              std::rotate(tour_.begin() + u + 1, tour_.begin() + i, tour_.begin() + last + 1);
+              update_pos(u + 1, last);
+              l = u + 1;
+            }
+            r = l + len - 1;
+
+            if (tour_[c_left ? l : r] != x) {
+              reverse(l, r);
+            }
+
+            return true;
+          }
+        }
+      }
+
+      return false;
+    }
+
+  public:
+
+    TourImprover(const std::vector<double> &distances, size_t n, std::vector<int> &tour) :
+      distances_{distances}, n_{static_cast<int>(n)}, tour_{tour}, pos_(n), k_{std::min(NUM_CANDIDATES, n - 1)}
+    {
+      update_pos(0, n_ - 1);
+
+      // Find the nearest neighbors of each node
+      candidates_.reserve(n * k_);
+      std::vector<int> others;
+      for (int a = 0; a < n_; ++a) {
+        others.clear();
+        for (int b = 0; b < n_; ++b) {
+          if (b != a) {
+            others.push_back(b);
+          }
+        }
+
+        auto closer = [this, a](int b1, int b2)
+        { return d(a, b1) < d(a, b2); };
+
+        std::partial_sort(others.begin(), others.begin() + k_, others.end(), closer);
+        candidates_.insert(candidates_.end(), others.begin(), others.begin() + k_);
+      }
+    }
+
+    // Run passes over the tour until nothing improves, return false if we ran out of time
+    bool local_search(std::chrono::steady_clock::time_point deadline)
+    {
+      int count = 0;
+
+      for (bool improved = true; improved;) {
+        improved = false;
+
+        for (int i = 0; i < n_; ++i) {
+          if (++count % CHECK_CLOCK == 0 && std::chrono::steady_clock::now() > deadline) {
+            return false;
+          }
+
+          bool moved = two_opt(i);
+          for (int len = 1; !moved && len <= MAX_SEGMENT; ++len) {
+            moved = or_opt(i, len);
+          }
+          improved |= moved;
+        }
+      }
+
+      return true;
+    }
+
+    double length() const
+    {
+      double length = 0;
+      for (int i = 1; i < n_; ++i) {
+        length += dp(i - 1, i);
+      }
+      return length;
+    }
+
+    // Iterated local search: find a local minimum, then use the rest of the budget to kick the tour
+    // out of the local minimum with a random double bridge move, and keep the result if it's better
+    void run(std::chrono::steady_clock::time_point deadline)
+    {
+      if (!local_search(deadline)) {
+        return;
+      }
+
+      std::mt19937 gen{1};
+      std::uniform_int_distribution<int> pick{1, n_ - 1};
+      std::vector<int> best = tour_;
+      double best_length = length();
+
+      for (int failed = 0; failed < MAX_FAILED_KICKS && std::chrono::steady_clock::now() < deadline;) {
+        // Double bridge: A B C D => A C B D
+        int cuts[3] = {pick(gen), pick(gen), pick(gen)};
+        std::sort(cuts, cuts + 3);
+        if (cuts[0] == cuts[1] || cuts[1] == cuts[2]) {
+          continue;
+        }
+        std::rotate(tour_.begin() + cuts[0], tour_.begin() + cuts[1], tour_.begin() + cuts[2]);
+        update_pos(cuts[0], cuts[2] - 1);
+
+        bool finished = local_search(deadline);
+        double new_length = length();
+
+        if (new_length < best_length - MIN_GAIN) {
+          best = tour_;
+          best_length = new_length;
+          failed = 0;
+        } else {
+          tour_ = best;
+          update_pos(0, n_ - 1);
+          ++failed;
+        }
+
+        if (!finished) {
+          break;
+        }
+      }
+
+      tour_ = best;
+    }
+  };
+
+  std::vector<int> optimize_tour(const std::vector<double> &distances, size_t n, double budget)
+  {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(budget));
+
+    std::vector<int> tour;
+    if (n == 0) {
+      return tour;
+    }
+
+    auto d = [&distances, n](size_t a, size_t b)
+    {
+      double distance = distances[a * n + b];
+      return std::isinf(distance) ? UNREACHABLE : distance;
+    };
+
+    // Nearest neighbor, starting at node 0
+    std::vector<char> visited(n, 0);
+    tour.push_back(0);
+    visited[0] = 1;
+    while (tour.size() < n) {
+      size_t a = tour.back();
+      size_t next = n;
+      for (size_t b = 0; b < n; ++b) {
+        if (!visited[b] && (next == n || d(a, b) < d(a, next))) {
+          next = b;
+        }
+      }
+      tour.push_back(static_cast<int>(next));
+      visited[next] = 1;
+    }
+
+    if (n > 3 && budget > 0) {
+      TourImprover{distances, n, tour}.run(deadline);
+    }
+
+    return tour;
+  }
+
+  double tour_length(const std::vector<double> &distances, size_t n, const std::vector<int> &tour)
+  {
+    double length = 0;
+    for (size_t i = 1; i < tour.size(); ++i) {
+      length += distances[tour[i - 1] * n + tour[i]];
+    }
+    return length;
+  }
+
+} // namespace astar
@@ -1,17 +1,20 @@
 #ifndef ORCA_FILTER_FILTER_H
 #define ORCA_FILTER_FILTER_H
 
-#include <queue>
+#include <algorithm>
+#include <deque>
+#include <vector>
 
 #include "geometry_msgs/msg/pose_with_covariance_stamped.hpp"
 #include "nav_msgs/msg/odometry.hpp"
-#include "ukf/ukf.hpp"
 
 #include "orca_msgs/msg/depth.hpp"
 
 #include "orca_shared/geometry.hpp"
+#include "orca_shared/util.hpp"
 
 #include "orca_filter/filter_context.hpp"
+#include "orca_filter/ukf.hpp"
 
 namespace orca_filter
 {
@@ -29,6 +32,11 @@ namespace orca_filter
   constexpr double MAX_PREDICTED_VELO_XYZ = 100;
   constexpr double MAX_PREDICTED_VELO_RPY = 100;
 
+  // State dimensions
+  constexpr int DEPTH_STATE_DIM = 3;      // [z, vz, az]T
+  constexpr int FOUR_STATE_DIM = 12;      // [x, y, z, yaw, vx, vy, vz, vyaw, ax, ay, az, ayaw]T
+  constexpr int POSE_STATE_DIM = 18;      // [x, y, ..., vx, vy, ..., ax, ay, ...]T
+
   //==================================================================
   // Unscented residual and mean functions for PoseFilter 6dof state (x) and 6dof pose measurement (z)
   //
@@ -42,49 +50,132 @@ namespace orca_filter
   // See https://en.wikipedia.org/wiki/Mean_of_circular_quantities for the method used here.
   //
   // There are similar residual and mean functions for FourFilter 4dof state (x) and 4dof pose measurement (z)
+  //
+  // These are templates so they work with the fixed-size state and the bounded measurement types.
   //==================================================================
 
-  Eigen::VectorXd six_state_residual(const Eigen::Ref<const Eigen::VectorXd> &x, const Eigen::VectorXd &mean);
+  template<typename Vector>
+  Vector six_state_residual(const Eigen::Ref<const Vector> &x, const Vector &mean)
+  {
+    // Residual for all fields
+    Vector residual = x - mean;
+
+    // Normalize roll, pitch and yaw
+    residual(3) = orca::norm_angle(residual(3));
+    residual(4) = orca::norm_angle(residual(4));
+    residual(5) = orca::norm_angle(residual(5));
+
+    return residual;
+  }
+
+  template<typename Vector, typename SigmaPoints, typename Weights>
+  Vector six_state_mean(const SigmaPoints &sigma_points, const Weights &Wm)
+  {
+    // Standard mean for all fields
+    Vector mean = sigma_points * Wm.transpose();
+
+    // Sum the sines and cosines
+    double sum_r_sin = 0.0, sum_r_cos = 0.0;
+    double sum_p_sin = 0.0, sum_p_cos = 0.0;
+    double sum_y_sin = 0.0, sum_y_cos = 0.0;
+
+    for (long i = 0; i < sigma_points.cols(); ++i) {
+      sum_r_sin += Wm(i) * sin(sigma_points(3, i));
+      sum_r_cos += Wm(i) * cos(sigma_points(3, i));
+
+      sum_p_sin += Wm(i) * sin(sigma_points(4, i));
+      sum_p_cos += Wm(i) * cos(sigma_points(4, i));
+
+      sum_y_sin += Wm(i) * sin(sigma_points(5, i));
+      sum_y_cos += Wm(i) * cos(sigma_points(5, i));
+    }
+
+    // Mean is arctan2 of the sums
+    mean(3) = atan2(sum_r_sin, sum_r_cos);
+    mean(4) = atan2(sum_p_sin, sum_p_cos);
+    mean(5) = atan2(sum_y_sin, sum_y_cos);
+
+    return mean;
+  }
+
+  template<typename Vector>
+  Vector four_state_residual(const Eigen::Ref<const Vector> &x, const Vector &mean)
+  {
+    // Residual for all fields
+    Vector residual = x - mean;
+
+    // Normalize yaw
+    residual(3) = orca::norm_angle(residual(3));
 
-  Eigen::VectorXd six_state_mean(const Eigen::MatrixXd &sigma_points, const Eigen::RowVectorXd &Wm);
+    return residual;
+  }
+
+  template<typename Vector, typename SigmaPoints, typename Weights>
+  Vector four_state_mean(const SigmaPoints &sigma_points, const Weights &Wm)
+  {
+    // Standard mean for all fields
+    Vector mean = sigma_points * Wm.transpose();
+
+    // Sum the sines and cosines
+    double sum_y_sin = 0.0, sum_y_cos = 0.0;
+
+    for (long i = 0; i < sigma_points.cols(); ++i) {
+      sum_y_sin += Wm(i) * sin(sigma_points(3, i));
+      sum_y_cos += Wm(i) * cos(sigma_points(3, i));
+    }
 
-  Eigen::VectorXd four_state_residual(const Eigen::Ref<const Eigen::VectorXd> &x, const Eigen::VectorXd &mean);
+    // Mean is arctan2 of the sums
+    mean(3) = atan2(sum_y_sin, sum_y_cos);
 
-  Eigen::VectorXd four_state_mean(const Eigen::MatrixXd &sigma_points, const Eigen::RowVectorXd &Wm);
+    return mean;
+  }
 
   //=============================================================================
   // Utility for 6dof covariance matrices
   //=============================================================================
 
-  void flatten_6x6_covar(const Eigen::MatrixXd &m, std::array<double, 36> &covar, int offset);
+  template<typename Matrix>
+  void flatten_6x6_covar(const Matrix &m, std::array<double, 36> &covar, int offset)
+  {
+    for (int i = 0; i < 6; i++) {
+      for (int j = 0; j < 6; j++) {
+        covar[i * 6 + j] = m(i + offset, j + offset);
+      }
+    }
+  }
 
   //=============================================================================
   // Measurements
   //=============================================================================
 
+  template<int STATE_DIM>
   struct Measurement
   {
+    using Ukf = UnscentedKalmanFilter<STATE_DIM>;
+
     rclcpp::Time stamp_;
-    Eigen::VectorXd z_;
-    Eigen::MatrixXd R_;
-    ukf::MeasurementFn h_fn_;
-    ukf::ResidualFn r_z_fn_;
-    ukf::UnscentedMeanFn mean_z_fn_;
+    typename Ukf::MeasurementVector z_;
+    typename Ukf::MeasurementMatrix R_;
+    typename Ukf::MeasurementFn h_fn_;
+    typename Ukf::MeasurementResidualFn r_z_fn_;
+    typename Ukf::MeasurementMeanFn mean_z_fn_;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-    // Must be default constructible to be used in a priority queue
+    // Must be default constructible
     Measurement() = default;
 
     // 1dof z measurement from a depth message
-    void init_z(const orca_msgs::msg::Depth &depth, ukf::MeasurementFn h_fn);
+    void init_z(const orca_msgs::msg::Depth &depth, typename Ukf::MeasurementFn h_fn);
 
     // 4dof measurement from a pose message
-    void init_4dof(const geometry_msgs::msg::PoseWithCovarianceStamped &pose, ukf::MeasurementFn h_fn);
+    void init_4dof(const geometry_msgs::msg::PoseWithCovarianceStamped &pose, typename Ukf::MeasurementFn h_fn);
 
     // 6dof measurement from a pose message
-    void init_6dof(const geometry_msgs::msg::PoseWithCovarianceStamped &pose, ukf::MeasurementFn h_fn);
+    void init_6dof(const geometry_msgs::msg::PoseWithCovarianceStamped &pose, typename Ukf::MeasurementFn h_fn);
 
-    // Sort by time
-    bool operator()(const Measurement &a, const Measurement &b)
+    // Sort by time, oldest at the top of the measurement heap
+    static bool newer(const Measurement &a, const Measurement &b)
     {
       return a.stamp_ > b.stamp_;
     }
@@ -94,41 +185,81 @@ namespace orca_filter
   // Filter state
   //=============================================================================
 
+  template<int STATE_DIM>
   struct State
   {
+    using Ukf = UnscentedKalmanFilter<STATE_DIM>;
+
     rclcpp::Time stamp_;
-    Eigen::VectorXd x_;
-    Eigen::MatrixXd P_;
+    typename Ukf::StateVector x_;
+    typename Ukf::StateMatrix P_;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
     // Must be default constructible
     State() = default;
 
-    State(const rclcpp::Time &stamp, Eigen::VectorXd x, Eigen::MatrixXd P) :
-      stamp_{stamp}, x_{std::move(x)}, P_{std::move(P)}
+    State(const rclcpp::Time &stamp, const typename Ukf::StateVector &x, const typename Ukf::StateMatrix &P) :
+      stamp_{stamp}, x_{x}, P_{P}
     {}
   };
 
   //=============================================================================
-  // Filter base
+  // Filter base, the interface used by FilterNode
   //=============================================================================
 
   class FilterBase
   {
-    const rclcpp::Duration HISTORY_LENGTH{RCL_S_TO_NS(1)};
+  public:
 
-    int state_dim_;
+    virtual ~FilterBase() = default;
+
+    // Reset the filter with a pose
+    virtual void reset(const geometry_msgs::msg::Pose &pose) = 0;
+
+    // Is the filter valid?
+    virtual bool filter_valid() const = 0;
+
+    // Process a message
+    virtual bool process_message(const orca_msgs::msg::Depth &msg, const orca::Acceleration &u_bar,
+                                 nav_msgs::msg::Odometry &filtered_odom) = 0;
+
+    virtual bool process_message(const geometry_msgs::msg::PoseWithCovarianceStamped &msg,
+                                 const orca::Acceleration &u_bar, nav_msgs::msg::Odometry &filtered_odom) = 0;
+  };
+
+  //=============================================================================
+  // Filter with a fixed state dimension
+  //
+  // All of the Eigen types have compile-time sizes (or fixed max sizes for measurements),
+  // so the filter doesn't allocate on the heap in predict() or update().
+  //=============================================================================
+
+  template<int STATE_DIM>
+  class Filter : public FilterBase
+  {
+  public:
+
+    using Ukf = UnscentedKalmanFilter<STATE_DIM>;
+    using StateVector = typename Ukf::StateVector;
+    using StateMatrix = typename Ukf::StateMatrix;
+
+  private:
+
+    const rclcpp::Duration HISTORY_LENGTH{RCL_S_TO_NS(1)};
 
     // Current time of filter
     rclcpp::Time filter_time_;
 
-    // Measurement priority queue, sorted from oldest to newest
-    std::priority_queue<Measurement, std::vector<Measurement>, Measurement> measurement_q_;
+    // Measurement priority queue, a heap ordered by Measurement::newer
+    // Not a std::priority_queue, which can't move the top measurement out
+    std::vector<Measurement<STATE_DIM>, Eigen::aligned_allocator<Measurement<STATE_DIM>>> measurement_q_;
 
     // State history, ordered from oldest to newest
-    std::deque<State> state_history_;
+    std::deque<State<STATE_DIM>, Eigen::aligned_allocator<State<STATE_DIM>>> state_history_;
 
     // Measurement history, ordered from oldest to newest
-    std::deque<Measurement> measurement_history_;
+    std::deque<Measurement<STATE_DIM>, Eigen::aligned_allocator<Measurement<STATE_DIM>>> measurement_history_;
 
     // Call filter_->predict
     void predict(const rclcpp::Time &stamp, const orca::Acceleration &u_bar);
@@ -139,68 +270,83 @@ namespace orca_filter
     // Rewind to a previous state
     bool rewind(const rclcpp::Time &stamp);
 
+    template<typename T>
+    bool process_message_t(const T &msg, const orca::Acceleration &u_bar, nav_msgs::msg::Odometry &filtered_odom)
+    {
+      rclcpp::Time stamp{msg.header.stamp};
+
+      if (stamp < filter_time_ && !rewind(stamp)) {
+        // This message is out of order, and we can't rewind history
+        return false;
+      }
+
+      // Add this message to the priority queue
+      measurement_q_.push_back(to_measurement(msg));
+      std::push_heap(measurement_q_.begin(), measurement_q_.end(), Measurement<STATE_DIM>::newer);
+
+      // Process one or more measurements
+      return process(stamp, u_bar, filtered_odom);
+    }
+
   protected:
 
     rclcpp::Logger logger_;
     const FilterContext &cxt_;
 
-    ukf::UnscentedKalmanFilter filter_;
+    Ukf filter_;
 
     // Reset the filter with an Eigen vector
-    void reset(const Eigen::VectorXd &x);
+    void reset(const StateVector &x);
 
     virtual void odom_from_filter(nav_msgs::msg::Odometry &filtered_odom) = 0;
 
     // Convert a Depth message to a Measurement
-    virtual Measurement to_measurement(const orca_msgs::msg::Depth &depth) const = 0;
+    virtual Measurement<STATE_DIM> to_measurement(const orca_msgs::msg::Depth &depth) const = 0;
 
     // Convert PoseWithCovarianceStamped message to a Measurement
-    virtual Measurement to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const = 0;
+    virtual Measurement<STATE_DIM> to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const = 0;
 
   public:
 
-    explicit FilterBase(const rclcpp::Logger &logger, const FilterContext &cxt_, int state_dim);
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    explicit Filter(const rclcpp::Logger &logger, const FilterContext &cxt);
 
     // Reset the filter
     void reset();
 
-    // Reset the filter with a pose
-    virtual void reset(const geometry_msgs::msg::Pose &pose) = 0;
-
     // Is the filter valid?
-    bool filter_valid()
+    bool filter_valid() const override
     { return filter_.valid(); }
 
     // Process a message
-    template<typename T>
-    bool process_message(const T &msg, const orca::Acceleration &u_bar, nav_msgs::msg::Odometry &filtered_odom)
-    {
-      rclcpp::Time stamp{msg.header.stamp};
+    bool process_message(const orca_msgs::msg::Depth &msg, const orca::Acceleration &u_bar,
+                         nav_msgs::msg::Odometry &filtered_odom) override
+    { return process_message_t(msg, u_bar, filtered_odom); }
 
-      if (stamp < filter_time_ && !rewind(stamp)) {
-        // This message is out of order, and we can't rewind history
-        return false;
-      }
-
-      // Add this message to the priority queue
-      measurement_q_.push(to_measurement(msg));
-
-      // Process one or more measurements
-      return process(stamp, u_bar, filtered_odom);
-    }
+    bool process_message(const geometry_msgs::msg::PoseWithCovarianceStamped &msg, const orca::Acceleration &u_bar,
+                         nav_msgs::msg::Odometry &filtered_odom) override
+    { return process_message_t(msg, u_bar, filtered_odom); }
   };
 
+  extern template struct Measurement<DEPTH_STATE_DIM>;
+  extern template struct Measurement<FOUR_STATE_DIM>;
+  extern template struct Measurement<POSE_STATE_DIM>;
+  extern template class Filter<DEPTH_STATE_DIM>;
+  extern template class Filter<FOUR_STATE_DIM>;
+  extern template class Filter<POSE_STATE_DIM>;
+
   //=============================================================================
   // Filter only z (depth)
   //=============================================================================
 
-  class DepthFilter : public FilterBase
+  class DepthFilter : public Filter<DEPTH_STATE_DIM>
   {
     void odom_from_filter(nav_msgs::msg::Odometry &filtered_odom) override;
 
-    Measurement to_measurement(const orca_msgs::msg::Depth &depth) const override;
+    Measurement<DEPTH_STATE_DIM> to_measurement(const orca_msgs::msg::Depth &depth) const override;
 
-    Measurement to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const override;
+    Measurement<DEPTH_STATE_DIM> to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const override;
 
   public:
 
@@ -214,13 +360,13 @@ namespace orca_filter
   // Filter 4 DoF, assume roll and pitch are always 0
   //=============================================================================
 
-  class FourFilter : public FilterBase
+  class FourFilter : public Filter<FOUR_STATE_DIM>
   {
     void odom_from_filter(nav_msgs::msg::Odometry &filtered_odom) override;
 
-    Measurement to_measurement(const orca_msgs::msg::Depth &depth) const override;
+    Measurement<FOUR_STATE_DIM> to_measurement(const orca_msgs::msg::Depth &depth) const override;
 
-    Measurement to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const override;
+    Measurement<FOUR_STATE_DIM> to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const override;
 
   public:
 
@@ -234,7 +380,7 @@ namespace orca_filter
   // Filter all 6 DoF
   //=============================================================================
 
-  class PoseFilter : public FilterBase
+  class PoseFilter : public Filter<POSE_STATE_DIM>
   {
     void odom_from_filter(nav_msgs::msg::Odometry &filtered_odom) override;
 
@@ -245,9 +391,9 @@ namespace orca_filter
     // Reset the filter with a pose
     void reset(const geometry_msgs::msg::Pose &pose) override;
 
-    Measurement to_measurement(const orca_msgs::msg::Depth &depth) const override;
+    Measurement<POSE_STATE_DIM> to_measurement(const orca_msgs::msg::Depth &depth) const override;
 
-    Measurement to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const override;
+    Measurement<POSE_STATE_DIM> to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const override;
   };
 
 } // namespace orca_filter
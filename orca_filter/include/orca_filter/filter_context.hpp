@@ -42,6 +42,8 @@ namespace orca_filter
   CXT_MACRO_MEMBER(outlier_distance, double, 4.0)             /* Reject measurements > n std devs from estimate  */ \
   \
   CXT_MACRO_MEMBER(four_dof, bool, false)                     /* Experiment: run 4dof filter instead of 6dof filter  */ \
+  \
+  CXT_MACRO_MEMBER(executor_threads, int, 1)                  /* Executor threads, 1 for single-threaded, 0 for 1 per cpu, read at startup  */ \
 /* End of list */
 
 #undef CXT_MACRO_MEMBER
@@ -1,6 +1,8 @@
 #ifndef ORCA_FILTER_FILTER_NODE_HPP
 #define ORCA_FILTER_FILTER_NODE_HPP
 
+#include <mutex>
+
 #include "urdf/model.h"
 #include "tf2_msgs/msg/tf_message.hpp"
 
@@ -31,6 +33,13 @@ namespace orca_filter
     //
     // Both filters publish odometry. The depth filter publishes very high (>1e4) covariance values for most dimensions.
 
+    // Sensors are in separate callback groups, so with a multi-threaded executor each sensor is handled in order,
+    // but different sensors are handled in parallel. Measurements may reach the filter out of order, the filter
+    // rewinds to handle this.
+    //
+    // The filter and the state below are guarded by mutex_. Publishing is done without the lock.
+    std::mutex mutex_;
+
     bool receiving_poses_{false};
     std::shared_ptr<FilterBase> filter_;
     rclcpp::Time last_pose_received_{0, 0, RCL_ROS_TIME};
@@ -67,6 +76,11 @@ namespace orca_filter
     rclcpp::Publisher<geometry_msgs::msg::PoseWithCovarianceStamped>::SharedPtr rcam_pub_;
     rclcpp::Publisher<tf2_msgs::msg::TFMessage>::SharedPtr tf_pub_;
 
+    rclcpp::callback_group::CallbackGroup::SharedPtr baro_group_;
+    rclcpp::callback_group::CallbackGroup::SharedPtr fcam_group_;
+    rclcpp::callback_group::CallbackGroup::SharedPtr lcam_group_;
+    rclcpp::callback_group::CallbackGroup::SharedPtr rcam_group_;
+
     rclcpp::Subscription<orca_msgs::msg::Barometer>::SharedPtr baro_sub_;
     rclcpp::Subscription<orca_msgs::msg::Control>::SharedPtr control_sub_;
     rclcpp::Subscription<geometry_msgs::msg::PoseWithCovarianceStamped>::SharedPtr fcam_sub_;
@@ -76,7 +90,7 @@ namespace orca_filter
     // Validate parameters
     void validate_parameters();
 
-    // Create the filter
+    // Create the filter, call with mutex_ held
     void create_filter();
 
     // Parse urdf
@@ -96,14 +110,14 @@ namespace orca_filter
     void rcam_callback(geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr msg, bool first);
 
     // Callback wrappers
-    monotonic::Monotonic<FilterNode *, const orca_msgs::msg::Barometer::SharedPtr> baro_cb_{this, &FilterNode::baro_callback};
-    monotonic::Monotonic<FilterNode *, const orca_msgs::msg::Control::SharedPtr> control_cb_{this, &FilterNode::control_callback};
-    monotonic::Monotonic<FilterNode *,
-      const geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr> fcam_cb_{this, &FilterNode::fcam_callback};
-    monotonic::Monotonic<FilterNode *,
-      const geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr> lcam_cb_{this, &FilterNode::lcam_callback};
-    monotonic::Monotonic<FilterNode *,
-      const geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr> rcam_cb_{this, &FilterNode::rcam_callback};
+    monotonic::MonotonicMember<FilterNode, orca_msgs::msg::Barometer::SharedPtr, &FilterNode::baro_callback> baro_cb_{this};
+    monotonic::MonotonicMember<FilterNode, orca_msgs::msg::Control::SharedPtr, &FilterNode::control_callback> control_cb_{this};
+    monotonic::MonotonicMember<FilterNode, geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr,
+      &FilterNode::fcam_callback> fcam_cb_{this};
+    monotonic::MonotonicMember<FilterNode, geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr,
+      &FilterNode::lcam_callback> lcam_cb_{this};
+    monotonic::MonotonicMember<FilterNode, geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr,
+      &FilterNode::rcam_callback> rcam_cb_{this};
 
     // Process a camera pose
     void process_pose(const geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr &sensor_f_map,
@@ -116,7 +130,10 @@ namespace orca_filter
   public:
     explicit FilterNode();
 
-    ~FilterNode() override = default;
+    ~FilterNode() override;
+
+    int executor_threads() const
+    { return cxt_.executor_threads_; }
   };
 
 } // namespace orca_filter
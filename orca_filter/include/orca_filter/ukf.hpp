@@ -0,0 +1,252 @@
+#ifndef ORCA_FILTER_UKF_HPP
+#define ORCA_FILTER_UKF_HPP
+
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include "eigen3/Eigen/Dense"
+
+namespace orca_filter
+{
+
+  //=============================================================================
+  // Constants
+  //=============================================================================
+
+  constexpr int CONTROL_DIM = 4;              // [ax, ay, az, ayaw]T
+  constexpr int MAX_MEASUREMENT_DIM = 6;      // 6dof pose
+
+  using ControlVector = Eigen::Matrix<double, CONTROL_DIM, 1>;
+
+  //=============================================================================
+  // Default residual and mean functions
+  //=============================================================================
+
+  template<typename Vector>
+  Vector residual(const Eigen::Ref<const Vector> &x, const Vector &mean)
+  {
+    return x - mean;
+  }
+
+  template<typename Vector, typename SigmaPoints, typename Weights>
+  Vector unscented_mean(const SigmaPoints &sigma_points, const Weights &Wm)
+  {
+    return sigma_points * Wm.transpose();
+  }
+
+  //=============================================================================
+  // Unscented Kalman filter with Merwe scaled sigma points
+  //
+  // Same algorithm and interface as the ukf package, templated on the state dimension.
+  // With a fixed STATE_DIM the state, covariance and sigma points have compile-time
+  // sizes, and measurements use Eigen's fixed max-size matrices (up to
+  // MAX_MEASUREMENT_DIM), so predict() and update() don't allocate.
+  //
+  // STATE_DIM = Eigen::Dynamic allocates everything on the heap, like the ukf package.
+  //=============================================================================
+
+  template<int STATE_DIM>
+  class UnscentedKalmanFilter
+  {
+  public:
+
+    static constexpr bool DYNAMIC = STATE_DIM == Eigen::Dynamic;
+    static constexpr int NUM_POINTS = DYNAMIC ? Eigen::Dynamic : 2 * STATE_DIM + 1;
+    static constexpr int MEASUREMENT_DIM = DYNAMIC ? Eigen::Dynamic : MAX_MEASUREMENT_DIM;
+
+    using StateVector = Eigen::Matrix<double, STATE_DIM, 1>;
+    using StateMatrix = Eigen::Matrix<double, STATE_DIM, STATE_DIM>;
+    using StateSigmaPoints = Eigen::Matrix<double, STATE_DIM, NUM_POINTS>;
+    using Weights = Eigen::Matrix<double, 1, NUM_POINTS>;
+
+    using MeasurementVector = Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, MEASUREMENT_DIM, 1>;
+    using MeasurementMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor,
+      MEASUREMENT_DIM, MEASUREMENT_DIM>;
+    using MeasurementSigmaPoints = Eigen::Matrix<double, Eigen::Dynamic, NUM_POINTS, Eigen::ColMajor,
+      MEASUREMENT_DIM, NUM_POINTS>;
+    using CrossMatrix = Eigen::Matrix<double, STATE_DIM, Eigen::Dynamic, Eigen::ColMajor,
+      STATE_DIM, MEASUREMENT_DIM>;
+
+    using TransitionFn = std::function<void(double dt, const ControlVector &u, Eigen::Ref<StateVector> x)>;
+    using MeasurementFn = std::function<void(const Eigen::Ref<const StateVector> &x,
+                                             Eigen::Ref<MeasurementVector> z)>;
+    using StateResidualFn = std::function<StateVector(const Eigen::Ref<const StateVector> &x,
+                                                      const StateVector &mean)>;
+    using StateMeanFn = std::function<StateVector(const StateSigmaPoints &sigma_points, const Weights &Wm)>;
+    using MeasurementResidualFn = std::function<MeasurementVector(const Eigen::Ref<const MeasurementVector> &z,
+                                                                  const MeasurementVector &mean)>;
+    using MeasurementMeanFn = std::function<MeasurementVector(const MeasurementSigmaPoints &sigma_points,
+                                                              const Weights &Wm)>;
+
+  private:
+
+    int state_dim_;
+    double lambda_;
+    Weights Wm_;
+    Weights Wc_;
+
+    StateVector x_;
+    StateMatrix P_;
+    StateMatrix Q_;
+
+    // Sigma points after predict(), used by update()
+    StateSigmaPoints sigmas_p_;
+
+    // Sigma points in measurement space, used by update()
+    MeasurementSigmaPoints sigmas_z_;
+
+    TransitionFn f_fn_;
+    MeasurementFn h_fn_;
+    StateResidualFn r_x_fn_{residual<StateVector>};
+    MeasurementResidualFn r_z_fn_{residual<MeasurementVector>};
+    StateMeanFn mean_x_fn_{unscented_mean<StateVector, StateSigmaPoints, Weights>};
+    MeasurementMeanFn mean_z_fn_{unscented_mean<MeasurementVector, MeasurementSigmaPoints, Weights>};
+
+    double outlier_distance_{std::numeric_limits<double>::max()};
+
+    int num_points() const
+    { return 2 * state_dim_ + 1; }
+
+    // Generate sigma points from x_ and P_
+    void sigma_points()
+    {
+      StateMatrix L = ((lambda_ + state_dim_) * P_).llt().matrixL();
+
+      sigmas_p_.col(0) = x_;
+      for (int i = 0; i < state_dim_; ++i) {
+        sigmas_p_.col(i + 1) = x_ + L.col(i);
+        sigmas_p_.col(i + 1 + state_dim_) = x_ - L.col(i);
+      }
+    }
+
+  public:
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    UnscentedKalmanFilter(int state_dim, double alpha, double beta, double kappa) :
+      state_dim_{state_dim},
+      lambda_{alpha * alpha * (state_dim + kappa) - state_dim},
+      Wm_{Weights::Constant(1, 2 * state_dim + 1, 0.5 / (state_dim + lambda_))},
+      Wc_{Wm_},
+      x_{StateVector::Zero(state_dim)},
+      P_{StateMatrix::Identity(state_dim, state_dim)},
+      Q_{StateMatrix::Zero(state_dim, state_dim)},
+      sigmas_p_{StateSigmaPoints::Zero(state_dim, 2 * state_dim + 1)}
+    {
+      assert(DYNAMIC || state_dim == STATE_DIM);
+
+      Wm_(0) = lambda_ / (state_dim + lambda_);
+      Wc_(0) = Wm_(0) + (1 - alpha * alpha + beta);
+    }
+
+    const StateVector &x() const
+    { return x_; }
+
+    const StateMatrix &P() const
+    { return P_; }
+
+    void set_x(const StateVector &x)
+    { x_ = x; }
+
+    void set_P(const StateMatrix &P)
+    { P_ = P; }
+
+    void set_Q(const StateMatrix &Q)
+    { Q_ = Q; }
+
+    void set_f_fn(const TransitionFn &f_fn)
+    { f_fn_ = f_fn; }
+
+    void set_h_fn(const MeasurementFn &h_fn)
+    { h_fn_ = h_fn; }
+
+    void set_r_x_fn(const StateResidualFn &r_x_fn)
+    { r_x_fn_ = r_x_fn; }
+
+    void set_r_z_fn(const MeasurementResidualFn &r_z_fn)
+    { r_z_fn_ = r_z_fn; }
+
+    void set_mean_x_fn(const StateMeanFn &mean_x_fn)
+    { mean_x_fn_ = mean_x_fn; }
+
+    void set_mean_z_fn(const MeasurementMeanFn &mean_z_fn)
+    { mean_z_fn_ = mean_z_fn; }
+
+    // Reject measurements that are more than this Mahalanobis distance from the estimate
+    void set_outlier_distance(double outlier_distance)
+    { outlier_distance_ = outlier_distance; }
+
+    bool valid() const
+    { return x_.allFinite() && P_.allFinite(); }
+
+    void predict(double dt, const ControlVector &u)
+    {
+      sigma_points();
+
+      // Run each sigma point through the transition function
+      for (int i = 0; i < num_points(); ++i) {
+        f_fn_(dt, u, sigmas_p_.col(i));
+      }
+
+      // Mean and covariance of the sigma points
+      x_ = mean_x_fn_(sigmas_p_, Wm_);
+      P_ = Q_;
+      for (int i = 0; i < num_points(); ++i) {
+        StateVector y = r_x_fn_(sigmas_p_.col(i), x_);
+        P_.noalias() += Wc_(i) * y * y.transpose();
+      }
+    }
+
+    // Return true if the measurement was used, false if it was rejected as an outlier
+    bool update(const MeasurementVector &z, const MeasurementMatrix &R)
+    {
+      return update(z, R, h_fn_, r_z_fn_, mean_z_fn_);
+    }
+
+    // Update with the measurement functions passed in, instead of copying them with set_h_fn(), etc.
+    bool update(const MeasurementVector &z, const MeasurementMatrix &R, const MeasurementFn &h_fn,
+                const MeasurementResidualFn &r_z_fn, const MeasurementMeanFn &mean_z_fn)
+    {
+      auto z_dim = z.rows();
+
+      // Transform the sigma points into measurement space
+      sigmas_z_.resize(z_dim, num_points());
+      for (int i = 0; i < num_points(); ++i) {
+        h_fn(sigmas_p_.col(i), sigmas_z_.col(i));
+      }
+
+      // Mean and covariance of the measurement sigma points, and the cross covariance
+      MeasurementVector z_mean = mean_z_fn(sigmas_z_, Wm_);
+      MeasurementMatrix P_z = R;
+      CrossMatrix P_xz = CrossMatrix::Zero(state_dim_, z_dim);
+      for (int i = 0; i < num_points(); ++i) {
+        StateVector y_x = r_x_fn_(sigmas_p_.col(i), x_);
+        MeasurementVector y_z = r_z_fn(sigmas_z_.col(i), z_mean);
+        P_z.noalias() += Wc_(i) * y_z * y_z.transpose();
+        P_xz.noalias() += Wc_(i) * y_x * y_z.transpose();
+      }
+
+      MeasurementMatrix P_z_inverse = P_z.inverse();
+      MeasurementVector y_z = r_z_fn(z, z_mean);
+
+      // Reject outliers
+      if (outlier_distance_ < std::numeric_limits<double>::max() &&
+          std::sqrt(y_z.dot(P_z_inverse * y_z)) > outlier_distance_) {
+        return false;
+      }
+
+      // Kalman gain
+      CrossMatrix K = P_xz * P_z_inverse;
+
+      x_.noalias() += K * y_z;
+      P_.noalias() -= K * P_z * K.transpose();
+
+      return true;
+    }
+  };
+
+} // namespace orca_filter
+
+#endif // ORCA_FILTER_UKF_HPP
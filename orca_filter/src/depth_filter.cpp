@@ -14,17 +14,15 @@ namespace orca_filter
   // DepthFilter
   //==================================================================
 
-  constexpr int DEPTH_STATE_DIM = 3;      // [z, vz, az]T
-
   // Depth state macros
 #define dx_z x(0)
 #define dx_vz x(1)
 #define dx_az x(2)
 
   // Init x from pose
-  Eigen::VectorXd pose_to_dx(const geometry_msgs::msg::Pose &pose)
+  DepthFilter::StateVector pose_to_dx(const geometry_msgs::msg::Pose &pose)
   {
-    Eigen::VectorXd x = Eigen::VectorXd::Zero(DEPTH_STATE_DIM);
+    DepthFilter::StateVector x = DepthFilter::StateVector::Zero();
 
     dx_z = pose.position.z;
 
@@ -32,7 +30,7 @@ namespace orca_filter
   }
 
   // Extract pose from DepthFilter state
-  void pose_from_dx(const Eigen::VectorXd &x, geometry_msgs::msg::Pose &out)
+  void pose_from_dx(const DepthFilter::StateVector &x, geometry_msgs::msg::Pose &out)
   {
     out.position.x = 0;
     out.position.y = 0;
@@ -45,16 +43,16 @@ namespace orca_filter
   }
 
   // Extract twist from PoseFilter state
-  void twist_from_dx(const Eigen::VectorXd &x, geometry_msgs::msg::Twist &out)
+  void twist_from_dx(const DepthFilter::StateVector &x, geometry_msgs::msg::Twist &out)
   {
     out.linear.z = dx_vz;
   }
 
   // Extract pose or twist covariance from DepthFilter covariance
-  void flatten_1x1_covar(const Eigen::MatrixXd &P, std::array<double, 36> &pose_covar, bool pose)
+  void flatten_1x1_covar(const DepthFilter::StateMatrix &P, std::array<double, 36> &pose_covar, bool pose)
   {
     // Start with extremely high covariance values
-    Eigen::MatrixXd m = Eigen::MatrixXd::Identity(6, 6) * 1e6;
+    Eigen::Matrix<double, 6, 6> m = Eigen::Matrix<double, 6, 6>::Identity() * 1e6;
 
     // Copy the z value
     int offset = pose ? 0 : 1;
@@ -65,13 +63,13 @@ namespace orca_filter
   }
 
   DepthFilter::DepthFilter(const rclcpp::Logger &logger, const FilterContext &cxt) :
-    FilterBase{logger, cxt, DEPTH_STATE_DIM}
+    Filter{logger, cxt}
   {
-    filter_.set_Q(Eigen::MatrixXd::Identity(DEPTH_STATE_DIM, DEPTH_STATE_DIM) * 0.01);
+    filter_.set_Q(StateMatrix::Identity() * 0.01);
 
     // State transition function
     filter_.set_f_fn(
-      [&cxt](const double dt, const Eigen::VectorXd &u, Eigen::Ref<Eigen::VectorXd> x)
+      [&cxt](const double dt, const ControlVector &u, Eigen::Ref<StateVector> x)
       {
         if (cxt.predict_accel_) {
           // Assume 0 acceleration
@@ -113,7 +111,7 @@ namespace orca_filter
 
   void DepthFilter::reset(const geometry_msgs::msg::Pose &pose)
   {
-    FilterBase::reset(pose_to_dx(pose));
+    Filter::reset(pose_to_dx(pose));
   }
 
   void DepthFilter::odom_from_filter(nav_msgs::msg::Odometry &filtered_odom)
@@ -124,17 +122,17 @@ namespace orca_filter
     flatten_1x1_covar(filter_.P(), filtered_odom.twist.covariance, false);
   }
 
-  Measurement DepthFilter::to_measurement(const orca_msgs::msg::Depth &depth) const
+  Measurement<DEPTH_STATE_DIM> DepthFilter::to_measurement(const orca_msgs::msg::Depth &depth) const
   {
-    Measurement m;
-    m.init_z(depth, [](const Eigen::Ref<const Eigen::VectorXd> &x, Eigen::Ref<Eigen::VectorXd> z)
+    Measurement<DEPTH_STATE_DIM> m;
+    m.init_z(depth, [](const Eigen::Ref<const StateVector> &x, Eigen::Ref<Ukf::MeasurementVector> z)
     {
       z(0) = dx_z;
     });
     return m;
   }
 
-  Measurement DepthFilter::to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const
+  Measurement<DEPTH_STATE_DIM> DepthFilter::to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const
   {
     // Not supported
     assert(false);
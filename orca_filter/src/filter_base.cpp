@@ -14,8 +14,6 @@ namespace orca_filter
   // Constants
   //=============================================================================
 
-  constexpr int CONTROL_DIM = 4;          // [ax, ay, az, ayaw]T
-
   constexpr double MIN_DT = 0.001;
   constexpr double DEFAULT_DT = 0.1;
   constexpr double MAX_DT = 1.0;
@@ -25,44 +23,37 @@ namespace orca_filter
   //==================================================================
 
   // Create control matrix u
-  void to_u(const Acceleration &in, Eigen::VectorXd &out)
+  void to_u(const Acceleration &in, ControlVector &out)
   {
-    out = Eigen::VectorXd(CONTROL_DIM);
     out << in.x, in.y, in.z, in.yaw;
   }
 
-  // Flatten a 6x6 covariance matrix
-  void flatten_6x6_covar(const Eigen::MatrixXd &m, std::array<double, 36> &covar, int offset)
-  {
-    for (int i = 0; i < 6; i++) {
-      for (int j = 0; j < 6; j++) {
-        covar[i * 6 + j] = m(i + offset, j + offset);
-      }
-    }
-  }
-
   //==================================================================
   // Measurement
   //==================================================================
 
-  void Measurement::init_z(const orca_msgs::msg::Depth &depth, ukf::MeasurementFn h_fn)
+  template<int STATE_DIM>
+  void Measurement<STATE_DIM>::init_z(const orca_msgs::msg::Depth &depth, typename Ukf::MeasurementFn h_fn)
   {
     stamp_ = depth.header.stamp;
 
-    z_ = Eigen::VectorXd(1);
+    z_.resize(1);
     z_ << depth.z;
 
-    R_ = Eigen::MatrixXd(1, 1);
+    R_.resize(1, 1);
     R_ << depth.z_variance;
 
     h_fn_ = std::move(h_fn);
 
     // Use the standard residual and mean functions for depth measurements
-    r_z_fn_ = ukf::residual;
-    mean_z_fn_ = ukf::unscented_mean;
+    r_z_fn_ = residual<typename Ukf::MeasurementVector>;
+    mean_z_fn_ = unscented_mean<typename Ukf::MeasurementVector, typename Ukf::MeasurementSigmaPoints,
+      typename Ukf::Weights>;
   }
 
-  void Measurement::init_4dof(const geometry_msgs::msg::PoseWithCovarianceStamped &pose, ukf::MeasurementFn h_fn)
+  template<int STATE_DIM>
+  void Measurement<STATE_DIM>::init_4dof(const geometry_msgs::msg::PoseWithCovarianceStamped &pose,
+                                         typename Ukf::MeasurementFn h_fn)
   {
     stamp_ = pose.header.stamp;
 
@@ -72,10 +63,10 @@ namespace orca_filter
     tf2Scalar roll, pitch, yaw;
     t_map_base.getBasis().getRPY(roll, pitch, yaw);
 
-    z_ = Eigen::VectorXd(4);
+    z_.resize(4);
     z_ << t_map_base.getOrigin().x(), t_map_base.getOrigin().y(), t_map_base.getOrigin().z(), yaw;
 
-    R_ = Eigen::MatrixXd(4, 4);
+    R_.resize(4, 4);
     for (int i = 0; i < 4; i++) {
       for (int j = 0; j < 4; j++) {
         // Copy rows {0, 1, 2, 5} and cols {0, 1, 2, 5}
@@ -86,11 +77,14 @@ namespace orca_filter
     h_fn_ = std::move(h_fn);
 
     // Use a custom residual and mean functions for pose measurements
-    r_z_fn_ = four_state_residual;
-    mean_z_fn_ = four_state_mean;
+    r_z_fn_ = four_state_residual<typename Ukf::MeasurementVector>;
+    mean_z_fn_ = four_state_mean<typename Ukf::MeasurementVector, typename Ukf::MeasurementSigmaPoints,
+      typename Ukf::Weights>;
   }
 
-  void Measurement::init_6dof(const geometry_msgs::msg::PoseWithCovarianceStamped &pose, ukf::MeasurementFn h_fn)
+  template<int STATE_DIM>
+  void Measurement<STATE_DIM>::init_6dof(const geometry_msgs::msg::PoseWithCovarianceStamped &pose,
+                                         typename Ukf::MeasurementFn h_fn)
   {
     stamp_ = pose.header.stamp;
 
@@ -100,10 +94,10 @@ namespace orca_filter
     tf2Scalar roll, pitch, yaw;
     t_map_base.getBasis().getRPY(roll, pitch, yaw);
 
-    z_ = Eigen::VectorXd(6);
+    z_.resize(6);
     z_ << t_map_base.getOrigin().x(), t_map_base.getOrigin().y(), t_map_base.getOrigin().z(), roll, pitch, yaw;
 
-    R_ = Eigen::MatrixXd(6, 6);
+    R_.resize(6, 6);
     for (int i = 0; i < 6; i++) {
       for (int j = 0; j < 6; j++) {
         R_(i, j) = pose.pose.covariance[i * 6 + j];
@@ -113,32 +107,35 @@ namespace orca_filter
     h_fn_ = std::move(h_fn);
 
     // Use a custom residual and mean functions for pose measurements
-    r_z_fn_ = six_state_residual;
-    mean_z_fn_ = six_state_mean;
+    r_z_fn_ = six_state_residual<typename Ukf::MeasurementVector>;
+    mean_z_fn_ = six_state_mean<typename Ukf::MeasurementVector, typename Ukf::MeasurementSigmaPoints,
+      typename Ukf::Weights>;
   }
 
   //==================================================================
-  // FilterBase
+  // Filter
   //==================================================================
 
-  FilterBase::FilterBase(const rclcpp::Logger &logger, const FilterContext &cxt, int state_dim) :
+  template<int STATE_DIM>
+  Filter<STATE_DIM>::Filter(const rclcpp::Logger &logger, const FilterContext &cxt) :
     logger_{logger},
     cxt_{cxt},
-    state_dim_{state_dim},
-    filter_{state_dim, 0.001, 2.0, 0}
+    filter_{STATE_DIM, 0.001, 2.0, 0}
   {
     reset();
   }
 
-  void FilterBase::reset()
+  template<int STATE_DIM>
+  void Filter<STATE_DIM>::reset()
   {
-    reset(Eigen::VectorXd::Zero(state_dim_));
+    reset(StateVector::Zero());
   }
 
-  void FilterBase::reset(const Eigen::VectorXd &x)
+  template<int STATE_DIM>
+  void Filter<STATE_DIM>::reset(const StateVector &x)
   {
     // Clear all pending measurements
-    measurement_q_ = std::priority_queue<Measurement, std::vector<Measurement>, Measurement>();
+    measurement_q_.clear();
 
     // Clear history
     state_history_.clear();
@@ -149,10 +146,11 @@ namespace orca_filter
 
     // Start with a default state and a large covariance matrix
     filter_.set_x(x);
-    filter_.set_P(Eigen::MatrixXd::Identity(state_dim_, state_dim_));
+    filter_.set_P(StateMatrix::Identity());
   }
 
-  void FilterBase::predict(const rclcpp::Time &stamp, const Acceleration &u_bar)
+  template<int STATE_DIM>
+  void Filter<STATE_DIM>::predict(const rclcpp::Time &stamp, const Acceleration &u_bar)
   {
     // Filter time starts at 0, test for this
     if (!valid_stamp(filter_time_)) {
@@ -176,7 +174,7 @@ namespace orca_filter
         // Run the prediction
         RCLCPP_DEBUG(logger_, "predict, stamp %s, filter %s",
                      to_str(stamp).c_str(), to_str(filter_time_).c_str());
-        Eigen::VectorXd u;
+        ControlVector u;
         to_u(u_bar, u);
         filter_.predict(dt, u);
       }
@@ -186,7 +184,9 @@ namespace orca_filter
     filter_time_ = stamp;
   }
 
-  bool FilterBase::process(const rclcpp::Time &stamp, const Acceleration &u_bar, nav_msgs::msg::Odometry &filtered_odom)
+  template<int STATE_DIM>
+  bool Filter<STATE_DIM>::process(const rclcpp::Time &stamp, const Acceleration &u_bar,
+                                  nav_msgs::msg::Odometry &filtered_odom)
   {
     // Trim state_history_
     while (!state_history_.empty() && state_history_.front().stamp_ < stamp - HISTORY_LENGTH) {
@@ -209,28 +209,26 @@ namespace orca_filter
 
     // Process all measurements
     while (!measurement_q_.empty()) {
-      RCLCPP_DEBUG(logger_, "processing measurement %s", to_str(measurement_q_.top().stamp_).c_str());
+      // Move the oldest measurement to the back, and work on it in place
+      std::pop_heap(measurement_q_.begin(), measurement_q_.end(), Measurement<STATE_DIM>::newer);
+      Measurement<STATE_DIM> &m = measurement_q_.back();
 
-      Measurement m = measurement_q_.top();
-      measurement_q_.pop();
+      RCLCPP_DEBUG(logger_, "processing measurement %s", to_str(m.stamp_).c_str());
 
       predict(m.stamp_, u_bar);
 
-      filter_.set_h_fn(m.h_fn_);
-      filter_.set_r_z_fn(m.r_z_fn_);
-      filter_.set_mean_z_fn(m.mean_z_fn_);
-
-      if (filter_.update(m.z_, m.R_)) {
+      if (filter_.update(m.z_, m.R_, m.h_fn_, m.r_z_fn_, m.mean_z_fn_)) {
         inliers++;
       } else {
         outliers++;
       }
 
-      // Save measurement in history
-      measurement_history_.push_back(m);
-
       // Save state in history
       state_history_.emplace_back(m.stamp_, filter_.x(), filter_.P());
+
+      // Save measurement in history
+      measurement_history_.push_back(std::move(m));
+      measurement_q_.pop_back();
     }
 
     if (outliers) {
@@ -249,7 +247,8 @@ namespace orca_filter
   }
 
   // Rewind to a previous state, return true if successful, false if there was no change
-  bool FilterBase::rewind(const rclcpp::Time &stamp)
+  template<int STATE_DIM>
+  bool Filter<STATE_DIM>::rewind(const rclcpp::Time &stamp)
   {
     if (state_history_.empty() || stamp < state_history_.front().stamp_) {
       RCLCPP_WARN(logger_, "can't rewind to %s, dropping message", to_str(stamp).c_str());
@@ -271,11 +270,23 @@ namespace orca_filter
     // Pop newer measurements and put them back into the priority queue
     while (!measurement_history_.empty() && measurement_history_.back().stamp_ > stamp) {
       RCLCPP_DEBUG(logger_, "rewind: re-queue measurement %s", to_str(stamp).c_str());
-      measurement_q_.push(measurement_history_.back());
+      measurement_q_.push_back(std::move(measurement_history_.back()));
+      std::push_heap(measurement_q_.begin(), measurement_q_.end(), Measurement<STATE_DIM>::newer);
       measurement_history_.pop_back();
     }
 
     return true;
   }
 
+  //==================================================================
+  // Instantiate the filters
+  //==================================================================
+
+  template struct Measurement<DEPTH_STATE_DIM>;
+  template struct Measurement<FOUR_STATE_DIM>;
+  template struct Measurement<POSE_STATE_DIM>;
+  template class Filter<DEPTH_STATE_DIM>;
+  template class Filter<FOUR_STATE_DIM>;
+  template class Filter<POSE_STATE_DIM>;
+
 } // namespace orca_filter
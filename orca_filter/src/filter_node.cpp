@@ -38,31 +38,50 @@ namespace orca_filter
     rcam_pub_ = create_publisher<geometry_msgs::msg::PoseWithCovarianceStamped>("rcam_f_base", 1);
     tf_pub_ = create_publisher<tf2_msgs::msg::TFMessage>("/tf", 1);
 
+    // One callback group per sensor
+    auto group_options = [this](rclcpp::callback_group::CallbackGroup::SharedPtr &group)
+    {
+      group = create_callback_group(rclcpp::callback_group::CallbackGroupType::MutuallyExclusive);
+      rclcpp::SubscriptionOptions options;
+      options.callback_group = group;
+      return options;
+    };
+
     // Monotonic subscriptions
     baro_sub_ = create_subscription<orca_msgs::msg::Barometer>(
       "barometer", 1, [this](const orca_msgs::msg::Barometer::SharedPtr msg) -> void
-      { this->baro_cb_.call(msg); });
+      { this->baro_cb_.call(msg); }, group_options(baro_group_));
     fcam_sub_ = create_subscription<geometry_msgs::msg::PoseWithCovarianceStamped>(
       "fcam_f_map", 1, [this](const geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr msg) -> void
-      { this->fcam_cb_.call(msg); });
+      { this->fcam_cb_.call(msg); }, group_options(fcam_group_));
     lcam_sub_ = create_subscription<geometry_msgs::msg::PoseWithCovarianceStamped>(
       "lcam_f_map", 1, [this](const geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr msg) -> void
-      { this->lcam_cb_.call(msg); });
+      { this->lcam_cb_.call(msg); }, group_options(lcam_group_));
     rcam_sub_ = create_subscription<geometry_msgs::msg::PoseWithCovarianceStamped>(
       "rcam_f_map", 1, [this](const geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr msg) -> void
-      { this->rcam_cb_.call(msg); });
+      { this->rcam_cb_.call(msg); }, group_options(rcam_group_));
 
     RCLCPP_INFO(get_logger(), "filter_node ready");
   }
 
+  FilterNode::~FilterNode()
+  {
+    monotonic::log_stats(get_logger(), "baro", baro_cb_.stats());
+    monotonic::log_stats(get_logger(), "fcam", fcam_cb_.stats());
+    monotonic::log_stats(get_logger(), "lcam", lcam_cb_.stats());
+    monotonic::log_stats(get_logger(), "rcam", rcam_cb_.stats());
+  }
+
   void FilterNode::validate_parameters()
   {
 #undef CXT_MACRO_MEMBER
 #define CXT_MACRO_MEMBER(n, t, d) CXT_MACRO_LOG_PARAMETER(RCLCPP_DEBUG, get_logger(), cxt_, n, t, d)
     FILTER_NODE_ALL_PARAMS
 
-    // Update model from new parameters
-    cxt_.model_.fluid_density_ = cxt_.param_fluid_density_;
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    // Update model from new parameters, the filters read the model
+    cxt_.model_.set_fluid_density(cxt_.param_fluid_density_);
 
     create_filter();
 
@@ -71,17 +90,18 @@ namespace orca_filter
 
   void FilterNode::create_filter()
   {
+    // The filters hold fixed-size Eigen members, use an aligned allocator
     if (receiving_poses_) {
       if (cxt_.four_dof_) {
         RCLCPP_INFO(get_logger(), "4dof pose filter");
-        filter_ = std::make_shared<FourFilter>(get_logger(), cxt_);
+        filter_ = std::allocate_shared<FourFilter>(Eigen::aligned_allocator<FourFilter>(), get_logger(), cxt_);
       } else {
         RCLCPP_INFO(get_logger(), "6dof pose filter");
-        filter_ = std::make_shared<PoseFilter>(get_logger(), cxt_);
+        filter_ = std::allocate_shared<PoseFilter>(Eigen::aligned_allocator<PoseFilter>(), get_logger(), cxt_);
       }
     } else {
       RCLCPP_INFO(get_logger(), "depth filter");
-      filter_ = std::make_shared<DepthFilter>(get_logger(), cxt_);
+      filter_ = std::allocate_shared<DepthFilter>(Eigen::aligned_allocator<DepthFilter>(), get_logger(), cxt_);
     }
   }
 
@@ -141,30 +161,34 @@ namespace orca_filter
     static const double z_top_to_baro_link = -0.05;
     static const double z_baro_link_to_base_link = -0.085;
 
-    if (!z_valid_ && cxt_.baro_init_ == 0) {
-      z_offset_ = -z + z_top_to_baro_link + z_baro_link_to_base_link;
-      z_valid_ = true;
-      RCLCPP_INFO(get_logger(), "barometer init mode 0 (in air): adjustment %g", z_offset_);
-    } else if (!z_valid_ && cxt_.baro_init_ == 1) {
-      z_offset_ = -z + z_baro_link_to_base_link;
-      z_valid_ = true;
-      RCLCPP_INFO(get_logger(), "barometer init mode 1 (in water): adjustment %g", z_offset_);
-    }
+    orca_msgs::msg::Depth depth_msg;
+    nav_msgs::msg::Odometry filtered_odom;
+    bool publish_odometry = false;
+
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+
+      if (!z_valid_ && cxt_.baro_init_ == 0) {
+        z_offset_ = -z + z_top_to_baro_link + z_baro_link_to_base_link;
+        z_valid_ = true;
+        RCLCPP_INFO(get_logger(), "barometer init mode 0 (in air): adjustment %g", z_offset_);
+      } else if (!z_valid_ && cxt_.baro_init_ == 1) {
+        z_offset_ = -z + z_baro_link_to_base_link;
+        z_valid_ = true;
+        RCLCPP_INFO(get_logger(), "barometer init mode 1 (in water): adjustment %g", z_offset_);
+      }
+
+      if (!z_valid_) {
+        return;
+      }
 
-    if (z_valid_) {
       // Adjust reading
       z_ = z + z_offset_;
 
-      orca_msgs::msg::Depth depth_msg;
       depth_msg.header = msg->header;
       depth_msg.z = z_;
       depth_msg.z_variance = Model::DEPTH_STDDEV * Model::DEPTH_STDDEV * 10; // Boost measurement uncertainty
 
-      // Publish depth, useful for diagnostics
-      if (depth_pub_->get_subscription_count() > 0) {
-        depth_pub_->publish(depth_msg);
-      }
-
       if (cxt_.filter_baro_) {
 
         // Still receiving poses?
@@ -177,7 +201,6 @@ namespace orca_filter
           }
         }
 
-        nav_msgs::msg::Odometry filtered_odom;
         filtered_odom.header.frame_id = cxt_.frame_id_map_;
         filtered_odom.child_frame_id = cxt_.frame_id_base_link_;
 
@@ -185,14 +208,25 @@ namespace orca_filter
           // Save estimated yaw, used to rotate control messages
           estimated_yaw_ = get_yaw(filtered_odom.pose.pose.orientation);
 
-          publish_odom(filtered_odom);
+          publish_odometry = true;
         }
       }
     }
+
+    // Publish depth, useful for diagnostics
+    if (depth_pub_->get_subscription_count() > 0) {
+      depth_pub_->publish(depth_msg);
+    }
+
+    if (publish_odometry) {
+      publish_odom(filtered_odom);
+    }
   }
 
   void FilterNode::control_callback(const orca_msgs::msg::Control::SharedPtr msg, bool first)
   {
+    std::lock_guard<std::mutex> lock{mutex_};
+
     Efforts e;
     e.from_msg(msg->efforts);
     e.to_acceleration(estimated_yaw_, u_bar_);
@@ -223,21 +257,27 @@ namespace orca_filter
                                 const tf2::Transform &t_sensor_base, const std::string &frame_id,
                                 const rclcpp::Publisher<geometry_msgs::msg::PoseWithCovarianceStamped>::SharedPtr &pose_pub)
   {
-    // If we're using a depth filter, switch to a pose filter
-    if (!receiving_poses_) {
-      RCLCPP_INFO(get_logger(), "found marker(s)");
-      receiving_poses_ = true;
-      create_filter();
-    }
-
-    last_pose_received_ = sensor_f_map->header.stamp;
-
     // Convert pose to transform
     tf2::Transform t_map_sensor;
     tf2::fromMsg(sensor_f_map->pose.pose, t_map_sensor);
 
-    // Multiply transforms to get t_map_base
-    tf2::Transform t_map_base = t_map_sensor * t_sensor_base;
+    tf2::Transform t_map_base;
+
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+
+      // If we're using a depth filter, switch to a pose filter
+      if (!receiving_poses_) {
+        RCLCPP_INFO(get_logger(), "found marker(s)");
+        receiving_poses_ = true;
+        create_filter();
+      }
+
+      last_pose_received_ = sensor_f_map->header.stamp;
+
+      // Multiply transforms to get t_map_base
+      t_map_base = t_map_sensor * t_sensor_base;
+    }
 
     // Convert transform back to pose
     geometry_msgs::msg::PoseWithCovarianceStamped base_f_map;
@@ -263,25 +303,34 @@ namespace orca_filter
       tf_pub_->publish(tf_message);
     }
 
-    // If we're receiving poses but not publishing odometry then reset the filter
-    rclcpp::Time stamp{sensor_f_map->header.stamp};
-    if (valid_stamp(last_pose_inlier_) && stamp - last_pose_inlier_ > OUTLIER_TIMEOUT) {
-      RCLCPP_WARN(get_logger(), "reset filter");
-      filter_->reset(base_f_map.pose.pose);
-      last_pose_inlier_ = stamp;
-    }
-
     nav_msgs::msg::Odometry filtered_odom;
     filtered_odom.header.frame_id = cxt_.frame_id_map_;
     filtered_odom.child_frame_id = cxt_.frame_id_base_link_;
+    bool publish_odometry = false;
 
-    if (filter_->process_message(base_f_map, u_bar_, filtered_odom)) {
-      // Save estimated yaw, used to rotate control messages
-      estimated_yaw_ = get_yaw(filtered_odom.pose.pose.orientation);
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
 
-      publish_odom(filtered_odom);
+      // If we're receiving poses but not publishing odometry then reset the filter
+      rclcpp::Time stamp{sensor_f_map->header.stamp};
+      if (valid_stamp(last_pose_inlier_) && stamp - last_pose_inlier_ > OUTLIER_TIMEOUT) {
+        RCLCPP_WARN(get_logger(), "reset filter");
+        filter_->reset(base_f_map.pose.pose);
+        last_pose_inlier_ = stamp;
+      }
+
+      if (filter_->process_message(base_f_map, u_bar_, filtered_odom)) {
+        // Save estimated yaw, used to rotate control messages
+        estimated_yaw_ = get_yaw(filtered_odom.pose.pose.orientation);
 
-      last_pose_inlier_ = stamp;
+        last_pose_inlier_ = stamp;
+
+        publish_odometry = true;
+      }
+    }
+
+    if (publish_odometry) {
+      publish_odom(filtered_odom);
     }
   }
 
@@ -332,7 +381,15 @@ int main(int argc, char **argv)
   auto result = rcutils_logging_set_logger_level(node->get_logger().get_name(), RCUTILS_LOG_SEVERITY_INFO);
 
   // Spin node
-  rclcpp::spin(node);
+  if (node->executor_threads() == 1) {
+    rclcpp::spin(node);
+  } else {
+    // 0 threads: one per cpu
+    rclcpp::executors::MultiThreadedExecutor executor{rclcpp::executor::create_default_executor_arguments(),
+                                                      static_cast<size_t>(node->executor_threads())};
+    executor.add_node(node);
+    executor.spin();
+  }
 
   // Shut down ROS
   rclcpp::shutdown();
@@ -0,0 +1,463 @@
+// Count Eigen heap allocations: with EIGEN_RUNTIME_NO_MALLOC Eigen checks every malloc with eigen_assert
+static long eigen_allocations = 0;
+#define EIGEN_RUNTIME_NO_MALLOC
+#define eigen_assert(x) do { if (!(x)) { ++eigen_allocations; } } while (false)
+
+#include "orca_filter/filter_base.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+
+#include "tf2_geometry_msgs/tf2_geometry_msgs.h"
+
+#include "filter_test_reference.hpp"
+
+using namespace orca_filter;
+
+// Hook the global allocator, count all allocations
+static long allocations = 0;
+
+void *operator new(std::size_t size)
+{
+  ++allocations;
+  if (void *p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{ std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept
+{ std::free(p); }
+
+//=====================================================================================
+// A UKF set up like the filters: n positions, [pos, vel, acc]T, and an n-dof pose measurement
+// STATE_DIM = Eigen::Dynamic gives the heap-allocated UKF that the filters used to run on
+//=====================================================================================
+
+template<int STATE_DIM>
+class TestFilter
+{
+  using Ukf = UnscentedKalmanFilter<STATE_DIM>;
+
+  int n_;
+  Ukf ukf_;
+
+  typename Ukf::MeasurementFn h_fn_;
+  typename Ukf::MeasurementResidualFn r_z_fn_;
+  typename Ukf::MeasurementMeanFn mean_z_fn_;
+
+public:
+
+  explicit TestFilter(int state_dim) :
+    n_{state_dim / 3},
+    ukf_{state_dim, 0.001, 2.0, 0}
+  {
+    using StateVector = typename Ukf::StateVector;
+    using MeasurementVector = typename Ukf::MeasurementVector;
+
+    ukf_.set_Q(Ukf::StateMatrix::Identity(state_dim, state_dim) * 0.01);
+    ukf_.set_outlier_distance(4.0);
+
+    // Constant acceleration, set by the control input, angles start at position 3
+    ukf_.set_f_fn([](const double dt, const ControlVector &u, Eigen::Ref<StateVector> x)
+                  {
+                    const int n = static_cast<int>(x.rows()) / 3;
+                    for (int i = 0; i < n; ++i) {
+                      x(2 * n + i) = n == 1 ? u(2) : (i < CONTROL_DIM ? u(i) : 0);
+                      x(n + i) += x(2 * n + i) * dt;
+                      x(i) += x(n + i) * dt;
+                      if (i >= 3) {
+                        x(i) = orca::norm_angle(x(i));
+                      }
+                    }
+                  });
+
+    h_fn_ = [](const Eigen::Ref<const StateVector> &x, Eigen::Ref<MeasurementVector> z)
+    {
+      for (int i = 0; i < z.rows(); ++i) {
+        z(i) = x(i);
+      }
+    };
+
+    if (n_ == 4) {
+      ukf_.set_r_x_fn(four_state_residual<StateVector>);
+      ukf_.set_mean_x_fn(four_state_mean<StateVector, typename Ukf::StateSigmaPoints, typename Ukf::Weights>);
+      r_z_fn_ = four_state_residual<MeasurementVector>;
+      mean_z_fn_ = four_state_mean<MeasurementVector, typename Ukf::MeasurementSigmaPoints, typename Ukf::Weights>;
+    } else if (n_ == 6) {
+      ukf_.set_r_x_fn(six_state_residual<StateVector>);
+      ukf_.set_mean_x_fn(six_state_mean<StateVector, typename Ukf::StateSigmaPoints, typename Ukf::Weights>);
+      r_z_fn_ = six_state_residual<MeasurementVector>;
+      mean_z_fn_ = six_state_mean<MeasurementVector, typename Ukf::MeasurementSigmaPoints, typename Ukf::Weights>;
+    } else {
+      r_z_fn_ = residual<MeasurementVector>;
+      mean_z_fn_ = unscented_mean<MeasurementVector, typename Ukf::MeasurementSigmaPoints, typename Ukf::Weights>;
+    }
+  }
+
+  const Ukf &ukf() const
+  { return ukf_; }
+
+  // Predict and update, the same calls that Filter::process makes for each measurement
+  bool step(double dt, const ControlVector &u, const typename Ukf::MeasurementVector &z,
+            const typename Ukf::MeasurementMatrix &R)
+  {
+    ukf_.predict(dt, u);
+    return ukf_.update(z, R, h_fn_, r_z_fn_, mean_z_fn_);
+  }
+};
+
+//=====================================================================================
+// Inputs
+//=====================================================================================
+
+struct Input
+{
+  double dt;
+  ControlVector u;
+  Eigen::VectorXd z;
+  Eigen::MatrixXd R;
+};
+
+// A slowly moving target, noisy measurements and a few outliers
+std::vector<Input> make_inputs(int n, int z_dim)
+{
+  std::mt19937 gen{1};
+  std::uniform_real_distribution<double> noise{-0.1, 0.1};
+  std::uniform_real_distribution<double> uniform{0, 1};
+
+  std::vector<Input> inputs(n);
+  Eigen::VectorXd truth = Eigen::VectorXd::Zero(z_dim);
+  for (auto &input : inputs) {
+    input.dt = 0.03 + 0.02 * uniform(gen);
+    input.u << noise(gen), noise(gen), noise(gen), noise(gen);
+
+    input.z = Eigen::VectorXd(z_dim);
+    for (int i = 0; i < z_dim; ++i) {
+      truth(i) += 0.01;
+      input.z(i) = truth(i) + noise(gen) + (uniform(gen) < 0.01 ? 10 : 0);
+      if (i >= 3) {
+        truth(i) = orca::norm_angle(truth(i));
+        input.z(i) = orca::norm_angle(input.z(i));
+      }
+    }
+
+    input.R = Eigen::MatrixXd::Identity(z_dim, z_dim) * 0.01;
+  }
+
+  return inputs;
+}
+
+//=====================================================================================
+// Tests
+//=====================================================================================
+
+// The fixed-size filter should match the dynamic filter, and never allocate
+template<int STATE_DIM>
+bool test_filter(const std::vector<Input> &inputs)
+{
+  using Ukf = UnscentedKalmanFilter<STATE_DIM>;
+
+  TestFilter<STATE_DIM> fixed{STATE_DIM};
+  TestFilter<Eigen::Dynamic> dynamic{STATE_DIM};
+
+  // Copy the inputs to fixed-size measurements before counting
+  std::vector<typename Ukf::MeasurementVector, Eigen::aligned_allocator<typename Ukf::MeasurementVector>> zs;
+  std::vector<typename Ukf::MeasurementMatrix, Eigen::aligned_allocator<typename Ukf::MeasurementMatrix>> Rs;
+  for (const auto &input : inputs) {
+    zs.emplace_back(input.z);
+    Rs.emplace_back(input.R);
+  }
+
+  bool ok = true;
+  long fixed_allocations = 0;
+
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const auto &input = inputs[i];
+
+    long start = allocations + eigen_allocations;
+    Eigen::internal::set_is_malloc_allowed(false);
+    bool fixed_inlier = fixed.step(input.dt, input.u, zs[i], Rs[i]);
+    Eigen::internal::set_is_malloc_allowed(true);
+    fixed_allocations += allocations + eigen_allocations - start;
+
+    bool dynamic_inlier = dynamic.step(input.dt, input.u, input.z, input.R);
+
+    ok = ok && fixed_inlier == dynamic_inlier && fixed.ukf().valid() &&
+         (fixed.ukf().x() - dynamic.ukf().x()).cwiseAbs().maxCoeff() < 1e-6 &&
+         (fixed.ukf().P() - dynamic.ukf().P()).cwiseAbs().maxCoeff() < 1e-6;
+  }
+
+  return ok && fixed_allocations == 0;
+}
+
+void test_filters()
+{
+  std::cout << (test_filter<DEPTH_STATE_DIM>(make_inputs(1000, 1)) &&
+                test_filter<FOUR_STATE_DIM>(make_inputs(1000, 4)) &&
+                test_filter<POSE_STATE_DIM>(make_inputs(1000, 6)) ?
+                "success" : "failure") << std::endl;
+}
+
+//=====================================================================================
+// Inputs for process_message: depth and pose messages from an AUV moving in a slow loop,
+// with noise, outliers, late messages (rewind) and very late messages (dropped)
+// Generated from a seed, so the same messages are replayed on every platform
+//=====================================================================================
+
+struct Message
+{
+  bool is_depth;
+  orca_msgs::msg::Depth depth;
+  geometry_msgs::msg::PoseWithCovarianceStamped pose;
+  orca::Acceleration u_bar;
+};
+
+// std distributions are implementation-defined, scale the raw mt19937 output instead
+class Random
+{
+  std::mt19937 gen_;
+
+public:
+
+  explicit Random(unsigned int seed) :
+    gen_{seed}
+  {}
+
+  double uniform(double min, double max)
+  { return min + (max - min) * (static_cast<double>(gen_()) / 4294967296.0); }
+};
+
+std::vector<Message> make_messages(unsigned int seed, int n, bool poses)
+{
+  Random r{seed};
+  std::vector<Message> messages(n);
+  double t = 1000;
+
+  for (int i = 0; i < n; ++i) {
+    auto &m = messages[i];
+    t += r.uniform(0.02, 0.04);
+
+    // Stamp, some messages are late
+    double stamp = t;
+    double late = r.uniform(0, 1);
+    if (late < 0.03) {
+      stamp -= 2;
+    } else if (late < 0.1) {
+      stamp -= r.uniform(0.05, 0.2);
+    }
+
+    // Truth
+    double x = 0.5 * std::sin(0.1 * stamp);
+    double y = 0.3 * std::cos(0.13 * stamp);
+    double z = -1 - 0.2 * std::sin(0.2 * stamp);
+    double roll = 0.05 * std::sin(stamp);
+    double pitch = 0.05 * std::cos(stamp);
+    double yaw = orca::norm_angle(0.2 * stamp);
+
+    m.is_depth = !poses || i % 2 == 0;
+    if (m.is_depth) {
+      m.depth.header.stamp = rclcpp::Time{static_cast<int64_t>(stamp * 1e9), RCL_ROS_TIME};
+      m.depth.z = z + r.uniform(-0.02, 0.02) + (r.uniform(0, 1) < 0.02 ? 1 : 0);
+      m.depth.z_variance = 0.01;
+    } else {
+      m.pose.header.stamp = rclcpp::Time{static_cast<int64_t>(stamp * 1e9), RCL_ROS_TIME};
+      m.pose.pose.pose.position.x = x + r.uniform(-0.05, 0.05);
+      m.pose.pose.pose.position.y = y + r.uniform(-0.05, 0.05);
+      m.pose.pose.pose.position.z = z + r.uniform(-0.05, 0.05) + (r.uniform(0, 1) < 0.02 ? 1 : 0);
+      tf2::Quaternion q;
+      q.setRPY(roll + r.uniform(-0.02, 0.02), pitch + r.uniform(-0.02, 0.02), yaw + r.uniform(-0.02, 0.02));
+      m.pose.pose.pose.orientation = tf2::toMsg(q);
+      for (int j = 0; j < 6; ++j) {
+        m.pose.pose.covariance[j * 7] = j < 3 ? 0.01 : 0.005;
+      }
+    }
+
+    m.u_bar = orca::Acceleration{r.uniform(-0.1, 0.1), r.uniform(-0.1, 0.1), r.uniform(-0.1, 0.1),
+                                 r.uniform(-0.1, 0.1)};
+  }
+
+  return messages;
+}
+
+//=====================================================================================
+// process_message tests: drive the real filters and compare to the reference outputs
+//=====================================================================================
+
+void odom_fields(const nav_msgs::msg::Odometry &odom, double *fields)
+{
+  const auto &p = odom.pose.pose;
+  const auto &t = odom.twist.twist;
+  double values[NUM_FIELDS] = {p.position.x, p.position.y, p.position.z,
+                               p.orientation.x, p.orientation.y, p.orientation.z, p.orientation.w,
+                               t.linear.x, t.linear.y, t.linear.z, t.angular.x, t.angular.y, t.angular.z,
+                               odom.pose.covariance[0], odom.pose.covariance[7], odom.pose.covariance[14],
+                               odom.pose.covariance[21], odom.pose.covariance[28], odom.pose.covariance[35]};
+  for (int i = 0; i < NUM_FIELDS; ++i) {
+    fields[i] = values[i];
+  }
+}
+
+// The UKF weights (alpha = 0.001) amplify rounding differences, and these grow with the
+// number of messages. Compiler settings (e.g., FMA contraction) move the outputs by up to ~1e-3
+// over NUM_MESSAGES, so check many short runs with a tolerance that still catches real changes.
+constexpr double TOLERANCE = 1e-2;
+
+bool process_messages(FilterBase &filter, bool poses, const double reference[][NUM_FIELDS], const char *published)
+{
+  bool ok = true;
+  int check = 0;
+
+  for (int run = 0; run < NUM_RUNS; ++run) {
+    auto messages = make_messages(run + 1, NUM_MESSAGES, poses);
+
+    geometry_msgs::msg::Pose start;
+    start.position.z = -1;
+    filter.reset(start);
+
+    nav_msgs::msg::Odometry odom;
+
+    for (int i = 0; i < NUM_MESSAGES; ++i) {
+      const auto &m = messages[i];
+      bool result = m.is_depth ?
+                    filter.process_message(m.depth, m.u_bar, odom) :
+                    filter.process_message(m.pose, m.u_bar, odom);
+      ok = ok && result == (published[run * NUM_MESSAGES + i] == '1');
+
+      if (i % CHECK_INTERVAL == CHECK_INTERVAL - 1) {
+        double fields[NUM_FIELDS];
+        odom_fields(odom, fields);
+        for (int j = 0; j < NUM_FIELDS; ++j) {
+          const double expected = reference[check][j];
+          ok = ok && std::abs(fields[j] - expected) < TOLERANCE * std::max(1.0, std::abs(expected));
+        }
+        ++check;
+      }
+    }
+  }
+
+  return ok;
+}
+
+void test_process_message()
+{
+  FilterContext cxt;
+  rclcpp::Logger logger{rclcpp::get_logger("filter_test")};
+  DepthFilter depth_filter{logger, cxt};
+  FourFilter four_filter{logger, cxt};
+  PoseFilter pose_filter{logger, cxt};
+
+  std::cout << (process_messages(depth_filter, false, DEPTH_REFERENCE, DEPTH_PUBLISHED) &&
+                process_messages(four_filter, true, FOUR_REFERENCE, FOUR_PUBLISHED) &&
+                process_messages(pose_filter, true, POSE_REFERENCE, POSE_PUBLISHED) ?
+                "success" : "failure") << std::endl;
+}
+
+//=====================================================================================
+// Benchmark: predict + update, dynamic vs fixed
+//=====================================================================================
+
+template<int STATE_DIM>
+double time_filter(int state_dim, const std::vector<Input> &inputs, int reps, long &count, double &sum)
+{
+  using Ukf = UnscentedKalmanFilter<STATE_DIM>;
+
+  std::vector<typename Ukf::MeasurementVector, Eigen::aligned_allocator<typename Ukf::MeasurementVector>> zs;
+  std::vector<typename Ukf::MeasurementMatrix, Eigen::aligned_allocator<typename Ukf::MeasurementMatrix>> Rs;
+  for (const auto &input : inputs) {
+    zs.emplace_back(input.z);
+    Rs.emplace_back(input.R);
+  }
+
+  long start_count = allocations + eigen_allocations;
+  Eigen::internal::set_is_malloc_allowed(false);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < reps; ++r) {
+    TestFilter<STATE_DIM> filter{state_dim};
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      filter.step(inputs[i].dt, inputs[i].u, zs[i], Rs[i]);
+    }
+    sum += filter.ukf().x()(0);
+  }
+  auto time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  Eigen::internal::set_is_malloc_allowed(true);
+  count = allocations + eigen_allocations - start_count;
+
+  return time;
+}
+
+template<int STATE_DIM>
+void benchmark(const char *name, int z_dim)
+{
+  constexpr int REPS = 10;
+  auto inputs = make_inputs(1000, z_dim);
+  double n = static_cast<double>(inputs.size()) * REPS;
+  double sum_dynamic = 0, sum_fixed = 0;
+  long count_dynamic, count_fixed;
+
+  double dynamic_time = time_filter<Eigen::Dynamic>(STATE_DIM, inputs, REPS, count_dynamic, sum_dynamic);
+  double fixed_time = time_filter<STATE_DIM>(STATE_DIM, inputs, REPS, count_fixed, sum_fixed);
+
+  std::cout << name << ": dynamic " << dynamic_time / n * 1e6 << "us, " << count_dynamic / n
+            << " allocations, fixed " << fixed_time / n * 1e6 << "us, " << count_fixed / n
+            << " allocations per predict + update (" << sum_dynamic << ", " << sum_fixed << ")" << std::endl;
+}
+
+//=====================================================================================
+// Benchmark: process_message
+//=====================================================================================
+
+void benchmark_process_message(const char *name, FilterBase &filter, bool poses)
+{
+  constexpr int REPS = 10;
+  auto messages = make_messages(1, 1000, poses);
+  geometry_msgs::msg::Pose start;
+  start.position.z = -1;
+  nav_msgs::msg::Odometry odom;
+  double n = static_cast<double>(messages.size()) * REPS;
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < REPS; ++r) {
+    filter.reset(start);
+    for (const auto &m : messages) {
+      if (m.is_depth) {
+        filter.process_message(m.depth, m.u_bar, odom);
+      } else {
+        filter.process_message(m.pose, m.u_bar, odom);
+      }
+    }
+  }
+  auto time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+
+  std::cout << name << " process_message: " << time / n * 1e6 << "us ("
+            << odom.pose.pose.position.z << ")" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  test_filters();
+  test_process_message();
+  benchmark<DEPTH_STATE_DIM>("depth", 1);
+  benchmark<FOUR_STATE_DIM>("four", 4);
+  benchmark<POSE_STATE_DIM>("pose", 6);
+
+  FilterContext cxt;
+  rclcpp::Logger logger{rclcpp::get_logger("filter_test")};
+  DepthFilter depth_filter{logger, cxt};
+  FourFilter four_filter{logger, cxt};
+  PoseFilter pose_filter{logger, cxt};
+  benchmark_process_message("depth", depth_filter, false);
+  benchmark_process_message("four", four_filter, true);
+  benchmark_process_message("pose", pose_filter, true);
+}
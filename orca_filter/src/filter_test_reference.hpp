@@ -0,0 +1,133 @@
+#ifndef ORCA_FILTER_FILTER_TEST_REFERENCE_HPP
+#define ORCA_FILTER_FILTER_TEST_REFERENCE_HPP
+
+//=====================================================================================
+// Reference outputs for the process_message tests in filter_test.cpp
+//
+// Generated by running make_messages(run + 1, ...) through the DepthFilter, FourFilter and
+// PoseFilter from before the fixed-size change (dynamic Eigen types, heap-allocated UKF
+// with the ukf package's algorithm), starting each run from reset() with z = -1.
+//
+// *_REFERENCE: the filtered odometry after every CHECK_INTERVAL messages:
+//    position (3), orientation quaternion (4), linear (3) and angular (3) twist,
+//    pose covariance diagonal (6)
+// *_PUBLISHED: the return value of process_message for every message, one line per run
+//=====================================================================================
+
+constexpr int NUM_RUNS = 8;
+constexpr int NUM_MESSAGES = 30;
+constexpr int CHECK_INTERVAL = 10;
+constexpr int NUM_FIELDS = 19;
+
+const double DEPTH_REFERENCE[][NUM_FIELDS] = {
+  {0, 0, -0.830044603, 0, 0, 0, 1, 0, 0, 0.1366200121, 0, 0, 0, 1000000, 1000000, 0.01670868928, 1000000, 1000000, 1000000},
+  {0, 0, -0.8364086838, 0, 0, 0, 1, 0, 0, 0.00984626318, 0, 0, 0, 1000000, 1000000, 0.01633301417, 1000000, 1000000, 1000000},
+  {0, 0, -0.858788526, 0, 0, 0, 1, 0, 0, 0.02829941743, 0, 0, 0, 1000000, 1000000, 0.01630213482, 1000000, 1000000, 1000000},
+  {0, 0, -0.8299229263, 0, 0, 0, 1, 0, 0, -0.06512550988, 0, 0, 0, 1000000, 1000000, 0.0164673013, 1000000, 1000000, 1000000},
+  {0, 0, -0.8519135756, 0, 0, 0, 1, 0, 0, -0.09754418148, 0, 0, 0, 1000000, 1000000, 0.01632036799, 1000000, 1000000, 1000000},
+  {0, 0, -0.8539171042, 0, 0, 0, 1, 0, 0, -0.01263527954, 0, 0, 0, 1000000, 1000000, 0.0163185954, 1000000, 1000000, 1000000},
+  {0, 0, -0.8267842707, 0, 0, 0, 1, 0, 0, 0.1725990284, 0, 0, 0, 1000000, 1000000, 0.01668142545, 1000000, 1000000, 1000000},
+  {0, 0, -0.8457171734, 0, 0, 0, 1, 0, 0, 0.05430175903, 0, 0, 0, 1000000, 1000000, 0.0163890366, 1000000, 1000000, 1000000},
+  {0, 0, -0.8523198675, 0, 0, 0, 1, 0, 0, -0.03590003452, 0, 0, 0, 1000000, 1000000, 0.01627270929, 1000000, 1000000, 1000000},
+  {0, 0, -0.8314987902, 0, 0, 0, 1, 0, 0, -0.009405096933, 0, 0, 0, 1000000, 1000000, 0.01643930628, 1000000, 1000000, 1000000},
+  {0, 0, -0.8301501116, 0, 0, 0, 1, 0, 0, 0.04210576726, 0, 0, 0, 1000000, 1000000, 0.01640953644, 1000000, 1000000, 1000000},
+  {0, 0, -0.8369649542, 0, 0, 0, 1, 0, 0, -0.07754543774, 0, 0, 0, 1000000, 1000000, 0.01635553693, 1000000, 1000000, 1000000},
+  {0, 0, -0.8207634951, 0, 0, 0, 1, 0, 0, 0.05431480307, 0, 0, 0, 1000000, 1000000, 0.01660862772, 1000000, 1000000, 1000000},
+  {0, 0, -0.833166116, 0, 0, 0, 1, 0, 0, 0.1202640908, 0, 0, 0, 1000000, 1000000, 0.01635064297, 1000000, 1000000, 1000000},
+  {0, 0, -0.8397273579, 0, 0, 0, 1, 0, 0, -0.07098596408, 0, 0, 0, 1000000, 1000000, 0.01637553352, 1000000, 1000000, 1000000},
+  {0, 0, -0.834539984, 0, 0, 0, 1, 0, 0, -0.08118777218, 0, 0, 0, 1000000, 1000000, 0.01647022345, 1000000, 1000000, 1000000},
+  {0, 0, -0.8404381797, 0, 0, 0, 1, 0, 0, -0.09870869065, 0, 0, 0, 1000000, 1000000, 0.01636218806, 1000000, 1000000, 1000000},
+  {0, 0, -0.8465084789, 0, 0, 0, 1, 0, 0, 0.0975469102, 0, 0, 0, 1000000, 1000000, 0.01640478141, 1000000, 1000000, 1000000},
+  {0, 0, -0.8343507105, 0, 0, 0, 1, 0, 0, 0.1492162188, 0, 0, 0, 1000000, 1000000, 0.0164501358, 1000000, 1000000, 1000000},
+  {0, 0, -0.8414420956, 0, 0, 0, 1, 0, 0, -0.130177868, 0, 0, 0, 1000000, 1000000, 0.01661621164, 1000000, 1000000, 1000000},
+  {0, 0, -0.8448344524, 0, 0, 0, 1, 0, 0, -0.001998382285, 0, 0, 0, 1000000, 1000000, 0.01635444784, 1000000, 1000000, 1000000},
+  {0, 0, -0.8337679354, 0, 0, 0, 1, 0, 0, -0.1440026692, 0, 0, 0, 1000000, 1000000, 0.0164308895, 1000000, 1000000, 1000000},
+  {0, 0, -0.8381019554, 0, 0, 0, 1, 0, 0, 0.02186530378, 0, 0, 0, 1000000, 1000000, 0.0163870635, 1000000, 1000000, 1000000},
+  {0, 0, -0.8282395458, 0, 0, 0, 1, 0, 0, 0.1314499337, 0, 0, 0, 1000000, 1000000, 0.01652763428, 1000000, 1000000, 1000000},
+};
+
+const char *DEPTH_PUBLISHED =
+  "011111111011011111111111010111"
+  "111111111111111111111111111111"
+  "111111111111111110111111111111"
+  "111110111111111111111111111111"
+  "111111111111111111111111111111"
+  "111111111111111111111111111111"
+  "110111111111111111111111111111"
+  "111111111111111101111111011101";
+
+const double FOUR_REFERENCE[][NUM_FIELDS] = {
+  {-0.2256712484, -0.1077517333, -0.8261033565, 0, 0, -0.4888940821, 0.8723431529, -0.02071807284, 0.09980206263, -0.03893850964, 0, 0, 0.07915748585, 0.05038299494, 0.05034841191, 0.01741974322, 1, 1, 0.04686486044},
+  {-0.2222669846, -0.1207791164, -0.811195327, 0, 0, -0.4561546322, 0.889900529, 0.0416293863, -0.07653108881, 0.1542884119, 0, 0, -0.054407862, 0.01819189278, 0.01813489305, 0.01634027805, 1, 1, 0.01444372392},
+  {-0.1943937774, -0.1052785279, -0.8461415925, 0, 0, -0.4267234867, 0.9043821459, -0.00696534324, 0.02413572645, 0.02673542763, 0, 0, 0.03519975443, 0.02769176276, 0.02764259566, 0.01622866928, 1, 1, 0.02438094694},
+  {-0.2126064704, -0.1020001533, -0.8346068906, 0, 0, -0.4746363229, 0.8801820045, 0.02553745185, -0.1109915217, -0.04722239128, 0, 0, 0.1432926914, 0.01767235153, 0.01765553982, 0.01639891682, 1, 1, 0.01425368432},
+  {-0.2073572618, -0.08542484519, -0.8556715854, 0, 0, -0.4440957199, 0.8959793477, 0.009175769113, -0.01982048217, 0.02789712965, 0, 0, 0.08384747139, 0.01754692502, 0.0175367462, 0.01635036395, 1, 1, 0.01420986311},
+  {-0.2110851654, -0.0628648727, -0.8230634873, 0, 0, -0.4159168774, 0.9094026342, -0.06765002613, 0.06293909064, 0.03504708026, 0, 0, 0.08605331939, 0.01755343799, 0.01754232826, 0.01634762904, 1, 1, 0.01421446444},
+  {-0.21649637, -0.1124972057, -0.8451706865, 0, 0, -0.4856025207, 0.8741797252, 0.08893109598, -0.1019378447, -0.1960335597, 0, 0, -0.07330666926, 0.01771289685, 0.01768110605, 0.01661941233, 1, 1, 0.01425731748},
+  {-0.2501358184, -0.1021956487, -0.820019397, 0, 0, -0.4459354493, 0.8950651234, -0.0627203417, 0.0139487576, 0.08034570615, 0, 0, 0.03735010847, 0.01753823288, 0.01751513765, 0.01633925746, 1, 1, 0.01421343952},
+  {-0.231684719, -0.08054840446, -0.8279866392, 0, 0, -0.4188693486, 0.9080465125, -0.02027491381, 0.06281477543, 0.1237609164, 0, 0, 0.115725708, 0.01755269056, 0.01753138274, 0.01636609005, 1, 1, 0.01421734011},
+  {-0.271431897, -0.1026069609, -0.8483227619, 0, 0, -0.4881146259, 0.8727795323, 0.001362859013, -0.06349928799, -0.1537098923, 0, 0, -0.09484940041, 0.01755826068, 0.01757231028, 0.01636827962, 1, 1, 0.0142170539},
+  {-0.2382467007, -0.1159545979, -0.8458285704, 0, 0, -0.4597270926, 0.8880602459, -0.06571196939, -0.03185479792, -0.06462177617, 0, 0, -0.05690650627, 0.01749471098, 0.0174932308, 0.01631476276, 1, 1, 0.01419807773},
+  {-0.1899685176, -0.0979085165, -0.8662517421, 0, 0, -0.4216524049, 0.9067575472, 0.03615264466, -0.1167246642, 0.0009209216342, 0, 0, -0.02290622365, 0.01753242238, 0.01751337701, 0.01631114738, 1, 1, 0.0142028964},
+  {-0.2643815333, -0.07022430147, -0.8391673636, 0, 0, -0.4817862686, 0.8762887603, -0.05915131703, 0.01998234774, 5.466327212e-05, 0, 0, -0.002581470463, 0.01746642177, 0.01740823507, 0.01739394514, 1, 1, 0.01416847009},
+  {-0.1842566434, -0.06208650589, -0.8133938889, 0, 0, -0.4658870566, 0.8848441956, 0.05170894806, 0.001571108906, 0.02469581635, 0, 0, 0.004205548321, 0.01816482754, 0.01809399565, 0.01635300384, 1, 1, 0.01442506604},
+  {-0.179846662, -0.0711092985, -0.8316555411, 0, 0, -0.4225171578, 0.9063549257, 0.05589661648, 0.02157332713, 0.09183677776, 0, 0, -0.01254252835, 0.01753226782, 0.01750378188, 0.01634888057, 1, 1, 0.01420314193},
+  {-0.264760965, -0.08979172449, -0.8294793628, 0, 0, -0.4754978359, 0.8797168909, -0.05569826332, -0.01710670064, 0.0379699131, 0, 0, -0.01684816659, 0.01762563828, 0.01764512336, 0.01642234658, 1, 1, 0.01424297674},
+  {-0.2605161951, -0.06384385259, -0.8308261579, 0, 0, -0.4483248061, 0.8938707223, -0.04703299273, -0.01522414567, 0.07730467862, 0, 0, 0.01357777171, 0.01753966687, 0.01754735869, 0.01632983764, 1, 1, 0.01421709699},
+  {-0.2365981441, -0.07633421731, -0.8521271941, 0, 0, -0.4294670628, 0.9030825222, -0.0003368734146, 0.02750969367, 0.0324660378, 0, 0, 0.006699776228, 0.01747561822, 0.01746321914, 0.01629752379, 1, 1, 0.01419520143},
+  {-0.2007205418, -0.08073621809, -0.8549306605, 0, 0, -0.4767979141, 0.8790129403, 0.03797947099, 0.1476117627, -0.06530694347, 0, 0, 0.1479801294, 0.01763057767, 0.01760905747, 0.01636849737, 1, 1, 0.01422992984},
+  {-0.2126054276, -0.1135630947, -0.8394919636, 0, 0, -0.4513942819, 0.8923246059, -0.02822160371, -0.01080558245, -0.08244700405, 0, 0, 0.02089814278, 0.01754583554, 0.01752019147, 0.0163511586, 1, 1, 0.01420293144},
+  {-0.244921994, -0.086013238, -0.8586339042, 0, 0, -0.4287853392, 0.9034064052, -0.01391864581, -0.04658468604, -0.06163044472, 0, 0, -0.03072500389, 0.01733969381, 0.01733558173, 0.01624489426, 1, 1, 0.01415446732},
+  {-0.2426277873, -0.1206840339, -0.8631305614, 0, 0, -0.4839143297, 0.8751153761, 0.001433016125, -0.08691613967, -0.003859024, 0, 0, 0.08583110142, 0.01770726969, 0.01765309022, 0.01647392619, 1, 1, 0.01424224487},
+  {-0.2550971178, -0.0888456016, -0.8162956975, 0, 0, -0.458073553, 0.8889142929, -0.04627044484, -0.05497344263, 0.1055692443, 0, 0, -0.05309079084, 0.01749473948, 0.01747904861, 0.0162852649, 1, 1, 0.01418661081},
+  {-0.2533054937, -0.04254140307, -0.8638564695, 0, 0, -0.4285053073, 0.903539264, -0.01532559787, 0.03922527759, -0.02603419067, 0, 0, 0.03896104776, 0.01746865355, 0.01746062694, 0.01628354998, 1, 1, 0.01418713912},
+};
+
+const char *FOUR_PUBLISHED =
+  "011111101111101111111110111111"
+  "111111111111110111111111111111"
+  "111111111111111111111111111111"
+  "111101111111111111111011111111"
+  "111111110111111110111111111111"
+  "111111111111111111111111111111"
+  "111111111111111111111110111111"
+  "111111111111011111111111111111";
+
+const double POSE_REFERENCE[][NUM_FIELDS] = {
+  {-0.2277210423, -0.1124039247, -0.8255603785, 0.0004718922507, 0.0001196953317, -0.4897861332, 0.8718424781, -0.0492635686, -0.09505537814, -0.00604075394, 0.0275591862, 0.02618169794, 0.05034168313, 0.05039297618, 0.05031872291, 0.01741240404, 0.01022874843, 0.01038144263, 0.04676386309},
+  {-0.2223990381, -0.1236646436, -0.8162220355, 0.001165256362, -0.002883277804, -0.4564871768, 0.8897245564, 0.04143554632, -0.1680827672, -0.01779025761, 0.1773712902, -0.1532933074, -0.09418457449, 0.01819828945, 0.01820345694, 0.01635430226, 0.01025225985, 0.01034013976, 0.01445215771},
+  {-0.1923417362, -0.1067773038, -0.8468826458, 0.0003562815544, 0.0001346526072, -0.4269987635, 0.904252128, 0.04794115679, -0.02497687936, -0.06170165862, 0.02614174677, 0.0270443071, 0.02367840733, 0.02770139405, 0.02768251904, 0.0162370765, 0.01012704699, 0.01017798624, 0.02438796561},
+  {-0.2107165216, -0.1008608189, -0.8330833428, 0.00117450373, -0.0002386844149, -0.4742817894, 0.880372278, 0.03246481322, -0.02230691982, 0.03244692316, 0.07986105455, 0.02416006307, 0.05172928908, 0.01765155526, 0.01763728704, 0.01638191213, 0.01034779476, 0.01035438755, 0.01425473567},
+  {-0.2075906324, -0.08642296048, -0.8561939468, 0.002328754991, -0.000541093274, -0.4441631029, 0.8959427561, 0.05644846655, -0.02837727319, -0.00673527725, 0.1236686, 0.02918399519, 0.05776448782, 0.01753893172, 0.01752331007, 0.01633472569, 0.01036899873, 0.01048711684, 0.01421133678},
+  {-0.2109810707, -0.06279932217, -0.8239707231, 0.001835251678, -0.001074120834, -0.4161626792, 0.9092876897, -0.062719872, 0.06547484687, -0.006285356321, 0.1093286515, -0.01102272844, 0.05310360334, 0.01754418069, 0.017533885, 0.01633617854, 0.01036556502, 0.01045216588, 0.01421620808},
+  {-0.2156194105, -0.1133070409, -0.8422981661, 0.001969211767, -0.0001487120976, -0.4854400948, 0.8742677018, 0.1270074083, 0.03728421698, 0.07387065645, 0.09586656976, 0.04413480231, -0.06183411389, 0.01771144647, 0.01767364938, 0.01647220724, 0.01021157128, 0.0102597059, 0.01427169995},
+  {-0.2491064067, -0.1022329205, -0.8212091556, 0.0007112318862, -7.937053489e-05, -0.4463544554, 0.8948559594, -0.01209992992, 0.01216407262, -0.06158475881, 0.0561607039, 0.02060109136, 0.05121248626, 0.01753399832, 0.01750531127, 0.01629996011, 0.0101029141, 0.01013397155, 0.01421438848},
+  {-0.2316503831, -0.08034968926, -0.8270270628, 0.0005105735145, -0.001573842064, -0.4185894187, 0.9081740807, -0.06291770603, 0.06607395124, 0.1595285728, 0.05980244715, -0.06474509282, 0.1543589173, 0.0175578162, 0.01752457235, 0.01634378559, 0.01027176116, 0.01033093047, 0.0142176173},
+  {-0.2705314784, -0.1009222924, -0.8460212742, 0.002424076837, -0.0007303318456, -0.4877003722, 0.8730074097, -0.00471270208, 0.1347733473, 0.06103099302, 0.1819653704, 0.04009526373, 0.1174960652, 0.01756072688, 0.01755853673, 0.01634765617, 0.01017199864, 0.01031240038, 0.01421163362},
+  {-0.2379617176, -0.1158518217, -0.8461553488, 0.001443991134, -7.509859857e-05, -0.4596280404, 0.8881103387, -0.05906025336, -0.02487421957, -0.08512335413, 0.09166274495, 0.04153988248, -0.0442915067, 0.01750289389, 0.01748913122, 0.01632299387, 0.01014378851, 0.01031596563, 0.014197644},
+  {-0.189728677, -0.09785630507, -0.8669947714, 0.0009438197811, -0.001677440697, -0.4218676749, 0.9066553702, 0.0125170254, -0.0470090401, -0.07373601867, 0.08985211807, -0.06450437719, -0.05828985749, 0.0175346729, 0.01751844926, 0.01631698703, 0.01021680374, 0.01040486177, 0.01420808088},
+  {-0.2645969547, -0.06988797673, -0.8390802257, 0.001599266206, -0.000591920242, -0.4817182575, 0.8763244903, -0.08742245312, 0.01128011555, -0.06956501282, 0.1584414634, 0.02364235682, 0.01910980393, 0.01749030829, 0.01747293921, 0.01739312911, 0.01003215972, 0.01006319674, 0.01417572021},
+  {-0.1846127116, -0.0608123739, -0.8120990669, 0.0007817935258, -0.0002443889827, -0.4657686243, 0.8849061632, 0.03925385514, 0.02187950808, 0.02810579278, 0.0570823725, 0.01048050978, 0.02360826201, 0.0181877519, 0.01818522947, 0.01635917701, 0.01006836508, 0.01016224927, 0.01443673289},
+  {-0.1796406923, -0.07137705873, -0.8316259573, 0.001251160544, -0.001097072051, -0.4225612205, 0.9063328561, 0.06468489284, -0.06018737132, 0.09321627982, 0.0806790298, -0.0235238971, -0.02063289253, 0.0175498119, 0.01753838796, 0.01635284351, 0.01021386961, 0.01034601679, 0.01420674479},
+  {-0.2657947602, -0.09052440899, -0.8317802219, 0.001965231364, -0.0003224993141, -0.476130988, 0.8793721147, -0.09851617384, -0.0583617696, -0.1559516905, 0.1100814737, 0.03816749164, -0.1108824599, 0.01762085172, 0.01762220259, 0.01641256598, 0.01039880984, 0.01050128052, 0.01423646654},
+  {-0.2603378763, -0.06345963149, -0.8301890909, 0.001274178329, -9.117603966e-05, -0.4483081493, 0.8938781636, -0.08585608486, 0.08250389679, 0.1134403962, 0.08919650432, 0.03701734536, 0.1134134041, 0.01753816011, 0.01754572648, 0.01632388573, 0.01020836948, 0.01024754763, 0.01421052141},
+  {-0.2387059956, -0.07735695445, -0.8513115321, 0.0006240359493, -0.0005710728214, -0.4298745162, 0.902888246, -0.04499167798, -0.0159364943, 0.005232152929, 0.06473866219, -0.01979907379, 0.04663685527, 0.01748303212, 0.01748708225, 0.0163016825, 0.01011511788, 0.01015605529, 0.01419566649},
+  {-0.2009135518, -0.08091182881, -0.8543118779, 0.003604711849, -0.0001608445319, -0.4770027558, 0.8788943913, 0.03279250573, 0.1501202839, -0.02570213281, 0.2296269201, 0.1116563758, 0.1251408981, 0.01762978525, 0.01762019698, 0.01638209414, 0.01039916352, 0.01043301373, 0.01423885009},
+  {-0.2124900072, -0.1135153519, -0.8366318051, 0.00102750259, -0.0009980814565, -0.4514104882, 0.8923152577, -0.01910083743, -0.011127196, 0.1309313034, 0.07654475698, -0.0238666805, -0.06675092857, 0.01754442103, 0.01754023053, 0.01636209734, 0.0103817746, 0.01045656495, 0.01421214646},
+  {-0.244764161, -0.08575509875, -0.8587009878, 0.0006167312876, -0.0001961259541, -0.4286646842, 0.9034634302, -0.004499900156, -0.02302995123, -0.06609864608, 0.05506158136, 0.007480160617, 0.05853519276, 0.01733798738, 0.01733903818, 0.01624460922, 0.01015902199, 0.01017840591, 0.01415393476},
+  {-0.24212272, -0.1213715599, -0.8641517234, 0.001953329973, 0.0008240997528, -0.4829957794, 0.8756201131, 0.122474637, -0.1143783597, -0.02863184595, 0.06600020044, 0.08370278666, 0.03215221331, 0.01774969065, 0.01774607198, 0.0165201436, 0.01027025226, 0.01053713184, 0.01428978032},
+  {-0.2546326305, -0.0883411633, -0.816747558, 0.0004735610366, -0.0001095891142, -0.4580702711, 0.8889158512, -0.02252308883, 0.04569134426, 0.07817004435, 0.04134152078, 0.01049027867, -0.07232600751, 0.01749984436, 0.0175089087, 0.0162916329, 0.01010626819, 0.01016893937, 0.01419537152},
+  {-0.2533988516, -0.04206759714, -0.8634803655, 0.001134248056, -0.0008408736614, -0.4284612744, 0.9035590422, -0.01452910203, 0.008124060823, -0.005603391984, 0.09951010618, -0.01966207598, 0.05005414341, 0.01747383576, 0.0174744224, 0.01628576856, 0.01019184962, 0.01025339321, 0.01419114824},
+};
+
+const char *POSE_PUBLISHED =
+  "011111101111101111111110111111"
+  "111111111111110111111111111111"
+  "111111111111111111111111111111"
+  "111101111111111111111011111111"
+  "111111110111111110111111111111"
+  "111111111111111111111111111111"
+  "111111111111111111111110111111"
+  "111111111111011111111111111111";
+
+#endif // ORCA_FILTER_FILTER_TEST_REFERENCE_HPP
@@ -15,8 +15,6 @@ namespace orca_filter
   // FourFilter -- 4dof filter with 12 dimensions
   //==================================================================
 
-  constexpr int FOUR_STATE_DIM = 12;      // [x, y, ..., vx, vy, ..., ax, ay, ...]T
-
   // Four state macros
 #define fx_x x(0)
 #define fx_y x(1)
@@ -32,9 +30,9 @@ namespace orca_filter
 #define fx_ayaw x(11)
 
   // Init x from pose
-  Eigen::VectorXd pose_to_fx(const geometry_msgs::msg::Pose &pose)
+  FourFilter::StateVector pose_to_fx(const geometry_msgs::msg::Pose &pose)
   {
-    Eigen::VectorXd x = Eigen::VectorXd::Zero(FOUR_STATE_DIM);
+    FourFilter::StateVector x = FourFilter::StateVector::Zero();
 
     fx_x = pose.position.x;
     fx_y = pose.position.y;
@@ -45,7 +43,7 @@ namespace orca_filter
   }
 
   // Extract pose from PoseFilter state
-  void pose_from_fx(const Eigen::VectorXd &x, geometry_msgs::msg::Pose &out)
+  void pose_from_fx(const FourFilter::StateVector &x, geometry_msgs::msg::Pose &out)
   {
     out.position.x = fx_x;
     out.position.y = fx_y;
@@ -61,7 +59,7 @@ namespace orca_filter
   }
 
   // Extract twist from PoseFilter state
-  void twist_from_fx(const Eigen::VectorXd &x, geometry_msgs::msg::Twist &out)
+  void twist_from_fx(const FourFilter::StateVector &x, geometry_msgs::msg::Twist &out)
   {
     out.linear.x = fx_vx;
     out.linear.y = fx_vy;
@@ -73,10 +71,10 @@ namespace orca_filter
   }
 
   // Extract pose or twist covariance from PoseFilter covariance
-  void flatten_4x4_covar(const Eigen::MatrixXd &P, std::array<double, 36> &pose_covar, bool pose)
+  void flatten_4x4_covar(const FourFilter::StateMatrix &P, std::array<double, 36> &pose_covar, bool pose)
   {
     // Start with identity
-    Eigen::MatrixXd m = Eigen::MatrixXd::Identity(6, 6);
+    Eigen::Matrix<double, 6, 6> m = Eigen::Matrix<double, 6, 6>::Identity();
 
     // Copy values from the 4x4 into the 6x6
     int offset = pose ? 0 : 4;
@@ -90,48 +88,14 @@ namespace orca_filter
     flatten_6x6_covar(m, pose_covar, 0);
   }
 
-  Eigen::VectorXd four_state_residual(const Eigen::Ref<const Eigen::VectorXd> &x, const Eigen::VectorXd &mean)
-  {
-    // Residual for all fields
-    Eigen::VectorXd residual = x - mean;
-
-    // Normalize yaw
-    residual(3) = norm_angle(residual(3));
-
-    return residual;
-  }
-
-  Eigen::VectorXd four_state_mean(const Eigen::MatrixXd &sigma_points, const Eigen::RowVectorXd &Wm)
-  {
-    Eigen::VectorXd mean = Eigen::VectorXd::Zero(sigma_points.rows());
-
-    // Standard mean for all fields
-    for (long i = 0; i < sigma_points.cols(); ++i) {
-      mean += Wm(i) * sigma_points.col(i);
-    }
-
-    // Sum the sines and cosines
-    double sum_y_sin = 0.0, sum_y_cos = 0.0;
-
-    for (long i = 0; i < sigma_points.cols(); ++i) {
-      sum_y_sin += Wm(i) * sin(sigma_points(3, i));
-      sum_y_cos += Wm(i) * cos(sigma_points(3, i));
-    }
-
-    // Mean is arctan2 of the sums
-    mean(3) = atan2(sum_y_sin, sum_y_cos);
-
-    return mean;
-  }
-
   FourFilter::FourFilter(const rclcpp::Logger &logger, const FilterContext &cxt) :
-    FilterBase{logger, cxt, FOUR_STATE_DIM}
+    Filter{logger, cxt}
   {
-    filter_.set_Q(Eigen::MatrixXd::Identity(FOUR_STATE_DIM, FOUR_STATE_DIM) * 0.01);
+    filter_.set_Q(StateMatrix::Identity() * 0.01);
 
     // State transition function
     filter_.set_f_fn(
-      [&cxt](const double dt, const Eigen::VectorXd &u, Eigen::Ref<Eigen::VectorXd> x)
+      [&cxt](const double dt, const ControlVector &u, Eigen::Ref<StateVector> x)
       {
         if (cxt.predict_accel_) {
           // Assume 0 acceleration
@@ -192,13 +156,13 @@ namespace orca_filter
       });
 
     // Custom residual and mean functions
-    filter_.set_r_x_fn(four_state_residual);
-    filter_.set_mean_x_fn(four_state_mean);
+    filter_.set_r_x_fn(four_state_residual<StateVector>);
+    filter_.set_mean_x_fn(four_state_mean<StateVector, Ukf::StateSigmaPoints, Ukf::Weights>);
   }
 
   void FourFilter::reset(const geometry_msgs::msg::Pose &pose)
   {
-    FilterBase::reset(pose_to_fx(pose));
+    Filter::reset(pose_to_fx(pose));
   }
 
   void FourFilter::odom_from_filter(nav_msgs::msg::Odometry &filtered_odom)
@@ -209,20 +173,20 @@ namespace orca_filter
     flatten_4x4_covar(filter_.P(), filtered_odom.twist.covariance, false);
   }
 
-  Measurement FourFilter::to_measurement(const orca_msgs::msg::Depth &depth) const
+  Measurement<FOUR_STATE_DIM> FourFilter::to_measurement(const orca_msgs::msg::Depth &depth) const
   {
-    Measurement m;
-    m.init_z(depth, [](const Eigen::Ref<const Eigen::VectorXd> &x, Eigen::Ref<Eigen::VectorXd> z)
+    Measurement<FOUR_STATE_DIM> m;
+    m.init_z(depth, [](const Eigen::Ref<const StateVector> &x, Eigen::Ref<Ukf::MeasurementVector> z)
     {
       z(0) = fx_z;
     });
     return m;
   }
 
-  Measurement FourFilter::to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const
+  Measurement<FOUR_STATE_DIM> FourFilter::to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const
   {
-    Measurement m;
-    m.init_4dof(pose, [](const Eigen::Ref<const Eigen::VectorXd> &x, Eigen::Ref<Eigen::VectorXd> z)
+    Measurement<FOUR_STATE_DIM> m;
+    m.init_4dof(pose, [](const Eigen::Ref<const StateVector> &x, Eigen::Ref<Ukf::MeasurementVector> z)
     {
       z(0) = fx_x;
       z(1) = fx_y;
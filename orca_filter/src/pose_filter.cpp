@@ -15,8 +15,6 @@ namespace orca_filter
   // PoseFilter -- 6dof filter with 18 dimensions
   //==================================================================
 
-  constexpr int POSE_STATE_DIM = 18;      // [x, y, ..., vx, vy, ..., ax, ay, ...]T
-
   // Pose state macros
 #define px_x x(0)
 #define px_y x(1)
@@ -38,9 +36,9 @@ namespace orca_filter
 #define px_ayaw x(17)
 
   // Init x from pose
-  Eigen::VectorXd pose_to_px(const geometry_msgs::msg::Pose &pose)
+  PoseFilter::StateVector pose_to_px(const geometry_msgs::msg::Pose &pose)
   {
-    Eigen::VectorXd x = Eigen::VectorXd::Zero(POSE_STATE_DIM);
+    PoseFilter::StateVector x = PoseFilter::StateVector::Zero();
 
     px_x = pose.position.x;
     px_y = pose.position.y;
@@ -57,7 +55,7 @@ namespace orca_filter
   }
 
   // Extract pose from PoseFilter state
-  void pose_from_px(const Eigen::VectorXd &x, geometry_msgs::msg::Pose &out)
+  void pose_from_px(const PoseFilter::StateVector &x, geometry_msgs::msg::Pose &out)
   {
     out.position.x = px_x;
     out.position.y = px_y;
@@ -73,7 +71,7 @@ namespace orca_filter
   }
 
   // Extract twist from PoseFilter state
-  void twist_from_px(const Eigen::VectorXd &x, geometry_msgs::msg::Twist &out)
+  void twist_from_px(const PoseFilter::StateVector &x, geometry_msgs::msg::Twist &out)
   {
     out.linear.x = px_vx;
     out.linear.y = px_vy;
@@ -85,7 +83,7 @@ namespace orca_filter
   }
 
   // Extract pose covariance from PoseFilter covariance
-  void pose_covar_from_pP(const Eigen::MatrixXd &P, std::array<double, 36> &pose_covar)
+  void pose_covar_from_pP(const PoseFilter::StateMatrix &P, std::array<double, 36> &pose_covar)
   {
     for (int i = 0; i < 6; i++) {
       for (int j = 0; j < 6; j++) {
@@ -95,7 +93,7 @@ namespace orca_filter
   }
 
   // Extract twist covariance from PoseFilter covariance
-  void twist_covar_from_pP(const Eigen::MatrixXd &P, std::array<double, 36> &twist_covar)
+  void twist_covar_from_pP(const PoseFilter::StateMatrix &P, std::array<double, 36> &twist_covar)
   {
     for (int i = 0; i < 6; i++) {
       for (int j = 0; j < 6; j++) {
@@ -104,60 +102,14 @@ namespace orca_filter
     }
   }
 
-  Eigen::VectorXd six_state_residual(const Eigen::Ref<const Eigen::VectorXd> &x, const Eigen::VectorXd &mean)
-  {
-    // Residual for all fields
-    Eigen::VectorXd residual = x - mean;
-
-    // Normalize roll, pitch and yaw
-    residual(3) = norm_angle(residual(3));
-    residual(4) = norm_angle(residual(4));
-    residual(5) = norm_angle(residual(5));
-
-    return residual;
-  }
-
-  Eigen::VectorXd six_state_mean(const Eigen::MatrixXd &sigma_points, const Eigen::RowVectorXd &Wm)
-  {
-    Eigen::VectorXd mean = Eigen::VectorXd::Zero(sigma_points.rows());
-
-    // Standard mean for all fields
-    for (long i = 0; i < sigma_points.cols(); ++i) {
-      mean += Wm(i) * sigma_points.col(i);
-    }
-
-    // Sum the sines and cosines
-    double sum_r_sin = 0.0, sum_r_cos = 0.0;
-    double sum_p_sin = 0.0, sum_p_cos = 0.0;
-    double sum_y_sin = 0.0, sum_y_cos = 0.0;
-
-    for (long i = 0; i < sigma_points.cols(); ++i) {
-      sum_r_sin += Wm(i) * sin(sigma_points(3, i));
-      sum_r_cos += Wm(i) * cos(sigma_points(3, i));
-
-      sum_p_sin += Wm(i) * sin(sigma_points(4, i));
-      sum_p_cos += Wm(i) * cos(sigma_points(4, i));
-
-      sum_y_sin += Wm(i) * sin(sigma_points(5, i));
-      sum_y_cos += Wm(i) * cos(sigma_points(5, i));
-    }
-
-    // Mean is arctan2 of the sums
-    mean(3) = atan2(sum_r_sin, sum_r_cos);
-    mean(4) = atan2(sum_p_sin, sum_p_cos);
-    mean(5) = atan2(sum_y_sin, sum_y_cos);
-
-    return mean;
-  }
-
   PoseFilter::PoseFilter(const rclcpp::Logger &logger, const FilterContext &cxt) :
-    FilterBase{logger, cxt, POSE_STATE_DIM}
+    Filter{logger, cxt}
   {
-    filter_.set_Q(Eigen::MatrixXd::Identity(POSE_STATE_DIM, POSE_STATE_DIM) * 0.01);
+    filter_.set_Q(StateMatrix::Identity() * 0.01);
 
     // State transition function
     filter_.set_f_fn(
-      [&cxt](const double dt, const Eigen::VectorXd &u, Eigen::Ref<Eigen::VectorXd> x)
+      [&cxt](const double dt, const ControlVector &u, Eigen::Ref<StateVector> x)
       {
         if (cxt.predict_accel_) {
           // Assume 0 acceleration
@@ -232,13 +184,13 @@ namespace orca_filter
       });
 
     // Custom residual and mean functions
-    filter_.set_r_x_fn(six_state_residual);
-    filter_.set_mean_x_fn(six_state_mean);
+    filter_.set_r_x_fn(six_state_residual<StateVector>);
+    filter_.set_mean_x_fn(six_state_mean<StateVector, Ukf::StateSigmaPoints, Ukf::Weights>);
   }
 
   void PoseFilter::reset(const geometry_msgs::msg::Pose &pose)
   {
-    FilterBase::reset(pose_to_px(pose));
+    Filter::reset(pose_to_px(pose));
   }
 
   void PoseFilter::odom_from_filter(nav_msgs::msg::Odometry &filtered_odom)
@@ -249,20 +201,20 @@ namespace orca_filter
     flatten_6x6_covar(filter_.P(), filtered_odom.twist.covariance, 6);
   }
 
-  Measurement PoseFilter::to_measurement(const orca_msgs::msg::Depth &depth) const
+  Measurement<POSE_STATE_DIM> PoseFilter::to_measurement(const orca_msgs::msg::Depth &depth) const
   {
-    Measurement m;
-    m.init_z(depth, [](const Eigen::Ref<const Eigen::VectorXd> &x, Eigen::Ref<Eigen::VectorXd> z)
+    Measurement<POSE_STATE_DIM> m;
+    m.init_z(depth, [](const Eigen::Ref<const StateVector> &x, Eigen::Ref<Ukf::MeasurementVector> z)
     {
       z(0) = px_z;
     });
     return m;
   }
 
-  Measurement PoseFilter::to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const
+  Measurement<POSE_STATE_DIM> PoseFilter::to_measurement(const geometry_msgs::msg::PoseWithCovarianceStamped &pose) const
   {
-    Measurement m;
-    m.init_6dof(pose, [](const Eigen::Ref<const Eigen::VectorXd> &x, Eigen::Ref<Eigen::VectorXd> z)
+    Measurement<POSE_STATE_DIM> m;
+    m.init_6dof(pose, [](const Eigen::Ref<const StateVector> &x, Eigen::Ref<Ukf::MeasurementVector> z)
     {
       z(0) = px_x;
       z(1) = px_y;
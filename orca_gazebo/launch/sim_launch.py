@@ -4,7 +4,8 @@ import os
 
 from ament_index_python.packages import get_package_share_directory
 from launch import LaunchDescription
-from launch.actions import ExecuteProcess
+from launch.actions import DeclareLaunchArgument, ExecuteProcess
+from launch.substitutions import LaunchConfiguration
 from launch_ros.actions import Node
 
 
@@ -36,6 +37,16 @@ def generate_launch_description():
     map_path = os.path.join(orca_gazebo_path, 'worlds', 'huge_map.yaml')
 
     return LaunchDescription([
+        # base_node and filter_node threading, e.g., ros2 launch orca_gazebo sim_launch.py executor_threads:=2 control_thread:=True
+        DeclareLaunchArgument('executor_threads', default_value='1',
+                              description='Executor threads, 1 for single-threaded, 0 for 1 per cpu'),
+        DeclareLaunchArgument('control_thread', default_value='False',
+                              description='Run base_node AUV control on a dedicated thread'),
+        DeclareLaunchArgument('control_priority', default_value='0',
+                              description='base_node control thread SCHED_FIFO priority, 0 for normal'),
+        DeclareLaunchArgument('control_cpu', default_value='-1',
+                              description='Pin the base_node control thread to this cpu, -1 for any'),
+
         # Launch Gazebo, loading orca.world
         # Could use additional_env to add model path, but we need to add to the path, not replace it
         ExecuteProcess(cmd=[
@@ -71,6 +82,10 @@ def generate_launch_description():
                 'auto_start': 0,  # Auto-start AUV mission
                 'auv_controller': 5,  # DepthController
                 'auv_z_target': -2.5,
+                'executor_threads': LaunchConfiguration('executor_threads'),
+                'control_thread': LaunchConfiguration('control_thread'),
+                'control_priority': LaunchConfiguration('control_priority'),
+                'control_cpu': LaunchConfiguration('control_cpu'),
             }], remappings=[
                 # ('odom', '/' + left_camera_name + '/odom'),
                 # ('odom', '/filtered_odom'),
@@ -95,6 +110,7 @@ def generate_launch_description():
                 'urdf_forward_camera_joint': 'forward_camera_frame_joint',
                 'urdf_left_camera_joint': 'left_camera_frame_joint',
                 'urdf_right_camera_joint': 'right_camera_frame_joint',
+                'executor_threads': LaunchConfiguration('executor_threads'),
             }], remappings=[
                 ('fcam_f_map', '/' + forward_camera_name + '/camera_pose'),
                 ('lcam_f_map', '/' + left_camera_name + '/camera_pose'),
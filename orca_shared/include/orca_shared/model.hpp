@@ -130,76 +130,204 @@ namespace orca
     { return torque_to_accel_yaw(effort_to_torque_yaw(effort_yaw)); }
 
     //=====================================================================================
-    // Parameters, updated by validate_parameters
+    // Fluid density and the coefficients that depend on it
+    //
+    // All coefficients are computed when the density is set, so the hot calls (drag,
+    // hover, pressure) are multiply-adds. Use FRESHWATER_MODEL or SEAWATER_MODEL if the
+    // density is known at compile time.
     //=====================================================================================
 
+    static constexpr double FRESHWATER_DENSITY = 997;
+    static constexpr double SEAWATER_DENSITY = 1029;
+
+  private:
+
+    double fluid_density_;
+    double displaced_mass_;
+    double weight_in_water_;
+    double hover_accel_z_;
+    double linear_drag_x_;
+    double linear_drag_y_;
+    double linear_drag_z_;
+    double angular_drag_yaw_;
+    double tether_drag_;
+    double pascals_per_meter_;            // fluid_density * GRAVITY
+    double meters_per_pascal_;            // 1 / pascals_per_meter_
+    double drag_accel_coef_x_;            // linear_drag_x / MASS
+    double drag_accel_coef_y_;
+    double drag_accel_coef_z_;
+    double drag_accel_coef_yaw_;          // angular_drag_yaw / MOMENT_OF_INERTIA_YAW
+
+    static constexpr double linear_drag(double fluid_density, double area, double coefficient)
+    { return 0.5 * fluid_density * area * coefficient; }
+
+    // Estimate angular drag
+    static constexpr double angular_drag(double fluid_density)
+    {
+      return 0.02 * (linear_drag(fluid_density, ROV_AREA_X, DRAG_COEFFICIENT_X) +
+                     linear_drag(fluid_density, ROV_AREA_Y, DRAG_COEFFICIENT_Y));
+    }
+
+  public:
+
+    constexpr Model() : Model{FRESHWATER_DENSITY}
+    {}
+
     // Fluid density, 997 for freshwater or 1029 for seawater
-    double fluid_density_ = 997;
+    constexpr explicit Model(double fluid_density) :
+      fluid_density_{fluid_density},
+      displaced_mass_{VOLUME * fluid_density},
+      weight_in_water_{GRAVITY * (MASS - VOLUME * fluid_density)},
+      hover_accel_z_{GRAVITY * (MASS - VOLUME * fluid_density) / MASS},
+      linear_drag_x_{linear_drag(fluid_density, ROV_AREA_X, DRAG_COEFFICIENT_X)},
+      linear_drag_y_{linear_drag(fluid_density, ROV_AREA_Y, DRAG_COEFFICIENT_Y)},
+      linear_drag_z_{linear_drag(fluid_density, ROV_AREA_Z, DRAG_COEFFICIENT_Z)},
+      angular_drag_yaw_{angular_drag(fluid_density)},
+      tether_drag_{0.5 * fluid_density * TETHER_DIAM * TETHER_DRAG_COEFFICIENT},
+      pascals_per_meter_{fluid_density * GRAVITY},
+      meters_per_pascal_{1 / (fluid_density * GRAVITY)},
+      drag_accel_coef_x_{linear_drag(fluid_density, ROV_AREA_X, DRAG_COEFFICIENT_X) / MASS},
+      drag_accel_coef_y_{linear_drag(fluid_density, ROV_AREA_Y, DRAG_COEFFICIENT_Y) / MASS},
+      drag_accel_coef_z_{linear_drag(fluid_density, ROV_AREA_Z, DRAG_COEFFICIENT_Z) / MASS},
+      drag_accel_coef_yaw_{angular_drag(fluid_density) / MOMENT_OF_INERTIA_YAW}
+    {}
+
+    // Set the density and recompute the coefficients, called by validate_parameters
+    void set_fluid_density(double fluid_density)
+    { *this = Model{fluid_density}; }
+
+    constexpr double fluid_density() const
+    { return fluid_density_; }
 
     //=====================================================================================
-    // Values which depend on the parameters
+    // Values which depend on the fluid density
     //=====================================================================================
 
-    double pressure_to_z(double pressure) const
-    { return -(pressure - ATMOSPHERIC_PRESSURE) / (fluid_density_ * GRAVITY); }
+    constexpr double pressure_to_z(double pressure) const
+    { return (ATMOSPHERIC_PRESSURE - pressure) * meters_per_pascal_; }
 
-    double z_to_pressure(double z) const
-    { return fluid_density_ * GRAVITY * -z + ATMOSPHERIC_PRESSURE; }
+    constexpr double z_to_pressure(double z) const
+    { return pascals_per_meter_ * -z + ATMOSPHERIC_PRESSURE; }
 
-    double displaced_mass() const
-    { return VOLUME * fluid_density_; }
+    constexpr double displaced_mass() const
+    { return displaced_mass_; }
 
-    double weight_in_water() const
-    { return GRAVITY * (MASS - displaced_mass()); }
+    constexpr double weight_in_water() const
+    { return weight_in_water_; }
 
     // Z acceleration required to hover
-    double hover_accel_z() const
-    { return weight_in_water() / MASS; }
+    constexpr double hover_accel_z() const
+    { return hover_accel_z_; }
 
-    double linear_drag_x() const
-    { return 0.5 * fluid_density_ * ROV_AREA_X * DRAG_COEFFICIENT_X; }
+    constexpr double linear_drag_x() const
+    { return linear_drag_x_; }
 
-    double linear_drag_y() const
-    { return 0.5 * fluid_density_ * ROV_AREA_Y * DRAG_COEFFICIENT_Y; }
+    constexpr double linear_drag_y() const
+    { return linear_drag_y_; }
 
-    double linear_drag_z() const
-    { return 0.5 * fluid_density_ * ROV_AREA_Z * DRAG_COEFFICIENT_Z; }
+    constexpr double linear_drag_z() const
+    { return linear_drag_z_; }
 
-    // Estimate angular drag
-    double angular_drag_yaw() const
-    { return 0.02 * (linear_drag_x() + linear_drag_y()); }
+    constexpr double angular_drag_yaw() const
+    { return angular_drag_yaw_; }
 
-    double tether_drag() const
-    { return 0.5 * fluid_density_ * TETHER_DIAM * TETHER_DRAG_COEFFICIENT; }
+    constexpr double tether_drag() const
+    { return tether_drag_; }
 
     // Velocity => drag force / torque
     double drag_force_x(double velo_x) const
-    { return velo_x * std::abs(velo_x) * -linear_drag_x(); }
+    { return velo_x * std::abs(velo_x) * -linear_drag_x_; }
 
     double drag_force_y(double velo_y) const
-    { return velo_y * std::abs(velo_y) * -linear_drag_y(); }
+    { return velo_y * std::abs(velo_y) * -linear_drag_y_; }
 
     double drag_force_z(double velo_z) const
-    { return velo_z * std::abs(velo_z) * -linear_drag_z(); }
+    { return velo_z * std::abs(velo_z) * -linear_drag_z_; }
 
     double drag_torque_yaw(double velo_yaw) const
-    { return velo_yaw * std::abs(velo_yaw) * -angular_drag_yaw(); }
+    { return velo_yaw * std::abs(velo_yaw) * -angular_drag_yaw_; }
 
     // Velocity => acceleration due to drag
     double drag_accel_x(double velo_x) const
-    { return force_to_accel(drag_force_x(velo_x)); }
+    { return velo_x * std::abs(velo_x) * -drag_accel_coef_x_; }
 
     double drag_accel_y(double velo_y) const
-    { return force_to_accel(drag_force_y(velo_y)); }
+    { return velo_y * std::abs(velo_y) * -drag_accel_coef_y_; }
 
     double drag_accel_z(double velo_z) const
-    { return force_to_accel(drag_force_z(velo_z)); }
+    { return velo_z * std::abs(velo_z) * -drag_accel_coef_z_; }
 
     double drag_accel_yaw(double velo_yaw) const
-    { return torque_to_accel_yaw(drag_torque_yaw(velo_yaw)); }
+    { return velo_yaw * std::abs(velo_yaw) * -drag_accel_coef_yaw_; }
+
+    //=====================================================================================
+    // Glide (coast) distance
+    //
+    // With no thrust, dv/dt = -c * v * |v|, where c = drag constant / mass, so
+    //    v(t) = v0 / (1 + c * v0 * t)
+    //    d(t) = ln(1 + c * v0 * t) / c
+    // The vehicle never quite stops, so glide until the speed drops below end_velo:
+    //    d = ln(v0 / end_velo) / c
+    //=====================================================================================
+
+    static double glide_distance(double c, double velo, double end_velo)
+    {
+      velo = std::abs(velo);
+      return velo > end_velo ? std::log(velo / end_velo) / c : 0;
+    }
+
+    double glide_distance_z(double velo_z, double end_velo) const
+    { return glide_distance(drag_accel_coef_z_, velo_z, end_velo); }
+
+    double glide_distance_yaw(double velo_yaw, double end_velo) const
+    { return glide_distance(drag_accel_coef_yaw_, velo_yaw, end_velo); }
+
+    // Forward and strafe drag are independent, but have different constants, so the glide
+    // ends at the time t where hypot(v_forward(t), v_strafe(t)) = end_velo. Find t using
+    // Newton's method: speed^2 is convex and decreasing in t, so starting at t = 0 the
+    // iterations approach the root from below.
+    double glide_distance_xy(double velo_forward, double velo_strafe, double end_velo) const
+    {
+      double c_f = drag_accel_coef_x_;
+      double c_s = drag_accel_coef_y_;
+      double v_f = std::abs(velo_forward);
+      double v_s = std::abs(velo_strafe);
+
+      if (v_f * v_f + v_s * v_s <= end_velo * end_velo) {
+        return 0;
+      } else if (v_s == 0) {
+        return glide_distance(c_f, v_f, end_velo);
+      } else if (v_f == 0) {
+        return glide_distance(c_s, v_s, end_velo);
+      }
+
+      double t = 0;
+      for (int i = 0; i < 8; ++i) {
+        double a_f = 1 + c_f * v_f * t;
+        double a_s = 1 + c_s * v_s * t;
+        double vt_f = v_f / a_f;
+        double vt_s = v_s / a_s;
+
+        // f(t) = speed^2 - end_velo^2, f'(t) = -2 * (c_f * vt_f^3 + c_s * vt_s^3)
+        double f = vt_f * vt_f + vt_s * vt_s - end_velo * end_velo;
+        double df = -2 * (c_f * vt_f * vt_f * vt_f + c_s * vt_s * vt_s * vt_s);
+        double step = f / df;
+        t -= step;
+
+        if (std::abs(step) < 1e-6 * t) {
+          break;
+        }
+      }
+
+      return std::hypot(std::log(1 + c_f * v_f * t) / c_f, std::log(1 + c_s * v_s * t) / c_s);
+    }
 
   };
 
+  // Models for the standard densities, the coefficients are computed at compile time
+  constexpr Model FRESHWATER_MODEL{Model::FRESHWATER_DENSITY};
+  constexpr Model SEAWATER_MODEL{Model::SEAWATER_DENSITY};
+
 } // namespace orca_shared
 
 #endif //ORCA_SHARED_MODEL_HPP
@@ -1,6 +1,9 @@
 #ifndef ORCA_SHARED_MONOTONIC_HPP
 #define ORCA_SHARED_MONOTONIC_HPP
 
+#include <cstdint>
+
+#include "builtin_interfaces/msg/time.hpp"
 #include "rclcpp/rclcpp.hpp"
 
 namespace monotonic
@@ -108,6 +111,121 @@ namespace monotonic
     { return valid(prev_); }
   };
 
+//=============================================================================
+// Statically dispatched wrappers
+//
+// Same behavior as Valid and Monotonic, but the callback is a template parameter, so
+// it's called directly (and can be inlined), and the stamps are kept as nanoseconds,
+// so the per-message checks are integer compares. They also count dropped messages.
+//=============================================================================
+
+  struct Stats
+  {
+    uint64_t processed{0};
+    uint64_t zero_stamp{0};       // Dropped, stamp was 0
+    uint64_t out_of_order{0};     // Dropped, stamp was <= the previous stamp
+  };
+
+  inline void log_stats(const rclcpp::Logger &logger, const char *name, const Stats &stats)
+  {
+    RCLCPP_INFO(logger, "%s: %llu processed, dropped %llu with zero stamps, %llu out of order", name,
+                static_cast<unsigned long long>(stats.processed), static_cast<unsigned long long>(stats.zero_stamp),
+                static_cast<unsigned long long>(stats.out_of_order));
+  }
+
+  inline int64_t to_nanoseconds(const builtin_interfaces::msg::Time &stamp)
+  {
+    return static_cast<int64_t>(stamp.sec) * 1000000000 + stamp.nanosec;
+  }
+
+  template<typename N, typename M, void (N::*Process)(M)>
+  class ValidMember
+  {
+    N *node_;
+    int64_t curr_{0};                 // Stamp of current message, ns
+    int64_t prev_{0};                 // Stamp of previous message, ns
+    Stats stats_;
+
+  public:
+
+    explicit ValidMember(N *node) : node_{node}
+    {}
+
+    void call(const M &msg)
+    {
+      curr_ = to_nanoseconds(msg->header.stamp);
+
+      if (curr_ > 0) {
+        ++stats_.processed;
+        (node_->*Process)(msg);
+        prev_ = curr_;
+      } else {
+        ++stats_.zero_stamp;
+      }
+    }
+
+    int64_t curr_ns() const
+    { return curr_; }
+
+    int64_t prev_ns() const
+    { return prev_; }
+
+    double dt() const
+    { return static_cast<double>(curr_ - prev_) / 1e9; }
+
+    bool receiving() const
+    { return prev_ > 0; }
+
+    const Stats &stats() const
+    { return stats_; }
+  };
+
+  template<typename N, typename M, void (N::*Process)(M, bool)>
+  class MonotonicMember
+  {
+    N *node_;
+    int64_t curr_{0};                 // Stamp of current message, ns
+    int64_t prev_{0};                 // Stamp of previous message, ns
+    Stats stats_;
+
+  public:
+
+    explicit MonotonicMember(N *node) : node_{node}
+    {}
+
+    void call(const M &msg)
+    {
+      curr_ = to_nanoseconds(msg->header.stamp);
+
+      if (curr_ <= 0) {
+        ++stats_.zero_stamp;
+      } else if (curr_ <= prev_) {
+        // Must be monotonic
+        ++stats_.out_of_order;
+      } else {
+        ++stats_.processed;
+        bool first = prev_ <= 0;
+        (node_->*Process)(msg, first);
+        prev_ = curr_;
+      }
+    }
+
+    int64_t curr_ns() const
+    { return curr_; }
+
+    int64_t prev_ns() const
+    { return prev_; }
+
+    double dt() const
+    { return static_cast<double>(curr_ - prev_) / 1e9; }
+
+    bool receiving() const
+    { return prev_ > 0; }
+
+    const Stats &stats() const
+    { return stats_; }
+  };
+
 } // namespace orca_shared
 
 #endif //ORCA_SHARED_MONOTONIC_HPP
@@ -62,7 +62,7 @@ namespace orca
   constexpr uint16_t THRUST_DZ_PWM = 0;  // ESC R2 has a deadzone of 25 microseconds, R3 has no deadzone
   constexpr uint16_t THRUST_RANGE_PWM = 400 - THRUST_DZ_PWM;
 
-  uint16_t effort_to_pwm(const double effort)
+  inline uint16_t effort_to_pwm(const double effort)
   {
     return orca::clamp(
       static_cast<uint16_t>(orca_msgs::msg::Control::THRUST_STOP +
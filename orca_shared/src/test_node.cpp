@@ -4,7 +4,12 @@
 
 class TestNode : public rclcpp::Node
 {
-  monotonic::Monotonic<TestNode *, const geometry_msgs::msg::PoseStamped::SharedPtr> cb_{this, &TestNode::process_pose};
+  void process_pose(const geometry_msgs::msg::PoseStamped::SharedPtr msg, bool first)
+  {
+    RCLCPP_INFO(get_logger(), "joy %d", first);
+  }
+
+  monotonic::MonotonicMember<TestNode, geometry_msgs::msg::PoseStamped::SharedPtr, &TestNode::process_pose> cb_{this};
   rclcpp::Subscription<geometry_msgs::msg::PoseStamped>::SharedPtr sub_;
 
 public:
@@ -16,11 +21,6 @@ public:
       [this](const geometry_msgs::msg::PoseStamped::SharedPtr msg) -> void
       { this->cb_.call(msg); });
   }
-
-  void process_pose(const geometry_msgs::msg::PoseStamped::SharedPtr msg, bool first)
-  {
-    RCLCPP_INFO(get_logger(), "joy %d", first);
-  }
 };
 
 int main(int argc, char **argv)